@@ -0,0 +1,231 @@
+/*-------------------------------------------------------------------------*\
+|  Module "acyclic.c"
+|
+|  The "acyclic" minimization engine, for DFAs whose transition graph
+|  has no cycles (e.g. DFAs of finite languages / dictionaries).
+|
+|  Method: D. Revuz, "Minimisation of acyclic deterministic automata
+|  in linear time" (1992). The height of a state is the length of the
+|  longest path from it (missing transitions do not count). Equivalent
+|  states have equal heights, and all the successors of a state are
+|  lower than it, so the states can be classified height by height in a
+|  single bottom-up pass: two states of the same height are equivalent
+|  iff they agree on acceptance and, on every symbol, go to the same
+|  (already final) class - or both have no transition.
+|  Each height is classified by sorting its states on that signature.
+\*-------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include "auto.h"
+
+void  trace_begin ();
+void  trace_end ();
+void  pk_seek ();
+int   pk_next ();
+
+static automaton_t  *sdfa;	/* DFA being sorted (for cmp_signature) */
+static state_t      *cls;	/* cls[s]: class number of state 's'    */
+
+static int  cmp_signature ();
+static int  cmp_states ();
+
+/*-------------------------------------------------------------------------
+|  int  acyclic_height (dfa, height)
+|  automaton_t  *dfa;
+|  int          height[];
+|
+|  Compute the height of every state of 'dfa' into 'height[]' (if not
+|  NULL), by an iterative depth-first search. With a packed copy of the
+|  transitions every stacked state has a cursor into its packed row.
+|  Return the maximal height, or -1 if 'dfa' has a cycle.
+`------------------------------------------------------------------------*/
+
+int  acyclic_height (dfa, height)
+automaton_t  *dfa;
+int          height[];
+{
+    int          n = dfa->nstates;
+    char         *color;	/* 0: new, 1: on the DFS stack, 2: done */
+    state_t      *stack;	/* DFS stack of states ...              */
+    int          *next;		/* ... and of their next symbol to try  */
+    pk_cursor_t  *cur = NULL;	/* ... or their packed rows' cursors    */
+    int          *h;
+    int          sp, j, max = 0;
+    state_t      s, t, root;
+
+    color = (char *) mem_alloc(MEM_CLASSES, n + 1);
+    stack = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    next = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    h = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    if (dfa->packed != NULL)
+	cur = (pk_cursor_t *) mem_alloc(MEM_CLASSES,
+					(n + 1) * sizeof(pk_cursor_t));
+
+    for (root = 1; root <= n && max >= 0; root++) {
+	if (color[root] != 0)
+	    continue;
+	sp = 0;
+	stack[sp] = root;
+	if (cur != NULL)
+	    pk_seek(dfa->packed, root, &cur[sp]);
+	next[sp++] = 1;
+	color[root] = 1;
+	while (sp > 0) {
+	    s = stack[sp - 1];
+	    if (cur != NULL) {
+		if (! pk_next(&cur[sp - 1], &j, &t))
+		    j = dfa->nab + 1;
+	    } else if ((j = next[sp - 1]++) <= dfa->nab)
+		t = dfa->mat[s][j];
+	    if (j > dfa->nab) {             /* all successors done */
+		color[s] = 2;
+		if (h[s] > max)
+		    max = h[s];
+		if (--sp > 0 && h[stack[sp - 1]] < h[s] + 1)
+		    h[stack[sp - 1]] = h[s] + 1;
+		continue;
+	    }
+	    if (t <= 0)
+		continue;
+	    if (color[t] == 1) {            /* back edge: a cycle */
+		max = -1;
+		break;
+	    }
+	    if (color[t] == 2) {
+		if (h[s] < h[t] + 1)
+		    h[s] = h[t] + 1;
+	    } else {
+		color[t] = 1;
+		stack[sp] = t;
+		if (cur != NULL)
+		    pk_seek(dfa->packed, t, &cur[sp]);
+		next[sp++] = 1;
+	    }
+	}
+    }
+
+    if (height != NULL && max >= 0)
+	for (s = 1; s <= n; s++)
+	    height[s] = h[s];
+
+    mem_free(color);
+    mem_free(stack);
+    mem_free(next);
+    mem_free(h);
+    if (cur != NULL)
+	mem_free(cur);
+    return max;
+}
+
+/*-------------------------------------------------------------------------
+|  int  acyclic_refine (dfa, groups)
+|  automaton_t  *dfa;
+|  state_t      groups[];
+|
+|  Partition the states of the acyclic DFA 'dfa' into equivalence-classes
+|  in the Union-Find array 'groups[]'. Return the number of heights
+|  processed (the "rounds").
+`------------------------------------------------------------------------*/
+
+int  acyclic_refine (dfa, groups)
+automaton_t  *dfa;
+state_t      groups[];
+{
+    int      n = dfa->nstates;
+    int      *height;
+    int      *start;	/* states of height h: byh[start[h] .. start[h+1]-1] */
+    state_t  *byh;
+    int      max, h, i, first, nclasses = 0;
+    state_t  s, rep;
+
+    height = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    if ((max = acyclic_height(dfa, height)) < 0)
+	Abort(("The DFA has a cycle: the \"acyclic\" engine does not apply\n"));
+
+    trace_begin("refine", NULL, NULL);
+    start = (int *) mem_alloc(MEM_CLASSES, (max + 2) * sizeof(int));
+    byh = (state_t *) mem_alloc(MEM_CLASSES, n * sizeof(state_t));
+    cls = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+
+    /* bucket the states by height (counting sort) */
+    for (s = 1; s <= n; s++)
+	start[height[s] + 1]++;
+    for (h = 1; h <= max + 1; h++)
+	start[h] += start[h - 1];
+    for (s = 1; s <= n; s++)
+	byh[start[height[s]]++] = s;
+    for (h = max + 1; h > 0; h--)
+	start[h] = start[h - 1];
+    start[0] = 0;
+
+    sdfa = dfa;
+    for (h = 0; h <= max; h++) {
+	qsort(byh + start[h], start[h + 1] - start[h], sizeof(state_t),
+	      cmp_states);
+
+	/* runs of equal signatures are classes; the first is the rep. */
+	for (first = start[h]; first < start[h + 1]; first = i) {
+	    rep = byh[first];
+	    cls[rep] = ++nclasses;
+	    groups[rep] = 0;
+	    for (i = first + 1; i < start[h + 1]
+		 && cmp_signature(rep, byh[i]) == 0; i++) {
+		cls[byh[i]] = nclasses;
+		groups[byh[i]] = rep;
+		groups[rep]--;
+	    }
+	}
+    }
+    trace_end("refine");
+
+    mem_free(height);
+    mem_free(start);
+    mem_free(byh);
+    mem_free(cls);
+    return max + 1;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  cmp_states (p1, p2)
+|  state_t  *p1, *p2;
+|
+|  qsort() comparison of two states of the same height: by signature,
+|  ties broken by state number so that the first state of each run of
+|  equal signatures (the class representative) is its lowest member.
+`------------------------------------------------------------------------*/
+
+static int  cmp_states (p1, p2)
+state_t  *p1, *p2;
+{
+    int  c = cmp_signature(*p1, *p2);
+
+    return (c != 0) ? c : *p1 - *p2;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  cmp_signature (s1, s2)
+|  state_t  s1, s2;
+|
+|  Compare the signatures of the states 's1' and 's2': acceptance,
+|  then the classes of their successors (0 for a missing transition).
+`------------------------------------------------------------------------*/
+
+static int  cmp_signature (s1, s2)
+state_t  s1, s2;
+{
+    state_t  t1, t2;
+    int      a1, a2, j;
+
+    a1 = (sdfa->state_attrib[s1] == 'A');
+    a2 = (sdfa->state_attrib[s2] == 'A');
+    if (a1 != a2)
+	return a1 - a2;
+
+    for (j = 1; j <= sdfa->nab; j++) {
+	t1 = sdfa->mat[s1][j] > 0 ? cls[sdfa->mat[s1][j]] : 0;
+	t2 = sdfa->mat[s2][j] > 0 ? cls[sdfa->mat[s2][j]] : 0;
+	if (t1 != t2)
+	    return t1 - t2;
+    }
+    return 0;
+}
@@ -2,21 +2,23 @@
 #
 # Test script for minauto
 # Uses known inputs & verifies vs expected outputs
+# (if io/opt.X exists, it holds the options to run io/inp.X with)
 #
 tests=0
 ok=0
 fail=0
 tdiff=/tmp/diff.$$
+tout=/tmp/out.$$
+tmp=/tmp/all.$$
+mkdir $tmp
 
 #
-# -- Iterate on all inputs test cases
+# -- Compare $tout with the expected output $1 (of the run $2, if any)
 #
-for inp in io/inp.*; do
-    out="$(echo $inp | sed 's,inp,out,')"
-
-    echo -n === comparing $out:
+check() {
+    echo -n === comparing $1${2:+ \($2\)}:
 
-    ./minauto $inp | diff - $out >$tdiff
+    diff $tout $1 >$tdiff
 
     case $? in
 	0)  echo " ok"
@@ -25,10 +27,91 @@ for inp in io/inp.*; do
 	    fail=$(($fail+1)) ;;
     esac
     tests=$(($tests+1))
+}
+
+#
+# -- Iterate on all inputs test cases
+#
+for inp in io/inp.*; do
+    out="$(echo $inp | sed 's,inp,out,')"
+    opt="$(echo $inp | sed 's,inp,opt,')"
+    opts=
+    [ -f $opt ] && opts="$(cat $opt)"
+
+    ./minauto $opts $inp >$tout
+    check $out
 done
 
+#
+# -- The same, the matrices parsed by 4 threads: minauto-par parses
+#    those of 64 bytes on in parallel (see parse_part() in scan.c)
+#
+for inp in io/inp.*; do
+    out="$(echo $inp | sed 's,inp,out,')"
+    opt="$(echo $inp | sed 's,inp,opt,')"
+    opts=
+    [ -f $opt ] && opts="$(cat $opt)"
+
+    ./minauto-par -j 4 $opts $inp >$tout
+    check $out "-j 4"
+done
+
+#
+# -- A pack of two DFAs, looked up by name: one in it, one not
+#    (the temporary directory is printed as TMP)
+#
+{
+    ./minauto -c -h $tmp/pack io/inp.1 io/inp.3 | tail -1
+    ./minauto -H $tmp/pack io/inp.3 io/inp.5 2>&1
+} | sed "s,$tmp,TMP,g" >$tout
+check io/out.pack
+
+#
+# -- A patch between two DFA files: written (-u), applied (-g) to the
+#    old one, which it turns into the new one, and applied again, which
+#    fails: the file is the new version by then (and no temporary
+#    file of the switch is left over)
+#
+mkdir $tmp/diff
+{
+    ./minauto -q $tmp/diff/table io/old.21 >/dev/null
+    ./minauto -q $tmp/diff/new io/inp.21 >/dev/null
+    ./minauto -u $tmp/diff/patch io/old.21 io/inp.21 | tail -1
+    ./minauto -g $tmp/diff/patch $tmp/diff/table
+    cmp $tmp/diff/table $tmp/diff/new && echo the patched table is the new one
+    ./minauto -g $tmp/diff/patch $tmp/diff/table || echo exit status $?
+    ls $tmp/diff
+} 2>&1 | sed "s,$tmp,TMP,g" >$tout
+check io/out.patch
+
+#
+# -- A memory cap too small for the DFA: a clean abort (-m); and the
+#    statistics of a run (-s), less its timings
+#
+{
+    ./minauto -m 1000 io/inp.1 || echo exit status $?
+    ./minauto -s -e aho io/inp.1 2>&1 >/dev/null | grep -v usec
+} >$tout
+check io/out.mem
+
+#
+# -- The trace of a run (-t), the decompression thread of inp.8 too:
+#    a JSON object of events, each with its ph, ts (but the metadata
+#    events) & tid, and the spans of every thread begin & end in pairs
+#
+./minauto -t $tmp/trace io/inp.1 io/inp.8 >/dev/null
+{
+    head -1 $tmp/trace
+    sed '1d;$d' $tmp/trace \
+    | grep -Ev '^\{"name":"[^"]*","ph":"(M"|[BE]","ts":[0-9.]+),"pid":[0-9]+,"tid":[0-9]+[,}]'
+    sed '1d;$d' $tmp/trace | sed 's/.*"ph":"\(.\)".*"tid":\([0-9]*\).*/\2 \1/' \
+    | awk '$2 == "B" { n[$1]++ } $2 == "E" { n[$1]-- }
+	   END { for (t in n) if (n[t] != 0) print "unbalanced spans" }'
+    tail -1 $tmp/trace
+} >$tout
+check io/out.trace
+
 echo $ok/$tests succeeded
 
 # -- Cleanup
-rm $tdiff
-
+rm -rf $tdiff $tout $tmp
@@ -1,6 +1,8 @@
 #ifndef AUTO_H
 #define AUTO_H
 
+#include <stddef.h>
+
 #ifndef MAX_STATES
 #   define MAX_STATES 50
 #endif
@@ -11,6 +13,30 @@
 
 typedef  int  state_t;
 
+/*
+ |  Packed (delta + varint) transitions, and a cursor decoding them
+ |  (see module "packed.c")
+ */
+typedef struct {
+	int		nstates;
+	unsigned char	*data;		/* the rows, one after the other  */
+	size_t		len;
+	size_t		*index;		/* offsets of every block's row 1 */
+} packed_t;
+
+typedef struct {
+	unsigned char	*p;		/* next byte to decode            */
+	int		left;		/* transitions left in the row    */
+	int		sym;		/* last symbol decoded            */
+	state_t		src;		/* the state of the row           */
+} pk_cursor_t;
+
+/*
+ |  Flags of input_dfa() (see module "inout.c")
+ */
+#define INPUT_MEALY	1	/* output labels follow the transitions */
+#define INPUT_WORDS	2	/* the alphabet is one of words         */
+
 /*
  |  State attributes are one of:
  |
@@ -28,12 +54,316 @@ typedef struct {
 	state_t init_state;                 	/* initial state            */
 	state_t	accept[MAX_STATES + 1];		/* accept states            */
 	char	state_attrib[MAX_STATES + 1]; 	/* state attributes         */
+	state_t	*cols;				/* column copy, or NULL     */
+	packed_t *packed;			/* packed copy, or NULL     */
+	int	*outs;				/* Mealy outputs, or NULL   */
 } automaton_t;
 
+/*
+ |  The output label of the transition of state S on symbol A of a Mealy
+ |  machine (see module "inout.c"): label + 1, 0 if it has none
+ */
+#define OUT(DFA, S, A)	((DFA)->outs[(S) * ((DFA)->nab + 1) + (A)])
+
+/*
+ |  The column (symbol-major) copy of the transitions (module "layout.c")
+ */
+#define COL(DFA, A, P)	((DFA)->cols[((A) - 1) * ((DFA)->nstates + 1) + (P)])
+
+#define LAYOUT_ROW	0	/* engine reads 'mat' only            */
+#define LAYOUT_COL	1	/* engine uses 'cols' when available  */
+#define LAYOUT_PACKED	2	/* ... 'packed' (module "packed.c")   */
+#define LAYOUT_MASK(L)	(1 << (L))
+
+/*
+ |  A decompression in progress (see module "decomp.c")
+ */
+typedef struct decomp  decomp_t;
+
+#define DECOMP_NONE	0
+#define DECOMP_GZIP	1
+#define DECOMP_ZSTD	2
+
+#define SCAN_SLACK	64	/* room for a token cut by a buffer end */
+
+/*
+ |  An input being scanned (see module "scan.c")
+ */
+typedef struct {
+	char	*buf;		/* the whole input (mapped or read) */
+	char	*p, *end;	/* scan position, end of the input  */
+	int	mapped;		/* TRUE iff 'buf' is mmap()ed       */
+	size_t	maplen;		/* length of the mapping            */
+
+	/* compressed input: 'buf' is the compressed data, and 'p' & 'end'
+	   point into the current buffer of decompressed data, which goes
+	   on up to 'lim' ('end' being after its last complete token) */
+	decomp_t  *dc;		/* NULL if not compressed           */
+	char	*lim;
+	int	eof;		/* the last buffer is being scanned */
+	char	carry[SCAN_SLACK];
+} scan_t;
+
+/*
+ |  A dictionary of the multi-character symbols of an alphabet of words
+ |  (see module "dict.c"): symbols 1 .. n, looked up after dict_seal()
+ |  through a perfect hash
+ */
+#define DICT_WORD_MAX	SCAN_SLACK	/* longest symbol */
+
+typedef struct {
+	int		n, size;	/* symbols (room for 'size')        */
+	char		*text;		/* their characters, one after other */
+	size_t		text_len, text_size;
+	size_t		*at;		/* symbol i: text[at[i] ..          */
+	int		*len;		/*   .. + len[i] - 1]               */
+	int		maxlen;		/* longest symbol                   */
+	unsigned long long *hash;	/* hash[i]: hash of symbol i        */
+	int		*htab, hsize;	/* interning: open addressing       */
+	unsigned long long seed;	/* perfect hash: seed of the hashes */
+	int		nbuckets;	/* ... buckets of symbols           */
+	unsigned	*disp;		/* ... disp[b]: displacement of 'b' */
+	int		nslots;
+	int		*slot;		/* ... slot[k]: symbol in it, or 0  */
+} dict_t;
+
+/*
+ |  A prefilter of a minimized DFA (see module "prefilter.c"): every
+ |  match contains the literal 'lit' and starts at most 'before' bytes
+ |  before it, and begins with one of the bytes 'first'.
+ */
+#define PREFILTER_MAX	32	/* longest literal kept */
+
+typedef struct {
+	int		nlit;		/* length of the literal (0: none) */
+	unsigned char	lit[PREFILTER_MAX];
+	int		before;
+	int		nfirst;
+	unsigned char	first[AB_SIZE];
+} prefilter_t;
+
+/*
+ |  A minimized DFA compiled for matching byte strings (module "match.c")
+ */
+#ifndef ACCEL_MAX
+#   define ACCEL_MAX	4	/* exit bytes of an accelerated state */
+#endif
+
+#define MATCH_ACCEPT	1	/* kind[s]: 's' is an accept state    */
+#define MATCH_ACCEL	2	/* ... self-loops on all but exits[s] */
+#define MATCH_LOOP	4	/* ... self-loops on every byte       */
+
+typedef struct {
+	int		nstates;
+	state_t		init;		/* initial state                  */
+	int		width;		/* row entries: 256, or 1 + nab   */
+	state_t		*next;		/* next[s * width + byte]         */
+	dict_t		*dict;		/* words: their symbols, or NULL  */
+	unsigned char	*kind;		/* kind[s]: MATCH_xxx bits        */
+	unsigned char	*exits;		/* exits[s * ACCEL_MAX ...]       */
+	int		naccel;		/* number of accelerated states   */
+	prefilter_t	pf;		/* its literal scanned for first  */
+	size_t		scanned;	/* bytes scanned ...              */
+	size_t		skipped;	/* ... of which skipped by accel. */
+} matcher_t;
+
+/*
+ |  A stream being scanned by a matcher (see match_start())
+ */
+typedef struct {
+	matcher_t	*m;
+	state_t		s;		/* matcher state between buffers  */
+	char		part[DICT_WORD_MAX + 1];	/* words: the one  */
+	int		part_len;	/* cut by the last buffer end     */
+	size_t		offset;		/* stream offset of the next one  */
+	size_t		count;		/* matches so far                 */
+	void		(*report) ();	/* (*report)(arg, end offset)     */
+	void		*arg;
+} match_ctx_t;
+
+/*
+ |  Many matchers merged for scanning in one pass (see module "multi.c"),
+ |  and a stream being scanned by them (see multi_start())
+ */
+typedef struct {
+	int		n, size;	/* matchers (room for 'size')      */
+	matcher_t	**m;		/* the matchers, until built       */
+	char		**names;	/* ... and their names             */
+	int		ncls;		/* shared byte classes             */
+	unsigned char	cls[256];	/* cls[byte]: its class            */
+	size_t		*base;		/* base[i]: first state of m[i]    */
+	unsigned	*table;		/* merged rows of 'ncls' entries   */
+	unsigned	*start;		/* start[i]: initial entry of m[i] */
+	size_t		scanned;	/* last scan: bytes                */
+	int		retired;	/* ... matchers retired            */
+	size_t		skipped;	/* ... bytes after all were        */
+} multi_t;
+
+typedef struct {
+	multi_t		*mm;
+	unsigned	*st;		/* entries of the active matchers  */
+	int		*id;		/* ... their numbers               */
+	int		nact;		/* ... how many                    */
+	int		retired;
+	size_t		skipped;
+	size_t		offset;		/* stream offset of the next byte  */
+	size_t		count;		/* matches so far                  */
+	void		(*report) ();	/* (*report)(arg, i, end offset)   */
+	void		*arg;
+} multi_ctx_t;
+
+/*
+ |  A matcher compressed with default transitions (D2FA, see module
+ |  "d2fa.c"), and the stream it scans
+ */
+typedef struct {
+	int		nstates;
+	state_t		init;
+	state_t		*deflt;		/* deflt[S]: default state, 0: none */
+	unsigned long long *bits;	/* bits[S * 4 ...]: labeled bytes   */
+	unsigned short	*rank;		/* rank[S * 4 + w]: labeled before
+					   word 'w' of the bits of S       */
+	unsigned	*at;		/* labeled targets of S: to[at[S] .. */
+	state_t		*to;
+	unsigned char	*kind;		/* kind[S]: MATCH_ACCEPT           */
+	size_t		nlabeled;	/* labeled transitions             */
+	int		nroots;		/* states without a default        */
+	int		depth;		/* longest default chain           */
+	size_t		bytes;		/* size of the tables              */
+	state_t		s;		/* stream: current state           */
+	size_t		offset;		/* ... offset of the next buffer   */
+	size_t		count;		/* ... matches so far              */
+	void		(*report) ();	/* (*report)(arg, end offset)      */
+	void		*arg;
+	size_t		scanned;	/* bytes scanned                   */
+	size_t		hops;		/* ... default transitions taken   */
+} d2fa_t;
+
+/*
+ |  An NFA (see module "inout.c"): states 1 .. nstates, 1 initial, and
+ |  its edges grouped by source state, by symbol within a state
+ */
+typedef struct {
+	int		nstates;
+	int		nab;		/* alphabet size                   */
+	int		nedges;
+	int		*first;		/* edges of s: first[s] .. first[s+1]-1 */
+	int		*sym;		/* sym[e]: symbol of edge 'e'      */
+	state_t		*to;		/* to[e]: its target               */
+	char		*accept;	/* accept[s]: TRUE iff accepting   */
+} nfa_t;
+
+/*
+ |  An NFA matched through a lazily built DFA, and the stream it scans
+ |  (see module "lazy.c")
+ */
+typedef struct {
+	nfa_t		*nfa;
+	int		anchored;
+	int		width;		/* row entries: 1 + alphabet size  */
+	unsigned char	cls[256];	/* cls[byte]: its symbol, 0 if none */
+	int		max;		/* cache: at most 'max' states ... */
+	int		nsets;		/* ... 'nsets' of them in it       */
+	int		*next;		/* next[S * width + cls], 0: unknown */
+	char		*kind;		/* kind[S]: LAZY_xxx bits          */
+	state_t		*pool;		/* NFA state sets, one after other */
+	size_t		pool_len, pool_size;
+	size_t		*set_at;	/* set of S: pool[set_at[S] ..     */
+	int		*set_len;	/*   .. + set_len[S] - 1]          */
+	int		*htab;		/* hash table of the sets, 2 * max */
+	state_t		*set, *keep;	/* scratch sets                    */
+	int		*mark, stamp;
+	int		s;		/* stream: current state           */
+	size_t		offset;		/* ... offset of the next buffer   */
+	size_t		count;		/* ... matches so far              */
+	void		(*report) ();	/* (*report)(arg, end offset)      */
+	void		*arg;
+	size_t		scanned;	/* bytes scanned                   */
+	size_t		skipped;	/* ... of which after a dead end   */
+	size_t		made;		/* states made                     */
+	int		flushes;	/* times the cache was flushed     */
+} lazy_t;
+
+/*
+ |  A pack of minimized DFAs (see module "pack.c"): being written (the
+ |  DFAs added so far), or mapped from its file, and a DFA in it - a view
+ |  of its section in the file, with states 1 .. nstates
+ */
+typedef struct {
+	unsigned long long	hash;	/* of the name (FNV-1a)           */
+	unsigned long long	name;	/* file offsets: of the name ...  */
+	unsigned long long	dfa;	/* ... & of the DFA, 0: empty slot */
+} pack_slot_t;
+
+typedef struct {
+	int		n, size;	/* written: DFAs (room for 'size') */
+	char		**names;	/* ... their names                 */
+	size_t		*at;		/* ... their sections in 'data'    */
+	unsigned char	*data;		/* ... one after the other         */
+	size_t		len, room;
+	unsigned char	*map;		/* mapped: the file                */
+	size_t		maplen;
+	unsigned	nslots;		/* ... its index, a power of 2     */
+	pack_slot_t	*slots;
+} pack_t;
+
+typedef struct {
+	int		nstates;
+	int		nab;
+	state_t		init;
+	unsigned char	*cls;		/* cls[byte]: its symbol, 0 if none */
+	unsigned	*next;		/* next[S * (nab + 1) + cls]       */
+	unsigned char	*accept;	/* accept[S]: TRUE iff accepting   */
+} pack_dfa_t;
+
+/*
+ |  Cheap features of a DFA for engine selection (see module "select.c")
+ */
+typedef struct {
+	int	nstates;	/* number of states                     */
+	int	nab;		/* alphabet size                        */
+	double	density;	/* fraction of defined transitions      */
+	int	ab_classes;	/* symbols with distinct columns        */
+	int	acyclic;	/* TRUE iff the DFA has no cycles       */
+	int	max_scc;	/* states of its largest cyclic SCC     */
+} features_t;
+
+/*
+ |  Refinable partition of the elements 0 .. n-1 (see module "rpart.c")
+ */
+typedef struct {
+	int	n;		/* number of elements                     */
+	int	nsets;		/* number of sets                         */
+	int	*elems;		/* elements, grouped by set               */
+	int	*loc;		/* loc[e]: position of 'e' in elems[]     */
+	int	*sidx;		/* sidx[e]: the set 'e' belongs to        */
+	int	*first, *end;	/* set 's' is elems[first[s] .. end[s]-1] */
+	int	*mid;		/* elems[first[s] .. mid[s]-1] are marked */
+	int	*touched;	/* sets with marked elements              */
+	int	ntouched;
+	int	*split_from;	/* split_from[s]: set 's' was split from  */
+} rpart_t;
+
 
 #define TRUE 1
 #define FALSE 0
 
+/*
+ |  Categories of tracked memory (see module "mem.c")
+ */
+#define MEM_AUTOMATON	0	/* automaton_t structures (transition tables) */
+#define MEM_CLASSES	1	/* partition / equivalence-class arrays       */
+#define MEM_CLOSURE	2	/* transitive-closure (reachability) matrix   */
+#define MEM_INVERSE	3	/* inverse transition index                   */
+#define MEM_IO		4	/* input / output buffers                     */
+#define MEM_LAYOUT	5	/* column / packed copies of transitions      */
+#define MEM_MATCHER	6	/* byte tables of compiled matchers           */
+#define MEM_DICT	7	/* interned multi-character symbols           */
+#define MEM_NCATS	8
+
+extern void	*mem_alloc ();
+extern void	mem_free ();
+
 #ifdef MSDOS
 #  include <stdlib.h>
 #endif
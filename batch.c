@@ -0,0 +1,536 @@
+/*-------------------------------------------------------------------------*\
+|  Module "batch.c"
+|
+|  Read-ahead of the input files of a batch (several file arguments).
+|
+|  With many small DFA files the time goes to open(), read() & close()
+|  system calls and to their latency rather than to minimization. So
+|  while a file is being minimized, the opens and reads of the next
+|  BATCH_WINDOW files are already in flight, submitted through a Linux
+|  io_uring: every file gets an OPENAT request, and as soon as that
+|  completes a READ of its contents into a buffer. batch_next() hands out
+|  the files in argument order, each one as soon as its buffer landed.
+|
+|  Only the small regular files (at most BATCH_BUF bytes) are read ahead:
+|  the others - large matrices, pipes - are handed out open, and scanned
+|  from their descriptor (see scan_open()), mapped or streamed.
+|
+|  Where io_uring is not available (not Linux, an old kernel, a sandbox
+|  forbidding it, or compiled with -DNO_IO_URING) every file is simply
+|  open()ed and read() when its turn comes.
+|
+|  The ring is driven through the raw system calls (no liburing needed).
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "auto.h"
+
+#if defined(__linux__) && ! defined(NO_IO_URING) && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#    define USE_IO_URING
+#  endif
+#endif
+
+#ifdef USE_IO_URING
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <linux/io_uring.h>
+#endif
+
+#ifndef BATCH_WINDOW
+#   define BATCH_WINDOW	32	/* files in flight ahead of the current one */
+#endif
+
+#define BATCH_BUF	(1 << 16)	/* largest file read ahead */
+
+extern void  scan_open ();
+extern void  scan_buffer ();
+void  trace_begin ();
+void  trace_end ();
+
+/*
+ |  One file of the batch
+ */
+typedef struct {
+	int	state;		/* F_xxx                                 */
+	int	fd;
+	char	*buf;		/* its contents (mem_alloc(MEM_IO, ...)) */
+	size_t	size, len;	/* buffer size, bytes read               */
+	int	err;		/* errno if F_ERROR                      */
+} bfile_t;
+
+#define F_IDLE		0	/* nothing submitted yet          */
+#define F_OPENING	1	/* OPENAT in flight               */
+#define F_READING	2	/* READ in flight                 */
+#define F_DONE		3	/* contents in 'buf'              */
+#define F_ERROR		4	/* open or read failed ('err')    */
+#define F_OPEN		5	/* open, not read ahead ('fd')    */
+
+static char     **names;	/* the file names           */
+static bfile_t  *files;
+static int      nfiles;
+static int      next_file;	/* next to be handed out    */
+static int      next_submit;	/* next to be submitted     */
+static int      scan_fd = -1;	/* handed out open (F_OPEN) */
+
+static int   read_ahead ();
+static void  read_rest ();
+static void  load_sync ();
+
+#ifdef USE_IO_URING
+/*
+ |  The io_uring (ring.fd < 0: not available)
+ */
+static struct {
+	int			fd;
+	unsigned		*sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned		*cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe	*sqes;
+	struct io_uring_cqe	*cqes;
+	char			*sq, *cq;	/* the mappings ...          */
+	size_t			sq_len, cq_len, sqes_len;  /* ... & sizes */
+	unsigned		pending;	/* queued, not yet submitted */
+	unsigned		inflight;	/* submitted, not completed  */
+	int			giving_up;	/* io_uring turned down      */
+} ring = { -1, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	   NULL, NULL, 0, 0, 0, 0, 0, 0 };
+
+static void  ring_setup ();
+static void  ring_unmap ();
+
+static void  ring_wait ();
+static void  submit_open ();
+static void  submit_read ();
+#endif
+
+/*-------------------------------------------------------------------------
+|  void  batch_open (argv, n)
+|  char  *argv[];
+|  int   n;
+|
+|  Start reading ahead the 'n' files named in 'argv[]'.
+`------------------------------------------------------------------------*/
+
+void  batch_open (argv, n)
+char  *argv[];
+int   n;
+{
+    names = argv;
+    nfiles = n;
+    next_file = next_submit = 0;
+    files = (bfile_t *) mem_alloc(MEM_IO, n * sizeof(bfile_t));
+
+#ifdef USE_IO_URING
+    ring_setup();
+    while (ring.fd >= 0 && next_submit < nfiles && next_submit < BATCH_WINDOW)
+	submit_open(next_submit++);
+#endif
+}
+
+/*-------------------------------------------------------------------------
+|  int  batch_next (sc)
+|  scan_t  *sc;
+|
+|  Wait for the next file of the batch and set up 'sc' to scan it.
+|  Return 0, or the errno value of a failed open / read (in which case
+|  'sc' is not set up).
+`------------------------------------------------------------------------*/
+
+int  batch_next (sc)
+scan_t  *sc;
+{
+    bfile_t  *f = &files[next_file];
+
+    if (scan_fd >= 0) {		/* the previous file is scanned */
+	close(scan_fd);
+	scan_fd = -1;
+    }
+    trace_begin("batch_wait", "file", names[next_file]);
+#ifdef USE_IO_URING
+    if (ring.fd >= 0) {
+	/* keep the window full */
+	while (next_submit < nfiles && next_submit <= next_file + BATCH_WINDOW)
+	    submit_open(next_submit++);
+	while (ring.fd >= 0 && (f->state == F_OPENING || f->state == F_READING))
+	    ring_wait();
+    }
+#endif
+    if (f->state == F_IDLE)         /* no io_uring: plain open & read */
+	load_sync(f, names[next_file]);
+    trace_end("batch_wait");
+
+    next_file++;
+    if (f->state == F_ERROR) {
+	mem_free(f->buf);
+	return f->err;
+    }
+    if (f->state == F_OPEN) {	/* not read ahead: map or stream it */
+	scan_open(sc, f->fd);
+	scan_fd = f->fd;
+	return 0;
+    }
+    scan_buffer(sc, f->buf, f->len);  /* 'sc' now owns the buffer */
+    f->buf = NULL;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------
+|  void  batch_close ()
+|
+|  Release the batch (and the ring).
+`------------------------------------------------------------------------*/
+
+void  batch_close ()
+{
+    if (scan_fd >= 0) {
+	close(scan_fd);
+	scan_fd = -1;
+    }
+#ifdef USE_IO_URING
+    if (ring.fd >= 0) {
+	ring_unmap();
+	close(ring.fd);
+	ring.fd = -1;
+    }
+#endif
+    mem_free(files);
+    files = NULL;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  load_sync (f, name)
+|  bfile_t  *f;
+|  char     *name;
+|
+|  The fallback: open and read the file 'name' right away.
+`------------------------------------------------------------------------*/
+
+static void  load_sync (f, name)
+bfile_t  *f;
+char     *name;
+{
+    if ((f->fd = open(name, O_RDONLY)) < 0) {
+	f->state = F_ERROR;
+	f->err = errno;
+	return;
+    }
+    if (! read_ahead(f))
+	return;
+    f->size = BATCH_BUF;
+    f->len = 0;
+    f->buf = (char *) mem_alloc(MEM_IO, f->size);
+    read_rest(f);
+}
+
+/*-------------------------------------------------------------------------
+|  static int  read_ahead (f)
+|  bfile_t  *f;
+|
+|  Return TRUE if the file open on 'f->fd' is to be read ahead: a
+|  regular file of at most BATCH_BUF bytes. Otherwise it is left open
+|  for scan_open() (F_OPEN).
+`------------------------------------------------------------------------*/
+
+static int  read_ahead (f)
+bfile_t  *f;
+{
+    struct stat  st;
+
+    if (fstat(f->fd, &st) == 0 && S_ISREG(st.st_mode)
+	&& st.st_size <= BATCH_BUF)
+	return TRUE;
+    f->state = F_OPEN;
+    return FALSE;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  read_rest (f)
+|  bfile_t  *f;
+|
+|  Read the file 'f' from 'f->len' on to its end with plain read()s,
+|  growing its buffer as needed, then close it.
+`------------------------------------------------------------------------*/
+
+static void  read_rest (f)
+bfile_t  *f;
+{
+    ssize_t  n;
+    char     *nbuf;
+
+    for (;;) {
+	if (f->len == f->size) {
+	    nbuf = (char *) mem_alloc(MEM_IO, 2 * f->size);
+	    memcpy(nbuf, f->buf, f->len);
+	    mem_free(f->buf);
+	    f->buf = nbuf;
+	    f->size *= 2;
+	}
+	if ((n = read(f->fd, f->buf + f->len, f->size - f->len)) <= 0)
+	    break;
+	f->len += n;
+    }
+    if (n < 0) {
+	f->state = F_ERROR;
+	f->err = errno;
+    } else
+	f->state = F_DONE;
+    close(f->fd);
+}
+
+#ifdef USE_IO_URING
+/*-------------------------------------------------------------------------
+|  static void  ring_setup ()
+|
+|  Create the io_uring and map its queues; leave ring.fd < 0 if that
+|  is not possible.
+`------------------------------------------------------------------------*/
+
+static void  ring_setup ()
+{
+    struct io_uring_params  p;
+    size_t                  sq_len, cq_len;
+    char                    *sq, *cq;
+
+    memset(&p, 0, sizeof(p));
+    ring.fd = (int) syscall(__NR_io_uring_setup, 2 * BATCH_WINDOW, &p);
+    if (ring.fd < 0)
+	return;
+
+    sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+	sq_len = cq_len = (sq_len > cq_len) ? sq_len : cq_len;
+
+    ring.sq_len = sq_len;
+    ring.cq_len = cq_len;
+    ring.sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sq = sq = (char *) mmap(NULL, sq_len, PROT_READ | PROT_WRITE,
+				 MAP_SHARED | MAP_POPULATE, ring.fd,
+				 IORING_OFF_SQ_RING);
+    ring.cq = cq = (p.features & IORING_FEAT_SINGLE_MMAP) ? sq :
+	 (char *) mmap(NULL, cq_len, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    ring.sqes = (struct io_uring_sqe *)
+		mmap(NULL, ring.sqes_len, PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+    if (sq == (char *) MAP_FAILED || cq == (char *) MAP_FAILED
+	|| ring.sqes == (struct io_uring_sqe *) MAP_FAILED) {
+	ring_unmap();
+	close(ring.fd);
+	ring.fd = -1;
+	return;
+    }
+
+    ring.sq_head = (unsigned *) (sq + p.sq_off.head);
+    ring.sq_tail = (unsigned *) (sq + p.sq_off.tail);
+    ring.sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+    ring.sq_array = (unsigned *) (sq + p.sq_off.array);
+    ring.cq_head = (unsigned *) (cq + p.cq_off.head);
+    ring.cq_tail = (unsigned *) (cq + p.cq_off.tail);
+    ring.cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+    ring.pending = ring.inflight = 0;
+    ring.giving_up = FALSE;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  ring_unmap ()
+|
+|  Unmap the queues of the io_uring (those mapped by ring_setup()).
+`------------------------------------------------------------------------*/
+
+static void  ring_unmap ()
+{
+    if (ring.sqes != NULL && ring.sqes != (struct io_uring_sqe *) MAP_FAILED)
+	munmap((char *) ring.sqes, ring.sqes_len);
+    if (ring.cq != NULL && ring.cq != (char *) MAP_FAILED && ring.cq != ring.sq)
+	munmap(ring.cq, ring.cq_len);
+    if (ring.sq != NULL && ring.sq != (char *) MAP_FAILED)
+	munmap(ring.sq, ring.sq_len);
+    ring.sq = ring.cq = NULL;
+    ring.sqes = NULL;
+}
+
+/*-------------------------------------------------------------------------
+|  static struct io_uring_sqe  *get_sqe (user_data)
+|  unsigned long long  user_data;
+|
+|  Queue a cleared submission entry tagged 'user_data' and return it.
+|  (At most 2 * BATCH_WINDOW requests are ever in flight, which is the
+|  size of the ring, so it can not overflow.)
+`------------------------------------------------------------------------*/
+
+static struct io_uring_sqe  *get_sqe (user_data)
+unsigned long long  user_data;
+{
+    unsigned             tail = *ring.sq_tail;
+    unsigned             idx = tail & *ring.sq_mask;
+    struct io_uring_sqe  *sqe = &ring.sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = user_data;
+    ring.sq_array[idx] = idx;
+    __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring.pending++;
+    return sqe;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  submit_open (i)
+|  int  i;
+|
+|  Queue the OPENAT request of file 'i'.
+`------------------------------------------------------------------------*/
+
+static void  submit_open (i)
+int  i;
+{
+    struct io_uring_sqe  *sqe = get_sqe((unsigned long long) i);
+
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (unsigned long) names[i];
+    sqe->open_flags = O_RDONLY;
+    files[i].state = F_OPENING;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  submit_read (i)
+|  int  i;
+|
+|  Queue the READ request of the (open) file 'i' into a new buffer, or
+|  leave it open for scan_open() if it is not to be read ahead.
+`------------------------------------------------------------------------*/
+
+static void  submit_read (i)
+int  i;
+{
+    bfile_t              *f = &files[i];
+    struct io_uring_sqe  *sqe;
+
+    if (! read_ahead(f))
+	return;
+    sqe = get_sqe((unsigned long long) i);
+    f->size = BATCH_BUF;
+    f->len = 0;
+    f->buf = (char *) mem_alloc(MEM_IO, f->size);
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = f->fd;
+    sqe->addr = (unsigned long) f->buf;
+    sqe->len = (unsigned) f->size;
+    sqe->off = (unsigned long long) -1;	/* at (& advance) the file position */
+    f->state = F_READING;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  ring_wait ()
+|
+|  Submit the queued requests, wait for at least one completion and
+|  handle all the completions available:
+|	open completed  ->  queue the file's read (unless it is not
+|			    read ahead)
+|	read completed  ->  the file is done (if the buffer filled up,
+|			    the rest is read synchronously)
+|  If the kernel turns the requests down (an old kernel without OPENAT
+|  or READ, a seccomp filter...) io_uring is given up: the requests
+|  still in flight are drained, and every file not done yet is left to
+|  the plain open & read fallback.
+`------------------------------------------------------------------------*/
+
+static void  ring_wait ()
+{
+    unsigned  head;
+    int       i, res;
+    bfile_t   *f;
+
+    if (syscall(__NR_io_uring_enter, ring.fd, ring.pending, 1,
+		IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+	if (errno == EINTR)
+	    return;
+	ring.pending = 0;
+	ring.giving_up = TRUE;
+    } else {
+	ring.inflight += ring.pending;
+	ring.pending = 0;
+    }
+
+    for (;;) {
+	head = *ring.cq_head;
+	while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+	    i = (int) ring.cqes[head & *ring.cq_mask].user_data;
+	    res = ring.cqes[head & *ring.cq_mask].res;
+	    head++;
+	    ring.inflight--;
+	    f = &files[i];
+
+	    if (res == -EINVAL || res == -EOPNOTSUPP)
+		ring.giving_up = TRUE;
+
+	    if (f->state == F_OPENING) {
+		if (res >= 0 && ring.giving_up) {
+		    close(res);
+		    f->state = F_IDLE;
+		} else if (res < 0) {
+		    f->state = ring.giving_up ? F_IDLE : F_ERROR;
+		    f->err = -res;
+		} else {
+		    f->fd = res;
+		    submit_read(i);
+		}
+	    } else if (f->state == F_READING) {
+		if (ring.giving_up) {
+		    close(f->fd);
+		    mem_free(f->buf);
+		    f->buf = NULL;
+		    f->state = F_IDLE;
+		} else if (res < 0) {
+		    f->state = F_ERROR;
+		    f->err = -res;
+		    close(f->fd);
+		} else {
+		    f->len = res;
+		    if (f->len == f->size)   /* may be more: read the rest */
+			read_rest(f);
+		    else {
+			f->state = F_DONE;
+			close(f->fd);
+		    }
+		}
+	    }
+	}
+	__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+	if (! ring.giving_up)
+	    return;
+
+	/* drain whatever the kernel still holds, then drop the ring */
+	if (ring.inflight == 0
+	    || syscall(__NR_io_uring_enter, ring.fd, 0, 1,
+		       IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+	    break;
+    }
+
+    ring_unmap();
+    close(ring.fd);
+    ring.fd = -1;
+    for (i = next_file; i < nfiles; i++) {
+	f = &files[i];
+	if (f->state == F_OPENING)	/* never submitted */
+	    f->state = F_IDLE;
+	else if (f->state == F_READING) {  /* queued, never submitted */
+	    close(f->fd);
+	    mem_free(f->buf);
+	    f->buf = NULL;
+	    f->state = F_IDLE;
+	}
+    }
+}
+#endif
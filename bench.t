@@ -0,0 +1,153 @@
+#!/bin/bash
+#
+# Cross-engine differential benchmark & verification for minauto
+#
+# Every engine is run on the corpus (io/inp.*) and on generated DFAs:
+#   - each result is checked equivalent to its input (minauto -v),
+#   - the canonical outputs (minauto -c) of all engines must be identical,
+#   - the refinement time of each engine (best of $reps runs) is tabled.
+# Engines that do not apply to an input (e.g. "acyclic" on a DFA with a
+# cycle) are reported as n/a. Engines that can use other transition
+# layouts (see minauto -l) are also run with each of them forced
+# (columns engine/layout, listed in $layout_configs).
+#
+# The table (also saved in bench_output.txt) is the data behind the
+# engine-selection heuristics.
+#
+# Usage: bench.t [reps]
+#        Larger DFAs need a minauto built with a large MAX_STATES,
+#        see 'make bench'.
+#
+reps=${1:-3}
+tmp=/tmp/bench.$$
+mkdir -p $tmp
+fail=0
+table=bench_output.txt
+
+engines=$(./minauto -e '?' 2>&1 | sed -n 's/^Engines: //p')
+layout_configs="hopcroft/row hopcroft/col hopcroft/packed acyclic/packed"
+configs="$engines $layout_configs"
+
+#
+# -- gen n k density dup shape seed
+#    A random DFA with 'n' states over 'k' symbols: each transition is
+#    defined with probability 'density'. For shape "dag" transitions only
+#    go to higher numbered states (an acyclic DFA), for "nac" (nearly
+#    acyclic) 5% of them go back instead, within aligned groups of 4
+#    states (small loops), for "cyc" they go anywhere. For dup > 1 the DFA is built
+#    from n/dup "core" states, each replicated 'dup' times with every
+#    transition going to a random replica of its target, so that it
+#    minimizes to (at most) n/dup states.
+#
+gen() {
+    awk -v n=$1 -v k=$2 -v dens=$3 -v dup=$4 -v shape=$5 -v seed=$6 'BEGIN {
+	srand(seed)
+	m = int(n / dup); n = m * dup
+	for (c = 0; c < m; c++) {
+	    acc[c] = (rand() < 0.3)
+	    for (j = 0; j < k; j++)
+		if (shape == "dag" || shape == "nac") {
+		    core[c, j] = (rand() < dens && c < m - 1) ? c + 1 + int(rand() * (m - c - 1)) : -1
+		    if (shape == "nac" && core[c, j] >= 0 && rand() < 0.05)
+			core[c, j] = c - int(rand() * (c % 4 + 1))
+		} else
+		    core[c, j] = (rand() < dens) ? int(rand() * m) : -1
+	}
+	printf "%d %d\n\n", n, k
+	for (j = 0; j < k; j++)
+	    printf "%c ", (j < 26) ? sprintf("%c", 97 + j) : sprintf("%c", 65 + j - 26)
+	printf "\n\n"
+	for (s = 0; s < n; s++) {
+	    c = s % m
+	    for (j = 0; j < k; j++) {
+		t = core[c, j]
+		printf "%d ", (t < 0) ? -1 : t + m * int(rand() * dup)
+	    }
+	    printf "\n"
+	}
+	printf "\n"
+	for (s = 0; s < n; s++)
+	    if (acc[s % m]) printf "%d ", s
+	printf "\n"
+    }'
+}
+
+#
+# -- Inputs: the corpus + generated cases (n k density dup shape)
+#    Corpus inputs that io/opt.X reads in another format than the DFA
+#    one are left out: NFAs (-n), alphabets of words (-k) and LTSs (-b).
+#
+inputs=
+for inp in io/inp.*; do
+    opt="$(echo $inp | sed 's,inp,opt,')"
+    case " $(cat $opt 2>/dev/null) " in
+    *" -n "* | *" -k "* | *" -b "*) ;;
+    *) inputs="$inputs $inp" ;;
+    esac
+done
+seed=1
+for spec in "20 2 1.0 1 cyc" "20 2 1.0 4 cyc" "40 10 0.3 4 cyc" \
+	    "40 4 0.8 2 dag" "64 2 1.0 2 cyc" "64 26 0.2 2 cyc" \
+	    "100 2 1.0 1 cyc" "100 4 1.0 10 cyc" "100 26 0.2 5 cyc" \
+	    "100 26 0.5 5 cyc" "100 8 0.5 4 dag" \
+	    "400 2 1.0 1 cyc" "400 8 0.5 20 cyc" "400 52 0.1 4 cyc" \
+	    "400 52 0.3 4 cyc" "400 26 0.3 8 dag" \
+	    "1000 4 1.0 50 cyc" "1000 26 0.3 10 cyc" "1000 4 0.7 5 dag" \
+	    "1000 64 1.0 20 cyc" "1000 64 0.3 10 cyc" "1000 64 0.05 10 cyc" \
+	    "40 4 0.8 2 nac" "100 8 0.5 4 nac" "400 26 0.3 8 nac" \
+	    "1000 4 0.7 5 nac" "1000 26 0.3 2 nac" "1000 8 0.5 1 nac"; do
+    set -- $spec
+    f=$tmp/gen.$1.$2.$4.$5.d$3
+    gen $1 $2 $3 $4 $5 $seed > $f
+    seed=$(($seed+1))
+    # skip what this build of minauto (MAX_STATES) cannot hold
+    ./minauto $f | grep -q 'too large' || inputs="$inputs $f"
+done
+
+printf "%-26s %6s %6s" input states min > $table
+for c in $configs; do printf " %13s" "$c(us)" >> $table; done
+printf " %13s\n" fastest >> $table
+
+for inp in $inputs; do
+    ref=
+    best=
+    row=
+    for c in $configs; do
+	e=${c%/*}
+	opts="-e $e"
+	[ $c = $e ] || opts="$opts -l ${c#*/}"
+	c=${c/\//-}
+	t=
+	for r in $(seq $reps); do
+	    if ! ./minauto -s -c -v $opts $inp >$tmp/out.$c 2>$tmp/stats.$c; then
+		grep -q 'does not apply' $tmp/out.$c && { t=n/a; break; }
+		echo "=== $inp: $opts FAILED"; cat $tmp/out.$c $tmp/stats.$c
+		fail=$(($fail+1))
+		t=FAILED
+		break
+	    fi
+	    u=$(sed -n 's/^ *refine usec *//p' $tmp/stats.$c)
+	    [ -z "$t" ] || [ $u -lt $t ] && t=$u
+	done
+	row="$row $(printf ' %13s' $t)"
+	[ "$t" = n/a ] || [ "$t" = FAILED ] && continue
+	if [ -z "$ref" ]; then
+	    ref=$c
+	elif ! cmp -s $tmp/out.$ref $tmp/out.$c; then
+	    echo "=== $inp: $ref and $c disagree"
+	    diff $tmp/out.$ref $tmp/out.$c
+	    fail=$(($fail+1))
+	fi
+	[ $e = auto ] && continue
+	[ -z "$best" ] || [ "$t" -lt "$bt" ] && { best=$c; bt=$t; }
+    done
+    states=$(sed -n 's/^ *states *\([0-9]*\) .*(\([0-9]*\) live).*/\1 \2/p' $tmp/stats.$ref)
+    printf "%-26s %6s %6s%s %13s\n" $(basename $inp) $states "$row" $best >> $table
+done
+
+cat $table
+echo $fail differential failures
+
+# -- Cleanup
+rm -rf $tmp
+[ $fail -eq 0 ]
@@ -0,0 +1,455 @@
+/*-------------------------------------------------------------------------*\
+|  Module "bisim.c"
+|
+|  Minimizing labelled transition systems modulo strong bisimulation
+|  (the -b option): R. Paige & R. E. Tarjan's O(m log n) relational
+|  coarsest partition refinement ("Three partition refinement
+|  algorithms", 1987), on top of the refinable partition of module
+|  "rpart.c", as the DFA engines.
+|
+|  An LTS is given as an NFA (see module "inout.c"): its states, and its
+|  edges labelled by the letters of the alphabet; its accept states, if
+|  any, are a property the quotient keeps (the initial partition
+|  separates them from the others). Two states are bisimilar iff on
+|  every letter each one's edges lead to states bisimilar to the
+|  targets of some of the other's.
+|
+|  Besides the partition of the states into blocks (P), the algorithm
+|  keeps a coarser partition into compound blocks (X), each a union of
+|  blocks, such that P is stable with respect to every compound block:
+|  for every letter, within a block either all or none of the states
+|  have an edge into it. While some compound block S holds more than
+|  one block, the smaller of two of its blocks, B, is taken out of it
+|  as a compound block of its own, and for every letter 'a' P is split
+|  three ways: the states with an a-edge into B, and among them those
+|  without any a-edge into the rest of S. To tell these apart without
+|  looking at the edges into S \ B, every edge (x, a, y) points to a
+|  counter of the a-edges from x into the compound block of y. The
+|  edges into B are the only ones looked at, and since B is the smaller
+|  part, every edge is looked at O(log n) times.
+\*-------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+
+#include "auto.h"
+
+extern void  rp_init ();
+extern void  rp_free ();
+extern void  rp_mark ();
+extern int   rp_split ();
+
+void  trace_begin ();
+void  trace_end ();
+void  free_nfa ();
+
+static rpart_t  P;		/* the blocks: states 1 .. n as 0 .. n-1 */
+static int      *new_sets;
+
+/*
+ |  The compound blocks: a list of the blocks of each (xof[b]: that of
+ |  block 'b'), and a work-list of those with more than one
+ */
+static int   nx;
+static int   *xof, *xnext, *xprev, *xhead, *xcount;
+static int   *work, nwork;
+static char  *in_work;
+
+/*
+ |  The counters of edges: ecnt[e] is the counter of edge 'e', rcnt[r]
+ |  the count of counter 'r'; unused counters are in rfree[]
+ */
+static int   *ecnt, *rcnt, *rfree, nfree;
+
+static void  add_block ();
+static void  split ();
+static int   new_counter ();
+static int   cmp_pairs ();
+
+/*-------------------------------------------------------------------------
+|  int  bisim_refine (nfa, block)
+|  nfa_t  *nfa;
+|  int    block[];
+|
+|  Partition the states of the LTS 'nfa' into bisimulation classes: set
+|  block[s] (s = 1 .. nstates) to the class of state 's', classes being
+|  numbered 1, 2 ... in the order of their first states. Return the
+|  number of compound blocks split.
+`------------------------------------------------------------------------*/
+
+int  bisim_refine (nfa, block)
+nfa_t  *nfa;
+int    block[];
+{
+    int      n = nfa->nstates, m = nfa->nedges, nab = nfa->nab;
+    state_t  *esrc, *bs, *srcs, x;
+    int      *in_first, *in_edge, *first, *by_sym, *lcnt, *labs;
+    int      *seen, *newc, *oldc, stamp = 0;
+    int      i, j, e, a, b, B, S, nbs, nlabs, nsrcs, r = 0, k, steps = 0;
+
+    trace_begin("bisim", NULL, NULL);
+    esrc = (state_t *) mem_alloc(MEM_INVERSE, (m + 1) * sizeof(state_t));
+    in_first = (int *) mem_alloc(MEM_INVERSE, (n + 2) * sizeof(int));
+    in_edge = (int *) mem_alloc(MEM_INVERSE, (m + 1) * sizeof(int));
+    by_sym = (int *) mem_alloc(MEM_INVERSE, (m + 1) * sizeof(int));
+    first = (int *) mem_alloc(MEM_INVERSE, (nab + 2) * sizeof(int));
+    lcnt = (int *) mem_alloc(MEM_CLASSES, (nab + 1) * sizeof(int));
+    labs = (int *) mem_alloc(MEM_CLASSES, (nab + 1) * sizeof(int));
+    bs = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    srcs = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    seen = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    newc = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    oldc = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    ecnt = (int *) mem_alloc(MEM_CLASSES, (m + 1) * sizeof(int));
+    rcnt = (int *) mem_alloc(MEM_CLASSES, (2 * m + 1) * sizeof(int));
+    rfree = (int *) mem_alloc(MEM_CLASSES, (2 * m + 1) * sizeof(int));
+    new_sets = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    xof = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    xnext = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    xprev = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    xhead = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    xcount = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    work = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    in_work = (char *) mem_alloc(MEM_CLASSES, n + 1);
+
+    /* the edges into every state, and the edges by symbol */
+    for (x = 1; x <= n; x++)
+	for (e = nfa->first[x]; e < nfa->first[x + 1]; e++) {
+	    esrc[e] = x;
+	    in_first[nfa->to[e] + 1]++;
+	    first[nfa->sym[e] + 1]++;
+	}
+    for (x = 1; x <= n + 1; x++)
+	in_first[x] += in_first[x - 1];
+    for (a = 1; a <= nab + 1; a++)
+	first[a] += first[a - 1];
+    for (e = 0; e < m; e++) {
+	in_edge[in_first[nfa->to[e]]++] = e;
+	by_sym[first[nfa->sym[e]]++] = e;
+    }
+    for (x = n + 1; x > 0; x--)		/* back to the starts */
+	in_first[x] = in_first[x - 1];
+    in_first[0] = 0;
+    for (a = nab + 1; a > 0; a--)
+	first[a] = first[a - 1];
+    first[0] = 0;
+
+    /* one counter per state & symbol: its edges, all into the single
+       compound block */
+    for (r = 2 * m; r >= 1; r--)
+	rfree[nfree++] = r;
+    for (x = 1; x <= n; x++)
+	for (e = nfa->first[x]; e < nfa->first[x + 1]; e++) {
+	    if (e == nfa->first[x] || nfa->sym[e] != nfa->sym[e - 1])
+		r = new_counter();
+	    rcnt[r]++;
+	    ecnt[e] = r;
+	}
+
+    /* initial partition: accept states / other states, made stable with
+       respect to the whole set (states with an edge on a symbol / not) */
+    rp_init(&P, n);
+    nx = 1;
+    xhead[0] = -1;
+    add_block(0, 0);
+    for (x = 1; x <= n; x++)
+	if (nfa->accept[x])
+	    rp_mark(&P, x - 1);
+    split();
+    for (a = 1; a <= nab; a++) {
+	for (i = first[a]; i < first[a + 1]; i++)
+	    rp_mark(&P, esrc[by_sym[i]] - 1);
+	split();
+    }
+
+    while (nwork > 0) {
+	S = work[--nwork];
+	in_work[S] = FALSE;
+	if (xcount[S] < 2)
+	    continue;
+	steps++;
+
+	/* take the smaller of two blocks out of S */
+	b = xnext[xhead[S]];
+	B = (P.end[b] - P.first[b] < P.end[xhead[S]] - P.first[xhead[S]])
+	    ? b : xhead[S];
+	if (xprev[B] >= 0)
+	    xnext[xprev[B]] = xnext[B];
+	else
+	    xhead[S] = xnext[B];
+	if (xnext[B] >= 0)
+	    xprev[xnext[B]] = xprev[B];
+	if (--xcount[S] >= 2 && ! in_work[S]) {
+	    work[nwork++] = S;
+	    in_work[S] = TRUE;
+	}
+	xhead[nx] = -1;
+	add_block(B, nx++);
+
+	/*
+	 | The edges into B, grouped by symbol (copy its states first:
+	 | splitting may reorder the slice of 'elems[]' that holds them)
+	 */
+	nbs = 0;
+	for (i = P.first[B]; i < P.end[B]; i++)
+	    bs[nbs++] = P.elems[i] + 1;
+	nlabs = 0;
+	for (i = 0; i < nbs; i++)
+	    for (j = in_first[bs[i]]; j < in_first[bs[i] + 1]; j++)
+		if (lcnt[a = nfa->sym[in_edge[j]]]++ == 0)
+		    labs[nlabs++] = a;
+	for (k = 0, j = 0; k < nlabs; k++) {
+	    a = labs[k];
+	    first[a] = j;
+	    j += lcnt[a];
+	    lcnt[a] = first[a];		/* now the next free position */
+	}
+	for (i = 0; i < nbs; i++)
+	    for (j = in_first[bs[i]]; j < in_first[bs[i] + 1]; j++) {
+		e = in_edge[j];
+		by_sym[lcnt[nfa->sym[e]]++] = e;
+	    }
+
+	for (k = 0; k < nlabs; k++) {
+	    a = labs[k];
+
+	    /* the states with an a-edge into B, and their a-edges into it */
+	    nsrcs = 0;
+	    stamp++;
+	    for (i = first[a]; i < lcnt[a]; i++) {
+		e = by_sym[i];
+		if (seen[x = esrc[e]] != stamp) {
+		    seen[x] = stamp;
+		    srcs[nsrcs++] = x;
+		    newc[x] = new_counter();
+		    oldc[x] = ecnt[e];
+		    rp_mark(&P, x - 1);
+		}
+		rcnt[newc[x]]++;
+	    }
+	    split();
+
+	    /* ... of which those with no a-edge into the rest of S */
+	    for (i = 0; i < nsrcs; i++)
+		if (rcnt[oldc[srcs[i]]] == rcnt[newc[srcs[i]]])
+		    rp_mark(&P, srcs[i] - 1);
+	    split();
+
+	    /* the edges into B now count apart */
+	    for (i = first[a]; i < lcnt[a]; i++) {
+		e = by_sym[i];
+		if (--rcnt[r = ecnt[e]] == 0)
+		    rfree[nfree++] = r;
+		ecnt[e] = newc[esrc[e]];
+	    }
+	    lcnt[a] = 0;
+	}
+    }
+
+    /* number the classes by their first states */
+    for (b = 0; b < P.nsets; b++)
+	xof[b] = 0;
+    for (x = 1, k = 0; x <= n; x++) {
+	if (xof[b = P.sidx[x - 1]] == 0)
+	    xof[b] = ++k;
+	block[x] = xof[b];
+    }
+
+    rp_free(&P);
+    mem_free(in_work);
+    mem_free(work);
+    mem_free(xcount);
+    mem_free(xhead);
+    mem_free(xprev);
+    mem_free(xnext);
+    mem_free(xof);
+    mem_free(new_sets);
+    mem_free(rfree);
+    mem_free(rcnt);
+    mem_free(ecnt);
+    mem_free(oldc);
+    mem_free(newc);
+    mem_free(seen);
+    mem_free(srcs);
+    mem_free(bs);
+    mem_free(labs);
+    mem_free(lcnt);
+    mem_free(first);
+    mem_free(by_sym);
+    mem_free(in_edge);
+    mem_free(in_first);
+    mem_free(esrc);
+    nfree = nwork = 0;
+    trace_end("bisim");
+    return steps;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  split ()
+|
+|  Split the blocks with marked states; the new blocks join the compound
+|  blocks of the blocks they were split from.
+`------------------------------------------------------------------------*/
+
+static void  split ()
+{
+    int  i, count = rp_split(&P, new_sets);
+
+    for (i = 0; i < count; i++)
+	add_block(new_sets[i], xof[P.split_from[new_sets[i]]]);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  add_block (b, X)
+|  int  b, X;
+|
+|  Add the block 'b' to the compound block 'X', which goes to the
+|  work-list when it gets a second block.
+`------------------------------------------------------------------------*/
+
+static void  add_block (b, X)
+int  b, X;
+{
+    xof[b] = X;
+    xprev[b] = -1;
+    if ((xnext[b] = xhead[X]) >= 0)
+	xprev[xhead[X]] = b;
+    xhead[X] = b;
+    if (++xcount[X] == 2 && ! in_work[X]) {
+	work[nwork++] = X;
+	in_work[X] = TRUE;
+    }
+}
+
+/*-------------------------------------------------------------------------
+|  static int  new_counter ()
+|
+|  Return an unused edge counter, set to 0. (At most 2m are ever in
+|  use: one per edge, and one per edge being moved to a new one.)
+`------------------------------------------------------------------------*/
+
+static int  new_counter ()
+{
+    int  r = rfree[--nfree];
+
+    rcnt[r] = 0;
+    return r;
+}
+
+/*-------------------------------------------------------------------------
+|  void  bisim_quotient (nfa, block, q)
+|  nfa_t  *nfa, *q;
+|  int    block[];
+|
+|  Make 'q' the quotient of the LTS 'nfa' by its partition 'block[]'
+|  (see bisim_refine()): a state per class, and an edge on a symbol
+|  between two classes iff some state of the first has one into the
+|  second. Class 1, that of the initial state, is initial.
+`------------------------------------------------------------------------*/
+
+void  bisim_quotient (nfa, block, q)
+nfa_t  *nfa, *q;
+int    block[];
+{
+    int      *pairs, *rep, n, e, i, k, len;
+    state_t  x;
+
+    for (x = 1, n = 0; x <= nfa->nstates; x++)
+	if (block[x] > n)
+	    n = block[x];
+    q->nstates = n;
+    q->nab = nfa->nab;
+    rep = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    for (x = nfa->nstates; x >= 1; x--)
+	rep[block[x]] = x;
+
+    /* the edges of the first state of every class, on classes: the same
+       (once duplicates are dropped) as those of any other state of it */
+    pairs = (int *) mem_alloc(MEM_CLASSES, 2 * (nfa->nedges + 1) * sizeof(int));
+    q->first = (int *) mem_alloc(MEM_AUTOMATON, (n + 2) * sizeof(int));
+    q->accept = (char *) mem_alloc(MEM_AUTOMATON, n + 1);
+    for (k = 1, q->nedges = 0; k <= n; k++) {
+	x = rep[k];
+	len = 0;
+	for (e = nfa->first[x]; e < nfa->first[x + 1]; e++) {
+	    pairs[2 * (q->nedges + len)] = nfa->sym[e];
+	    pairs[2 * (q->nedges + len++) + 1] = block[nfa->to[e]];
+	}
+	qsort((char *) &pairs[2 * q->nedges], len, 2 * sizeof(int), cmp_pairs);
+	q->first[k] = q->nedges;
+	for (i = 0; i < len; i++)
+	    if (i == 0 || cmp_pairs(&pairs[2 * (q->first[k] + i)],
+				    &pairs[2 * q->nedges - 2]) != 0) {
+		pairs[2 * q->nedges] = pairs[2 * (q->first[k] + i)];
+		pairs[2 * q->nedges + 1] = pairs[2 * (q->first[k] + i) + 1];
+		q->nedges++;
+	    }
+	q->accept[k] = nfa->accept[x];
+    }
+    q->first[n + 1] = q->nedges;
+
+    q->sym = (int *) mem_alloc(MEM_AUTOMATON, (q->nedges + 1) * sizeof(int));
+    q->to = (state_t *) mem_alloc(MEM_AUTOMATON,
+				  (q->nedges + 1) * sizeof(state_t));
+    for (e = 0; e < q->nedges; e++) {
+	q->sym[e] = pairs[2 * e];
+	q->to[e] = pairs[2 * e + 1];
+    }
+    mem_free(pairs);
+    mem_free(rep);
+}
+
+/*-------------------------------------------------------------------------
+|  int  bisim_check (nfa, block)
+|  nfa_t  *nfa;
+|  int    block[];
+|
+|  Return TRUE iff the partition 'block[]' of the states of 'nfa' is a
+|  bisimulation: the states of every class agree on accepting, and have
+|  edges on the same symbols into the same classes.
+`------------------------------------------------------------------------*/
+
+int  bisim_check (nfa, block)
+nfa_t  *nfa;
+int    block[];
+{
+    nfa_t    q;
+    int      *pairs, e, i, j, len, ok = TRUE;
+    state_t  x;
+
+    bisim_quotient(nfa, block, &q);
+    pairs = (int *) mem_alloc(MEM_CLASSES, 2 * (nfa->nedges + 1) * sizeof(int));
+    for (x = 1; x <= nfa->nstates && ok; x++) {
+	len = 0;
+	for (e = nfa->first[x]; e < nfa->first[x + 1]; e++) {
+	    pairs[2 * len] = nfa->sym[e];
+	    pairs[2 * len++ + 1] = block[nfa->to[e]];
+	}
+	qsort((char *) pairs, len, 2 * sizeof(int), cmp_pairs);
+	for (i = j = 0; i < len; i++)
+	    if (i == 0 || cmp_pairs(&pairs[2 * i], &pairs[2 * i - 2]) != 0) {
+		e = q.first[block[x]] + j++;
+		if (e >= q.first[block[x] + 1] || q.sym[e] != pairs[2 * i]
+		    || q.to[e] != pairs[2 * i + 1])
+		    ok = FALSE;
+	    }
+	if (j != q.first[block[x] + 1] - q.first[block[x]]
+	    || q.accept[block[x]] != nfa->accept[x])
+	    ok = FALSE;
+    }
+    mem_free(pairs);
+    free_nfa(&q);
+    return ok;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  cmp_pairs (a, b)
+|  int  *a, *b;
+|
+|  qsort() comparison of two (symbol, class) pairs.
+`------------------------------------------------------------------------*/
+
+static int  cmp_pairs (a, b)
+int  *a, *b;
+{
+    return (a[0] != b[0]) ? a[0] - b[0] : a[1] - b[1];
+}
@@ -0,0 +1,90 @@
+/*-------------------------------------------------------------------------*\
+|  Module "canon.c"
+|
+|  Canonical numbering of a minimized DFA.
+|
+|  The state numbers of a minimized DFA depend on the engine that
+|  computed it (they follow the representatives chosen for every
+|  equivalence-class). Renumbering the live states in breadth-first
+|  order from the initial state, visiting successors in alphabet order,
+|  gives a numbering that depends on the language only: two minimal DFAs
+|  of the same language are canonically numbered into identical tables.
+\*-------------------------------------------------------------------------*/
+
+#include "auto.h"
+
+#define LIVE(S)	((S) > 0 && dfa->state_attrib[S] != 'D')
+
+/*-------------------------------------------------------------------------
+|  void  canon_dfa (dfa, map)
+|  automaton_t  *dfa;
+|  state_t      map[];
+|
+|  Renumber the live states of 'dfa' in canonical (breadth-first) order
+|  and drop its dead states. If 'map' is not NULL, map[old] is set to the
+|  new number of every old state (0 for dropped states).
+|  A DFA whose initial state is dead is left untouched.
+`------------------------------------------------------------------------*/
+
+void  canon_dfa (dfa, map)
+automaton_t  *dfa;
+state_t      map[];
+{
+    automaton_t  *tmp;
+    state_t      *order;	/* order[new] = old                */
+    state_t      *num;		/* num[old] = new (0: not reached) */
+    state_t      head, tail, s, t;
+    int          j, a_count = 0;
+
+    if (! LIVE(dfa->init_state))
+	return;
+
+    order = (state_t *) mem_alloc(MEM_CLASSES, (dfa->nstates + 1) * sizeof(state_t));
+    num = (state_t *) mem_alloc(MEM_CLASSES, (dfa->nstates + 1) * sizeof(state_t));
+    tmp = (automaton_t *) mem_alloc(MEM_AUTOMATON, sizeof(automaton_t));
+    tmp->nab = dfa->nab;
+    if (dfa->outs != NULL)
+	tmp->outs = (int *) mem_alloc(MEM_AUTOMATON, (size_t) (dfa->nstates + 1)
+				      * (dfa->nab + 1) * sizeof(int));
+
+    /* breadth-first numbering; 'order[]' doubles as the queue */
+    head = tail = 1;
+    order[tail] = dfa->init_state;
+    num[dfa->init_state] = tail++;
+    while (head < tail) {
+	s = order[head++];
+	for (j = 1; j <= dfa->nab; j++) {
+	    t = dfa->mat[s][j];
+	    if (LIVE(t) && num[t] == 0) {
+		order[tail] = t;
+		num[t] = tail++;
+	    }
+	}
+    }
+
+    for (s = 1; s < tail; s++) {
+	for (j = 1; j <= dfa->nab; j++) {
+	    t = dfa->mat[order[s]][j];
+	    tmp->mat[s][j] = LIVE(t) ? num[t] : 0;
+	    if (tmp->outs != NULL)
+		OUT(tmp, s, j) = OUT(dfa, order[s], j);
+	}
+	tmp->state_attrib[s] = dfa->state_attrib[order[s]];
+	if (tmp->state_attrib[s] == 'A')
+	    tmp->accept[a_count++] = s;
+    }
+    tmp->accept[a_count] = 0;
+    tmp->nstates = tail - 1;
+    tmp->init_state = 1;
+    mem_free(dfa->outs);
+
+    if (map != NULL)
+	for (s = 1; s <= dfa->nstates; s++)
+	    map[s] = num[s];
+
+    *dfa = *tmp;
+
+    mem_free(tmp);
+    mem_free(num);
+    mem_free(order);
+}
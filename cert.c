@@ -0,0 +1,280 @@
+/*-------------------------------------------------------------------------*\
+|  Module "cert.c"
+|
+|  Certificates of minimization results: a minimized DFA that comes from
+|  a cache, another machine or an experimental engine can be checked
+|  against the input DFA without minimizing it again.
+|
+|  The certificate of a DFA (written with the -z option) is the map of
+|  its states to those of the minimized DFA - their classes - followed
+|  by the minimized DFA itself, live states only, canonically numbered
+|  (see module "canon.c"):
+|               +----------------+
+|               |  NSTATES       |
+|               |  C0 C1 ... Cn  |
+|               |  the minimized |
+|               |  DFA, in the   |
+|               |  DFA input     |
+|               |  format        |
+|               +----------------+
+|  where NSTATES is the number of states of the DFA, and Ci the state of
+|  the minimized DFA of its state i, or -1 for the dead ones (and those
+|  not reached). The DFA of the empty language is one state, dead.
+|
+|  Checking it (the --verify option) takes a pass over the states of the
+|  DFA reached from the initial state, each with its class, as Hopcroft
+|  & Karp's equivalence test walks pairs of states: the classes must be
+|  a congruence - every transition of a state leads to the class its
+|  class goes to on the same symbol ("dead" being a class of its own,
+|  rejecting, that only goes to itself) - respecting accept states, and
+|  the initial state must be in the initial class; every state of the
+|  minimized DFA must be the class of some state reached. It is then the
+|  quotient of the DFA by the classes, and accepts the same language, in
+|  O(n k) for the n states & k symbols of the DFA.
+|
+|  That it is minimal is no property of the map: it's that no state of
+|  the minimized DFA is dead, and that no two are equivalent, which the
+|  refinement of its own states by Hopcroft's engine (module
+|  "hopcroft.c") tells, in O(m k log m) for its m states.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "auto.h"
+
+extern char     ab_map[];
+extern state_t  find ();
+extern int      scan_int ();
+extern void     scan_open ();
+extern void     scan_close ();
+extern void     input_dfa ();
+extern void     canon_dfa ();
+extern void     write_dfa ();
+extern int      hopcroft_refine ();
+
+void  trace_begin ();
+void  trace_end ();
+
+/*-------------------------------------------------------------------------
+|  void  cert_write (fp, in, out, groups)
+|  FILE         *fp;
+|  automaton_t  *in, *out;
+|  state_t      groups[];
+|
+|  Write to 'fp' the certificate of the DFA 'in', minimized into 'out'
+|  (dead states marked, not yet canonically numbered) by the classes
+|  'groups[]' (in Union-Find form, see module "ufind.c").
+`------------------------------------------------------------------------*/
+
+void  cert_write (fp, in, out, groups)
+FILE         *fp;
+automaton_t  *in, *out;
+state_t      groups[];
+{
+    automaton_t  *canon;
+    state_t      *rank, *num, i;
+    int          m, nrep = 0;
+
+    trace_begin("cert_write", NULL, NULL);
+    rank = (state_t *) mem_alloc(MEM_CLASSES,
+				 (in->nstates + 1) * sizeof(state_t));
+    num = (state_t *) mem_alloc(MEM_CLASSES,
+				(out->nstates + 1) * sizeof(state_t));
+    canon = (automaton_t *) mem_alloc(MEM_AUTOMATON, sizeof(automaton_t));
+    memcpy(canon, out, sizeof(automaton_t));
+
+    /* the states of 'out' are the classes, in the order of their
+       representatives (see compress_dfa() in module "main.c") */
+    for (i = 1; i <= in->nstates; i++)
+	if (find(i, groups) == i)
+	    rank[i] = ++nrep;
+    if (out->state_attrib[out->init_state] == 'D')
+	m = 0;				/* the empty language */
+    else {
+	canon_dfa(canon, num);
+	m = canon->nstates;
+    }
+
+    fprintf(fp, "%d\n", in->nstates);
+    for (i = 1; i <= in->nstates; i++)
+	fprintf(fp, "%d%c", (m > 0) ? num[rank[find(i, groups)]] - 1 : -1,
+		(i % 16 == 0 || i == in->nstates) ? '\n' : ' ');
+
+    write_dfa(fp, canon);
+    fflush(fp);
+
+    mem_free(canon);
+    mem_free(num);
+    mem_free(rank);
+    trace_end("cert_write");
+}
+
+/*-------------------------------------------------------------------------
+|  state_t  *cert_read (name, in, cert)
+|  char         *name;
+|  automaton_t  *in, *cert;
+|
+|  Read the certificate file 'name' of the DFA 'in': the minimized DFA
+|  into 'cert', and return the map of the states of 'in' to those of
+|  'cert' (0: dead), to be released with mem_free().
+`------------------------------------------------------------------------*/
+
+state_t  *cert_read (name, in, cert)
+char         *name;
+automaton_t  *in, *cert;
+{
+    scan_t   sc;
+    state_t  *map;
+    char     *ab;
+    int      n, c, fd;
+    state_t  i;
+
+    if ((fd = open(name, O_RDONLY)) < 0) {
+	perror(name);
+	exit(1);
+    }
+    scan_open(&sc, fd);
+    if (scan_int(&sc, &n) != TRUE || n != in->nstates)
+	Abort(("The certificate %s is not one of a DFA of %d states\n",
+	       name, in->nstates));
+    map = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    for (i = 1; i <= n; i++) {
+	if (scan_int(&sc, &c) != TRUE || c < -1)
+	    Abort(("Bad input while reading the classes of %s\n", name));
+	map[i] = c + 1;
+    }
+
+    ab = (char *) mem_alloc(MEM_CLASSES, in->nab + 1);
+    memcpy(ab, ab_map, in->nab + 1);
+    input_dfa(cert, &sc, 0);
+    scan_close(&sc);
+    if (cert->nab != in->nab || memcmp(ab, ab_map, in->nab + 1) != 0)
+	Abort(("The certificate %s is over another alphabet\n", name));
+    for (i = 1; i <= n; i++)
+	if (map[i] > cert->nstates)
+	    Abort(("Class %d (of state %d) out of range in %s\n",
+		   map[i] - 1, i - 1, name));
+    mem_free(ab);
+    return map;
+}
+
+/*-------------------------------------------------------------------------
+|  char  *cert_check (in, cert, map)
+|  automaton_t  *in, *cert;
+|  state_t      map[];
+|
+|  Check that 'cert' is the minimal DFA of the DFA 'in', by the map of
+|  the states of 'in' to those of 'cert' (0: dead) 'map[]'. Return NULL
+|  if it is, or else the reason why not.
+`------------------------------------------------------------------------*/
+
+char  *cert_check (in, cert, map)
+automaton_t  *in, *cert;
+state_t      map[];
+{
+    state_t  *queue, *seen, *groups, *inv_src, p, q, t;
+    int      *inv_start, n = in->nstates, m = cert->nstates, nab = in->nab;
+    int      head = 0, tail = 0, j, k;
+    char     *why = NULL;
+
+    trace_begin("cert_check", NULL, NULL);
+    queue = (state_t *) mem_alloc(MEM_CLASSES,
+				  ((n > m ? n : m) + 1) * sizeof(state_t));
+    seen = (state_t *) mem_alloc(MEM_CLASSES,
+				 ((n > m ? n : m) + 1) * sizeof(state_t));
+
+    if (cert->accept[0] == 0) {
+	/* the empty language: one dead state, the class of none */
+	if (m != 1)
+	    why = "a DFA of the empty language has more than one state";
+	for (j = 1; j <= nab && why == NULL; j++)
+	    if (cert->mat[1][j] != 0)
+		why = "a DFA of the empty language has transitions";
+	m = 0;
+    }
+    if (why == NULL && map[in->init_state] != (m > 0 ? cert->init_state : 0))
+	why = "the initial state is not in the initial class";
+
+    /* the states reached, with their classes (Hopcroft-Karp) */
+    queue[tail++] = in->init_state;
+    seen[in->init_state] = TRUE;
+    while (head < tail && why == NULL) {
+	p = queue[head++];
+	q = map[p];
+	if (q > m)
+	    why = "a class is not a state of the minimized DFA";
+	else if ((in->state_attrib[p] == 'A')
+		 != (q > 0 && cert->state_attrib[q] == 'A'))
+	    why = "the classes do not respect accept states";
+	for (j = 1; j <= nab && why == NULL; j++) {
+	    t = in->mat[p][j];
+	    if (map[t] != ((q > 0) ? cert->mat[q][j] : 0))
+		why = "the classes are not a congruence";
+	    else if (t > 0 && ! seen[t]) {
+		seen[t] = TRUE;
+		queue[tail++] = t;
+	    }
+	}
+    }
+
+    /* the quotient: every state of the minimized DFA is a class */
+    for (q = 1; q <= m; q++)
+	seen[q] = FALSE;
+    for (k = 0; k < tail; k++)
+	seen[map[queue[k]]] = TRUE;
+    for (q = 1; q <= m && why == NULL; q++)
+	if (! seen[q])
+	    why = "the minimized DFA has a state that is no class";
+
+    /* minimal: no state dead (all reach an accept state, backwards
+       from them through the predecessors: those of 't' are
+       inv_src[inv_start[t] .. inv_start[t + 1] - 1])... */
+    inv_start = (int *) mem_alloc(MEM_INVERSE, (m + 2) * sizeof(int));
+    inv_src = (state_t *) mem_alloc(MEM_INVERSE,
+				    ((size_t) m * nab + 1) * sizeof(state_t));
+    for (q = 1; q <= m; q++)
+	for (j = 1; j <= nab; j++)
+	    inv_start[cert->mat[q][j] + 1]++;
+    for (k = 1; k <= m + 1; k++)
+	inv_start[k] += inv_start[k - 1];
+    for (q = 1; q <= m; q++)
+	for (j = 1; j <= nab; j++)
+	    inv_src[inv_start[cert->mat[q][j]]++] = q;
+    for (k = m + 1; k > 0; k--)
+	inv_start[k] = inv_start[k - 1];
+    inv_start[0] = 0;
+    head = tail = 0;
+    for (q = 1; q <= m; q++)
+	if ((seen[q] = (cert->state_attrib[q] == 'A')))
+	    queue[tail++] = q;
+    while (head < tail)
+	for (t = queue[head++], k = inv_start[t]; k < inv_start[t + 1]; k++)
+	    if (! seen[p = inv_src[k]]) {
+		seen[p] = TRUE;
+		queue[tail++] = p;
+	    }
+    for (q = 1; q <= m && why == NULL; q++)
+	if (! seen[q])
+	    why = "the minimized DFA has a dead state";
+    mem_free(inv_src);
+    mem_free(inv_start);
+
+    /* ... and no two equivalent */
+    if (why == NULL && m > 0) {
+	groups = (state_t *) mem_alloc(MEM_CLASSES, (m + 1) * sizeof(state_t));
+	hopcroft_refine(cert, groups);
+	for (q = 1; q <= m && why == NULL; q++)
+	    if (find(q, groups) != q)
+		why = "the minimized DFA has equivalent states";
+	mem_free(groups);
+    }
+
+    mem_free(seen);
+    mem_free(queue);
+    trace_end("cert_check");
+    return why;
+}
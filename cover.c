@@ -0,0 +1,329 @@
+/*-------------------------------------------------------------------------*\
+|  Module "cover.c"
+|
+|  Minimal deterministic cover automata of finite languages (the -f
+|  option), after C. Campeanu, N. Santean & S. Yu, "Minimal cover-
+|  automata for finite languages" (1998).
+|
+|  A cover automaton of a finite language L, all of whose words have at
+|  most 'len' symbols, is a DFA C such that L = L(C) & words of at most
+|  'len' symbols: C may accept anything longer. It is often much
+|  smaller than the minimal DFA of L - a dictionary of words ending in
+|  common suffixes of different lengths, for one - and a matcher that
+|  bounds the length of the matches anyway gets the same matches.
+|
+|  Let level(p) be the length of the shortest words leading to p (so
+|  that the words leading to p have at most len - level(p) more symbols
+|  left). Two states p and q are similar iff no word of at most len -
+|  max(level(p), level(q)) symbols is accepted from one but not from
+|  the other. Similarity is not transitive, but taking the states in
+|  the order of their levels and making every state not yet taken the
+|  representative of a class of all the later states similar to it
+|  gives the states of a minimal cover automaton, with the transitions
+|  of the representatives.
+|
+|  "Not distinguished by words of at most k symbols" is the k-th
+|  partition of Moore's refinement, so similarity is read from the
+|  partitions of the first rounds of it, kept in a table; the rounds are
+|  run on the refinable partition of module "rpart.c". The missing
+|  transitions of the DFA go to a sink element 0 (which may well be
+|  similar to a state, and so become a real transition of the cover).
+\*-------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "auto.h"
+
+#define LIVE(S)	((S) > 0 && dfa->state_attrib[S] != 'D')
+#define NEXT(S, A) \
+	(((S) > 0 && LIVE(dfa->mat[S][A])) ? dfa->mat[S][A] : 0)
+
+extern void  rp_init ();
+extern void  rp_free ();
+extern void  rp_mark ();
+extern int   rp_split ();
+
+void  trace_begin ();
+void  trace_end ();
+
+static int  moore_rounds ();
+
+/*-------------------------------------------------------------------------
+|  void  cover_dfa (dfa, cover, len)
+|  automaton_t  *dfa, *cover;
+|  int          len;
+|
+|  Make 'cover' a minimal cover automaton of the words of at most 'len'
+|  symbols of the minimized (dead states marked) DFA 'dfa', whose
+|  language must be finite, with no word longer than 'len'.
+`------------------------------------------------------------------------*/
+
+void  cover_dfa (dfa, cover, len)
+automaton_t  *dfa, *cover;
+int          len;
+{
+    int      n = dfa->nstates, nab = dfa->nab;
+    int      *level, *order, *indeg, *longest, *rep, *cls, *num;
+    int      head, tail, nord, rounds, i, j, k, d;
+    state_t  p, q, t;
+
+    trace_begin("cover", NULL, NULL);
+    level = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    order = (int *) mem_alloc(MEM_CLASSES, (n + 2) * sizeof(int));
+    indeg = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    longest = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    rep = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    num = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+
+    /* the levels of the live states reached (breadth-first), and of the
+       sink: one more than that of the first state missing a transition */
+    for (p = 0; p <= n; p++)
+	level[p] = -1;
+    nord = 0;
+    if (LIVE(dfa->init_state)) {
+	level[dfa->init_state] = 0;
+	order[nord++] = dfa->init_state;
+    }
+    for (head = 0; head < nord; head++) {
+	p = order[head];
+	for (j = 1; j <= nab; j++) {
+	    t = NEXT(p, j);
+	    if (level[t] < 0) {
+		level[t] = level[p] + 1;
+		if (t > 0)
+		    order[nord++] = t;
+	    }
+	}
+    }
+
+    /* the language must be finite, and its words no longer than 'len':
+       the longest paths, in topological order (Kahn) */
+    for (i = 0; i < nord; i++)
+	for (j = 1; j <= nab; j++)
+	    if ((t = NEXT(order[i], j)) > 0)
+		indeg[t]++;
+    head = tail = 0;
+    if (nord > 0)
+	rep[tail++] = dfa->init_state;	/* 'rep[]' doubles as the queue */
+    for (; head < tail; head++) {
+	p = rep[head];
+	if (dfa->state_attrib[p] == 'A' && longest[p] > len)
+	    Abort(("The DFA accepts words longer than %d symbols\n", len));
+	for (j = 1; j <= nab; j++)
+	    if ((t = NEXT(p, j)) > 0) {
+		if (longest[p] + 1 > longest[t])
+		    longest[t] = longest[p] + 1;
+		if (--indeg[t] == 0)
+		    rep[tail++] = t;
+	    }
+    }
+    if (tail < nord)
+	Abort(("The language of the DFA is infinite: no cover automaton\n"));
+    if (level[0] >= 0)
+	order[nord++] = 0;	/* the sink, last of its level */
+    for (i = nord - 1; i > 0 && level[order[i]] < level[order[i - 1]]; i--) {
+	t = order[i];
+	order[i] = order[i - 1];
+	order[i - 1] = t;
+    }
+
+    /* the classes of the first Moore rounds; then greedily, level by
+       level, every state not taken yet takes all the later ones
+       similar to it */
+    rounds = moore_rounds(dfa, len, &cls);
+    for (i = 0; i < nord; i++)
+	rep[order[i]] = -1;
+    for (i = 0; i < nord; i++) {
+	if (rep[p = order[i]] >= 0)
+	    continue;
+	rep[p] = p;
+	for (k = i + 1; k < nord; k++) {
+	    q = order[k];
+	    if (rep[q] >= 0)
+		continue;
+	    d = len - level[q];		/* level[q] >= level[p] */
+	    if (d < 0 || cls[(size_t) (d < rounds ? d : rounds) * (n + 1) + p]
+			 == cls[(size_t) (d < rounds ? d : rounds) * (n + 1) + q])
+		rep[q] = p;
+	}
+    }
+
+    /* the cover: a state per class but the sink's, in the order of the
+       representatives (so the initial state's is first) */
+    cover->nab = nab;
+    for (i = 0, k = 0; i < nord; i++) {
+	p = order[i];
+	if (rep[p] == p && p > 0)
+	    num[p] = ++k;
+    }
+    cover->nstates = k;
+    cover->init_state = 1;
+    for (i = 0, k = 0, d = 0; i < nord; i++) {
+	p = order[i];
+	if (rep[p] != p || p == 0)
+	    continue;
+	k = num[p];
+	for (j = 1; j <= nab; j++) {
+	    t = rep[NEXT(p, j)];
+	    cover->mat[k][j] = (t > 0) ? num[t] : 0;
+	}
+	cover->state_attrib[k] = dfa->state_attrib[p] == 'A' ? 'A' : '\0';
+	if (cover->state_attrib[k] == 'A')
+	    cover->accept[d++] = k;
+    }
+    cover->accept[d] = 0;
+
+    mem_free(cls);
+    mem_free(num);
+    mem_free(rep);
+    mem_free(longest);
+    mem_free(indeg);
+    mem_free(order);
+    mem_free(level);
+    trace_end("cover");
+}
+
+/*-------------------------------------------------------------------------
+|  static int  moore_rounds (dfa, len, cls)
+|  automaton_t  *dfa;
+|  int          len;
+|  int          **cls;
+|
+|  Run the rounds of Moore's refinement of the states of 'dfa' (and the
+|  sink 0) - up to round 'len', or until it is stable: make '*cls' a
+|  table of the class of every element after every round,
+|  (*cls)[k * (nstates + 1) + p], and return the last round.
+`------------------------------------------------------------------------*/
+
+static int  moore_rounds (dfa, len, cls)
+automaton_t  *dfa;
+int          len;
+int          **cls;
+{
+    rpart_t  P;
+    int      n = dfa->nstates, nab = dfa->nab, nelems = n + 1;
+    int      *inv_start, *inv_src, *elems, *first, *end, *tab, *ntab;
+    int      k, a, c, i, j, e, nsets, size;
+    state_t  p;
+
+    /* the predecessors of 't' on 'a': inv_src[inv_start[(a-1) * nelems
+       + t] .. inv_start[(a-1) * nelems + t + 1] - 1] (counting sort) */
+    inv_start = (int *) mem_alloc(MEM_INVERSE,
+				  ((size_t) nab * nelems + 1) * sizeof(int));
+    inv_src = (int *) mem_alloc(MEM_INVERSE,
+				(size_t) nab * nelems * sizeof(int));
+    for (p = 0; p <= n; p++)
+	for (a = 1; a <= nab; a++)
+	    inv_start[(a - 1) * nelems + NEXT(p, a) + 1]++;
+    for (i = 1; i <= nab * nelems; i++)
+	inv_start[i] += inv_start[i - 1];
+    for (p = 0; p <= n; p++)
+	for (a = 1; a <= nab; a++)
+	    inv_src[inv_start[(a - 1) * nelems + NEXT(p, a)]++] = p;
+    for (i = nab * nelems; i > 0; i--)
+	inv_start[i] = inv_start[i - 1];
+    inv_start[0] = 0;
+
+    elems = (int *) mem_alloc(MEM_CLASSES, nelems * sizeof(int));
+    first = (int *) mem_alloc(MEM_CLASSES, (nelems + 1) * sizeof(int));
+    end = (int *) mem_alloc(MEM_CLASSES, (nelems + 1) * sizeof(int));
+    size = 16;
+    tab = (int *) mem_alloc(MEM_CLASSES, (size_t) size * nelems * sizeof(int));
+
+    /* round 0: accept states / other states */
+    rp_init(&P, nelems);
+    for (p = 1; p <= n; p++)
+	if (dfa->state_attrib[p] == 'A')
+	    rp_mark(&P, p);
+    rp_split(&P, NULL);
+    for (k = 0; ; k++) {
+	if (k == size) {
+	    ntab = (int *) mem_alloc(MEM_CLASSES,
+				     (size_t) 2 * size * nelems * sizeof(int));
+	    memcpy(ntab, tab, (size_t) size * nelems * sizeof(int));
+	    mem_free(tab);
+	    tab = ntab;
+	    size *= 2;
+	}
+	for (p = 0; p <= n; p++)
+	    tab[(size_t) k * nelems + p] = P.sidx[p];
+	if (k == len)
+	    break;
+
+	/* round k + 1: split by the classes of round k, symbol by symbol */
+	nsets = P.nsets;
+	memcpy(elems, P.elems, nelems * sizeof(int));
+	memcpy(first, P.first, nsets * sizeof(int));
+	memcpy(end, P.end, nsets * sizeof(int));
+	for (a = 1; a <= nab; a++)
+	    for (c = 0; c < nsets; c++) {
+		for (i = first[c]; i < end[c]; i++) {
+		    e = (a - 1) * nelems + elems[i];
+		    for (j = inv_start[e]; j < inv_start[e + 1]; j++)
+			rp_mark(&P, inv_src[j]);
+		}
+		rp_split(&P, NULL);
+	    }
+	if (P.nsets == nsets)		/* stable: so are all later rounds */
+	    break;
+    }
+
+    rp_free(&P);
+    mem_free(end);
+    mem_free(first);
+    mem_free(elems);
+    mem_free(inv_src);
+    mem_free(inv_start);
+    *cls = tab;
+    return k;
+}
+
+/*-------------------------------------------------------------------------
+|  int  cover_check (dfa, cover, len)
+|  automaton_t  *dfa, *cover;
+|  int          len;
+|
+|  Return TRUE iff 'cover' and 'dfa' accept the same words of at most
+|  'len' symbols: no pair of states, one of each, reached by the same
+|  word of at most 'len' symbols (breadth-first) differs on accepting.
+`------------------------------------------------------------------------*/
+
+int  cover_check (dfa, cover, len)
+automaton_t  *dfa, *cover;
+int          len;
+{
+    int      n = dfa->nstates, m = cover->nstates, ok = TRUE;
+    int      *depth, *queue, head, tail, j, x;
+    state_t  p, q, t, u;
+
+    depth = (int *) mem_alloc(MEM_CLASSES,
+			      (size_t) (n + 1) * (m + 1) * sizeof(int));
+    queue = (int *) mem_alloc(MEM_CLASSES,
+			      (size_t) (n + 1) * (m + 1) * sizeof(int));
+    head = tail = 0;
+    p = LIVE(dfa->init_state) ? dfa->init_state : 0;
+    queue[tail++] = p * (m + 1) + cover->init_state;
+    depth[queue[0]] = 1;		/* depth + 1: 0 is not reached */
+    while (head < tail && ok) {
+	x = queue[head++];
+	p = x / (m + 1);
+	q = x % (m + 1);
+	if ((p > 0 && dfa->state_attrib[p] == 'A')
+	    != (q > 0 && cover->state_attrib[q] == 'A'))
+	    ok = FALSE;
+	if (depth[x] > len)
+	    continue;
+	for (j = 1; j <= dfa->nab; j++) {
+	    t = NEXT(p, j);
+	    u = (q > 0) ? cover->mat[q][j] : 0;
+	    if (depth[t * (m + 1) + u] == 0) {
+		depth[t * (m + 1) + u] = depth[x] + 1;
+		queue[tail++] = t * (m + 1) + u;
+	    }
+	}
+    }
+    mem_free(queue);
+    mem_free(depth);
+    return ok;
+}
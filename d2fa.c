@@ -0,0 +1,517 @@
+/*-------------------------------------------------------------------------*\
+|  Module "d2fa.c"
+|
+|  Compressing a matcher with default transitions (a delayed-input DFA,
+|  or D2FA, after Kumar et al., "Algorithms to Accelerate Multiple
+|  Regular Expressions Matching for Deep Packet Inspection").
+|
+|  The rows of 256 transitions of a matcher (module "match.c") mostly
+|  repeat each other: most bytes lead all the states of a set of words
+|  back to the same few states. In a D2FA a state S may have a default
+|  state D; S then only keeps its "labeled" transitions, those on the
+|  bytes where its row differs from D's, and on any other byte the
+|  matcher moves to D without reading the byte, and tries again there.
+|
+|  Choosing the defaults: the weight of a pair of states is the number
+|  of bytes on which their rows agree (found over the byte classes of
+|  the matcher, as in module "multi.c"). Every state is weighed against
+|  the D2FA_WINDOW states numbered after it (and the initial state, the
+|  state most rows lead back to), and keeps its D2FA_CAND heaviest
+|  pairs, sharing at least D2FA_MIN_SHARE bytes. A maximum-weight
+|  spanning forest of these pairs is found by Kruskal's algorithm (with
+|  the Union-Find of module "ufind.c"), each tree is rooted at its
+|  center, and a state's default is its parent. To bound the work per
+|  byte, the chains of defaults are cut every 'depth' states: a state
+|  at a depth that is a multiple of 'depth' gets the root for default
+|  instead (the root of a tree of matcher states, most alike to all of
+|  them, mostly shares enough with it), so no chain is longer.
+|
+|  Lookups: the labeled bytes of a state are a 256 bit map; the target
+|  of a labeled byte is found in O(1) by counting the bits before it (a
+|  state without a default has all 256 bits).
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "auto.h"
+
+#define NEXT(M, S, C)	((M)->next[(size_t) (S) * 256 + (C)])
+
+#define BIT(D, S, C)	((D)->bits[(S) * 4 + ((C) >> 6)] >> ((C) & 63) & 1)
+
+#ifndef D2FA_WINDOW
+#   define D2FA_WINDOW	512	/* states weighed against each state */
+#endif
+
+#ifndef D2FA_CAND
+#   define D2FA_CAND	4	/* ... of which the heaviest kept     */
+#endif
+
+#define D2FA_MIN_SHARE	16	/* bytes a state and its default share */
+
+void              feed_file ();
+void              trace_begin ();
+void              trace_end ();
+extern state_t    find ();
+extern void       Union ();
+
+static unsigned   col_hash ();
+static int        same_col ();
+static int        weigh ();
+static void       keep_pair ();
+static int        shared ();
+static int        bfs ();
+
+/*-------------------------------------------------------------------------
+|  d2fa_t  *d2fa_build (m, depth)
+|  matcher_t  *m;
+|  int        depth;
+|
+|  Return the D2FA of the matcher 'm', whose chains of default states
+|  are at most 'depth' long.
+`------------------------------------------------------------------------*/
+
+d2fa_t  *d2fa_build (m, depth)
+matcher_t  *m;
+int        depth;
+{
+    d2fa_t    *d;
+    int       n = m->nstates, ncls, k, c, w, i, j, qn, len, last;
+    int       rep[256], size[256];
+    unsigned  hash[256];
+    state_t   *row, *eu, *ev, *order, *uf, *adj, *par, *queue;
+    int       *ew, *cnt, *adj_at, *dist;
+    int       bw[D2FA_CAND];	/* the heaviest pairs of a state ... */
+    state_t   bt[D2FA_CAND];	/* ... and the states paired with it */
+    size_t    ne, e, nl;
+    state_t   S, T, D, b, x;
+
+    trace_begin("d2fa_build", NULL, NULL);
+    d = (d2fa_t *) mem_alloc(MEM_MATCHER, sizeof(d2fa_t));
+    d->nstates = n;
+    d->init = m->init;
+
+    /* the byte classes of the matcher, and its rows over them */
+    for (c = 0; c < 256; c++)
+	hash[c] = col_hash(m, c);
+    for (c = 0, ncls = 0; c < 256; c++) {
+	for (k = 0; k < ncls; k++)
+	    if (hash[c] == hash[rep[k]] && same_col(m, c, rep[k]))
+		break;
+	if (k == ncls) {
+	    rep[ncls++] = c;
+	    size[k] = 0;
+	}
+	size[k]++;
+    }
+    row = (state_t *) mem_alloc(MEM_MATCHER,
+				(size_t) (n + 1) * ncls * sizeof(state_t));
+    for (S = 1; S <= n; S++)
+	for (k = 0; k < ncls; k++)
+	    row[(size_t) S * ncls + k] = NEXT(m, S, rep[k]);
+
+    /* candidate pairs: the heaviest of every state */
+    eu = (state_t *) mem_alloc(MEM_MATCHER,
+			       ((size_t) n * D2FA_CAND + 1) * sizeof(state_t));
+    ev = (state_t *) mem_alloc(MEM_MATCHER,
+			       ((size_t) n * D2FA_CAND + 1) * sizeof(state_t));
+    ew = (int *) mem_alloc(MEM_MATCHER,
+			   ((size_t) n * D2FA_CAND + 1) * sizeof(int));
+    ne = 0;
+    for (S = 1; S <= n; S++) {
+	for (i = 0; i < D2FA_CAND; i++)
+	    bw[i] = 0;
+	last = (S + D2FA_WINDOW < n) ? S + D2FA_WINDOW : n;
+	for (T = S + 1; T <= last; T++)
+	    keep_pair(bw, bt, weigh(row, ncls, size, S, T), T);
+	if (m->init != S && (m->init < S || m->init > last))
+	    keep_pair(bw, bt, weigh(row, ncls, size, S, m->init), m->init);
+	for (i = 0; i < D2FA_CAND && bw[i] > 0; i++) {
+	    eu[ne] = S;
+	    ev[ne] = bt[i];
+	    ew[ne++] = bw[i];
+	}
+    }
+    mem_free(row);
+
+    /* Kruskal: the pairs by decreasing weight (counting sort) */
+    cnt = (int *) mem_alloc(MEM_MATCHER, 258 * sizeof(int));
+    order = (state_t *) mem_alloc(MEM_MATCHER, (ne + 1) * sizeof(state_t));
+    for (e = 0; e < ne; e++)
+	cnt[256 - ew[e] + 1]++;
+    for (w = 1; w <= 257; w++)
+	cnt[w] += cnt[w - 1];
+    for (e = 0; e < ne; e++)
+	order[cnt[256 - ew[e]]++] = (state_t) e;
+    mem_free(cnt);
+
+    uf = (state_t *) mem_alloc(MEM_MATCHER, (n + 1) * sizeof(state_t));
+    adj_at = (int *) mem_alloc(MEM_MATCHER, (n + 2) * sizeof(int));
+    for (j = 0, e = 0; e < ne; e++) {
+	i = order[e];
+	if (find(eu[i], uf) == find(ev[i], uf))
+	    continue;
+	Union(eu[i], ev[i], uf);
+	adj_at[eu[i] + 1]++;
+	adj_at[ev[i] + 1]++;
+	order[j++] = (state_t) i;	/* the tree edges, in place */
+    }
+    for (S = 1; S <= n + 1; S++)
+	adj_at[S] += adj_at[S - 1];
+    adj = (state_t *) mem_alloc(MEM_MATCHER, (2 * j + 1) * sizeof(state_t));
+    for (i = 0; i < j; i++) {
+	e = order[i];
+	adj[adj_at[eu[e]]++] = ev[e];
+	adj[adj_at[ev[e]]++] = eu[e];
+    }
+    for (S = n + 1; S > 0; S--)		/* shift the starts back */
+	adj_at[S] = adj_at[S - 1];
+    adj_at[0] = 0;
+    mem_free(uf);
+    mem_free(order);
+    mem_free(ew);
+    mem_free(ev);
+    mem_free(eu);
+
+    /* root every tree at its center: the middle of a longest path */
+    d->deflt = (state_t *) mem_alloc(MEM_MATCHER, (n + 1) * sizeof(state_t));
+    dist = (int *) mem_alloc(MEM_MATCHER, (n + 1) * sizeof(int));
+    par = (state_t *) mem_alloc(MEM_MATCHER, (n + 1) * sizeof(state_t));
+    queue = (state_t *) mem_alloc(MEM_MATCHER, (n + 1) * sizeof(state_t));
+    for (S = 1; S <= n; S++)
+	dist[S] = -1;
+    for (S = 1; S <= n; S++) {
+	if (dist[S] == -2)		/* in a tree done */
+	    continue;
+	qn = bfs(S, adj_at, adj, dist, par, queue);
+	b = queue[qn - 1];
+	for (i = 0; i < qn; i++)
+	    dist[queue[i]] = -1;
+	qn = bfs(b, adj_at, adj, dist, par, queue);
+	x = queue[qn - 1];
+	for (len = dist[x] / 2; len > 0; len--)
+	    x = par[x];
+	for (i = 0; i < qn; i++)
+	    dist[queue[i]] = -1;
+	qn = bfs(x, adj_at, adj, dist, par, queue);
+	for (i = 0; i < qn; i++) {
+	    T = queue[i];
+	    if (dist[T] == 0)
+		len = 0;
+	    else if (dist[T] % depth != 0) {
+		d->deflt[T] = par[T];
+		len = dist[T] % depth + 1;
+	    } else if (shared(m, T, x) >= D2FA_MIN_SHARE) {
+		d->deflt[T] = x;		/* cut: to the root */
+		len = 1;
+	    } else
+		len = 0;
+	    if (len > d->depth)
+		d->depth = len;
+	    dist[T] = -2;
+	}
+    }
+    mem_free(queue);
+    mem_free(par);
+    mem_free(dist);
+    mem_free(adj);
+    mem_free(adj_at);
+
+    /* the labeled transitions: where a row differs from its default's */
+    d->bits = (unsigned long long *) mem_alloc(MEM_MATCHER,
+				(n + 1) * 4 * sizeof(unsigned long long));
+    d->rank = (unsigned short *) mem_alloc(MEM_MATCHER,
+					   (n + 1) * 4 * sizeof(unsigned short));
+    d->at = (unsigned *) mem_alloc(MEM_MATCHER, (n + 2) * sizeof(unsigned));
+    d->kind = (unsigned char *) mem_alloc(MEM_MATCHER, n + 1);
+    for (S = 1, nl = 0; S <= n; S++) {
+	D = d->deflt[S];
+	d->at[S] = (unsigned) nl;
+	for (c = 0; c < 256; c++) {
+	    if ((c & 63) == 0)
+		d->rank[S * 4 + (c >> 6)] = (unsigned short) (nl - d->at[S]);
+	    if (D == 0 || NEXT(m, S, c) != NEXT(m, D, c)) {
+		d->bits[S * 4 + (c >> 6)] |= 1ULL << (c & 63);
+		nl++;
+	    }
+	}
+	if (D == 0)
+	    d->nroots++;
+	d->kind[S] = m->kind[S] & MATCH_ACCEPT;
+    }
+    d->at[n + 1] = (unsigned) nl;
+    d->nlabeled = nl;
+    d->to = (state_t *) mem_alloc(MEM_MATCHER, (nl + 1) * sizeof(state_t));
+    for (S = 1, nl = 0; S <= n; S++)
+	for (c = 0; c < 256; c++)
+	    if (BIT(d, S, c))
+		d->to[nl++] = NEXT(m, S, c);
+
+    d->bytes = sizeof(d2fa_t) + (n + 1) * (sizeof(state_t)
+		+ 4 * sizeof(unsigned long long) + 4 * sizeof(unsigned short)
+		+ 1) + (n + 2) * sizeof(unsigned) + (nl + 1) * sizeof(state_t);
+    trace_end("d2fa_build");
+    return d;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  weigh (row, ncls, size, S, T)
+|  state_t  row[];
+|  int      ncls, size[];
+|  state_t  S, T;
+|
+|  Return the number of bytes on which the states 'S' and 'T' go to the
+|  same state (their rows over 'ncls' byte classes being in 'row', the
+|  class k holding size[k] bytes).
+`------------------------------------------------------------------------*/
+
+static int  weigh (row, ncls, size, S, T)
+state_t  row[];
+int      ncls, size[];
+state_t  S, T;
+{
+    state_t  *r = &row[(size_t) S * ncls], *q = &row[(size_t) T * ncls];
+    int      k, w = 0;
+
+    for (k = 0; k < ncls; k++)
+	if (r[k] == q[k])
+	    w += size[k];
+    return w;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  keep_pair (bw, bt, w, T)
+|  int      bw[];
+|  state_t  bt[];
+|  int      w;
+|  state_t  T;
+|
+|  Keep the pair with state 'T', of weight 'w', among the D2FA_CAND
+|  heaviest pairs of a state so far (bt[i] of weight bw[i], heaviest
+|  first), if it is one of them and weighs at least D2FA_MIN_SHARE.
+`------------------------------------------------------------------------*/
+
+static void  keep_pair (bw, bt, w, T)
+int      bw[];
+state_t  bt[];
+int      w;
+state_t  T;
+{
+    int  i;
+
+    if (w < D2FA_MIN_SHARE || w <= bw[D2FA_CAND - 1])
+	return;
+    for (i = D2FA_CAND - 1; i > 0 && bw[i - 1] < w; i--) {
+	bw[i] = bw[i - 1];
+	bt[i] = bt[i - 1];
+    }
+    bw[i] = w;
+    bt[i] = T;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  shared (m, S, T)
+|  matcher_t  *m;
+|  state_t    S, T;
+|
+|  Return the number of bytes on which the states 'S' and 'T' of 'm' go
+|  to the same state.
+`------------------------------------------------------------------------*/
+
+static int  shared (m, S, T)
+matcher_t  *m;
+state_t    S, T;
+{
+    int  c, w = 0;
+
+    for (c = 0; c < 256; c++)
+	if (NEXT(m, S, c) == NEXT(m, T, c))
+	    w++;
+    return w;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  bfs (src, adj_at, adj, dist, par, queue)
+|  state_t  src;
+|  int      adj_at[];
+|  state_t  adj[], par[], queue[];
+|  int      dist[];
+|
+|  Breadth-first search of the tree of 'src' (the neighbors of S being
+|  adj[adj_at[S] .. adj_at[S+1]-1]), setting the distance from 'src' &
+|  the parent of every state of the tree, whose 'dist' must be -1.
+|  Return the number of states put into 'queue', farthest last.
+`------------------------------------------------------------------------*/
+
+static int  bfs (src, adj_at, adj, dist, par, queue)
+state_t  src;
+int      adj_at[];
+state_t  adj[], par[], queue[];
+int      dist[];
+{
+    int      qh, qn = 0, i;
+    state_t  S, T;
+
+    queue[qn++] = src;
+    dist[src] = 0;
+    par[src] = 0;
+    for (qh = 0; qh < qn; qh++) {
+	S = queue[qh];
+	for (i = adj_at[S]; i < adj_at[S + 1]; i++)
+	    if (dist[T = adj[i]] == -1) {
+		dist[T] = dist[S] + 1;
+		par[T] = S;
+		queue[qn++] = T;
+	    }
+    }
+    return qn;
+}
+
+/*-------------------------------------------------------------------------
+|  static unsigned  col_hash (m, c)
+|  matcher_t  *m;
+|  int        c;
+|
+|  Hash of the column of the byte 'c' in the table of 'm'.
+`------------------------------------------------------------------------*/
+
+static unsigned  col_hash (m, c)
+matcher_t  *m;
+int        c;
+{
+    unsigned  h = 2166136261u;
+    state_t   s;
+
+    for (s = 1; s <= m->nstates; s++)
+	h = (h ^ (unsigned) NEXT(m, s, c)) * 16777619u;
+    return h;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  same_col (m, c, d)
+|  matcher_t  *m;
+|  int        c, d;
+|
+|  Return TRUE iff the bytes 'c' and 'd' lead every state of 'm' to the
+|  same state.
+`------------------------------------------------------------------------*/
+
+static int  same_col (m, c, d)
+matcher_t  *m;
+int        c, d;
+{
+    state_t  s;
+
+    for (s = 1; s <= m->nstates; s++)
+	if (NEXT(m, s, c) != NEXT(m, s, d))
+	    return FALSE;
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+|  void  d2fa_free (d)
+|  d2fa_t  *d;
+|
+|  Release the D2FA 'd'.
+`------------------------------------------------------------------------*/
+
+void  d2fa_free (d)
+d2fa_t  *d;
+{
+    mem_free(d->to);
+    mem_free(d->kind);
+    mem_free(d->at);
+    mem_free(d->rank);
+    mem_free(d->bits);
+    mem_free(d->deflt);
+    mem_free(d);
+}
+
+/*-------------------------------------------------------------------------
+|  void  d2fa_start (d, report, arg)
+|  d2fa_t  *d;
+|  void    (*report) ();
+|  void    *arg;
+|
+|  Start 'd' on a new stream, calling (*report)(arg, offset) at every
+|  match as match_start() does.
+`------------------------------------------------------------------------*/
+
+void  d2fa_start (d, report, arg)
+d2fa_t  *d;
+void    (*report) ();
+void    *arg;
+{
+    d->s = d->init;
+    d->offset = 0;
+    d->count = 0;
+    d->report = report;
+    d->arg = arg;
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  d2fa_feed (d, buf, len)
+|  d2fa_t         *d;
+|  unsigned char  *buf;
+|  size_t         len;
+|
+|  Scan the next 'len' bytes of the stream of 'd', at 'buf'. Return the
+|  number of matches ending in them.
+`------------------------------------------------------------------------*/
+
+size_t  d2fa_feed (d, buf, len)
+d2fa_t         *d;
+unsigned char  *buf;
+size_t         len;
+{
+    unsigned char       *p = buf, *end = buf + len;
+    unsigned long long  w;
+    state_t             S = d->s;
+    size_t              count = 0, hops = 0;
+    int                 c;
+
+    while (p < end) {
+	c = *p++;
+	while (((w = d->bits[S * 4 + (c >> 6)]) >> (c & 63) & 1) == 0) {
+	    S = d->deflt[S];		/* the byte is read again there */
+	    hops++;
+	}
+	S = d->to[d->at[S] + d->rank[S * 4 + (c >> 6)]
+		  + __builtin_popcountll(w & ((1ULL << (c & 63)) - 1))];
+	if (d->kind[S]) {
+	    count++;
+	    if (d->report != NULL)
+		(*d->report)(d->arg, d->offset + (size_t) (p - buf));
+	}
+    }
+    d->s = S;
+    d->offset += len;
+    d->count += count;
+    d->scanned += len;
+    d->hops += hops;
+    return count;
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  d2fa_file (d, name, report, arg)
+|  d2fa_t  *d;
+|  char    *name;
+|  void    (*report) ();
+|  void    *arg;
+|
+|  Scan the file 'name' with 'd' as a stream (see d2fa_start() and
+|  feed_file()). Return the number of matches.
+`------------------------------------------------------------------------*/
+
+size_t  d2fa_file (d, name, report, arg)
+d2fa_t  *d;
+char    *name;
+void    (*report) ();
+void    *arg;
+{
+    d2fa_start(d, report, arg);
+    feed_file(name, d2fa_feed, (void *) d);
+    return d->count;
+}
@@ -5,6 +5,7 @@
 |       unreachable from the initial state
 |  or
 |       cannot reach any accept-state
+|  (in a Mealy machine, nor any transition with an output label)
 |
 |  The method used is to calculate the full transitive-closure of each
 |  state using Warshall algorithm.
@@ -14,10 +15,15 @@
 
 /*
  |  The full transitive-closure matrix:
- |	connected[i][j] == TRUE   iff   j is reachable from i
- |  Initially all entries are FALSE
+ |	CONNECTED(i, j) == TRUE   iff   j is reachable from i
+ |  Initially all entries are FALSE.
+ |  It is allocated for the DFA at hand: (nstates + 1) rows of
+ |  'row_len' = nstates + 1 entries each.
  */
-static char   connected[MAX_STATES+1][MAX_STATES+1];
+static char   *connected;
+static int    row_len;
+
+#define CONNECTED(I, J)	connected[(I) * row_len + (J)]
 
 static void   init_connections ();
 static void   t_closure ();
@@ -28,7 +34,8 @@ static void   t_closure ();
 |
 |  Mark the following DFA states as dead states:
 |	1. States not reachable from the initial state.
-|	2. States not reaching an accept state.
+|	2. States not reaching an accept state (or a state emitting an
+|	   output label, in a Mealy machine).
 `------------------------------------------------------------------------*/
 
 void find_dead_states (dfa)
@@ -36,13 +43,26 @@ automaton_t  *dfa;
 {
     state_t	i, j, accept_st;
     char	attrib;
+    char	*emits = NULL;	/* Mealy: emits[i] iff 'i' has an output */
+    int		a;
+
+    row_len = dfa->nstates + 1;
+    connected = (char *) mem_alloc(MEM_CLOSURE, (size_t) row_len * row_len);
 
     init_connections(dfa->mat, dfa->nstates, dfa->nab);
     t_closure(dfa->nstates);
 
+    if (dfa->outs != NULL) {
+	emits = (char *) mem_alloc(MEM_CLOSURE, dfa->nstates + 1);
+	for (i = 1; i <= dfa->nstates; i++)
+	    for (a = 1; a <= dfa->nab; a++)
+		if (OUT(dfa, i, a) > 0)
+		    emits[i] = TRUE;
+    }
+
     /* Mark all the states not reachable from s0 (initial state) as dead */
     for (i = 1; i <= dfa->nstates; i++)
-	if (! connected[dfa->init_state][i]) {
+	if (! CONNECTED(dfa->init_state, i)) {
 	    dfa->state_attrib[i] = 'D';
 	}
 
@@ -54,13 +74,22 @@ automaton_t  *dfa;
 
 	/* Loop over accept-states */
 	for (j = 0; (accept_st = dfa->accept[j]) != 0; j++)
-	    if (connected[i][accept_st]) /* i reaches an accept-state */
+	    if (CONNECTED(i, accept_st)) /* i reaches an accept-state */
 		break;                   /* no more checking needed   */
 
-	if (accept_st == 0) {            /* All accept states scanned     */
-	    dfa->state_attrib[i] = 'D';  /* and none was reachable from i */
-	}
+	if (accept_st == 0 && emits != NULL)
+	    for (j = 1; j <= dfa->nstates; j++)
+		if (emits[j] && CONNECTED(i, j))
+		    break;
+
+	if (accept_st == 0 && (emits == NULL || j > dfa->nstates)) {
+	    dfa->state_attrib[i] = 'D';  /* All accept states scanned     */
+	}                                /* and none was reachable from i */
     }
+    mem_free(emits);
+
+    mem_free(connected);
+    connected = NULL;
 }
 
 /*-------------------------------------------------------------------------
@@ -69,7 +98,7 @@ automaton_t  *dfa;
 |  int  nstates;
 |  int  nab;
 |
-|  Initialize the 'connected[][]' matrix according to 'transitions_mat[][]'.
+|  Initialize the 'connected' matrix according to 'transitions_mat[][]'.
 `------------------------------------------------------------------------*/
 
 static void init_connections (transitions_mat, nstates, nab)
@@ -82,13 +111,13 @@ int  nab;
     for (src = 1; src <= nstates; src++) {
 
 	for (dest = 1; dest <= nstates; dest++)
-	    connected[src][dest] = FALSE;       /* clear 'src' connections */
+	    CONNECTED(src, dest) = FALSE;       /* clear 'src' connections */
 
-	connected[src][src] = TRUE;
+	CONNECTED(src, src) = TRUE;
 	for (i = 1; i <= nab; i++) {
 	    if ((dest = transitions_mat[src][i]) > 0)
 		/* 'src' goes to 'dest' on alphabet symbol 'i' */
-		connected[src][dest] = TRUE;
+		CONNECTED(src, dest) = TRUE;
 	}
     }
 }
@@ -98,7 +127,7 @@ int  nab;
 |  static void t_closure (nstates)
 |  int  nstates;
 |
-|  Compute the transitive closure of the 'connected[][]' matrix.
+|  Compute the transitive closure of the 'connected' matrix.
 |  Method: S. Warshall algorithm (See Sedgewick, Algorithms chap. 32)
 `------------------------------------------------------------------------*/
 
@@ -109,10 +138,10 @@ int  nstates;
 
     for (i = 1; i <= nstates; i++) {
 	for (j = 1; j <= nstates; j++) {
-	    if (connected[j][i]) {
+	    if (CONNECTED(j, i)) {
 		for (k = 1; k <= nstates; k++) {
-		    if (connected[i][k]) {
-			connected[j][k] = TRUE;
+		    if (CONNECTED(i, k)) {
+			CONNECTED(j, k) = TRUE;
 		    }
 		}
 	    }
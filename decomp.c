@@ -0,0 +1,418 @@
+/*-------------------------------------------------------------------------*\
+|  Module "decomp.c"
+|
+|  Transparent decompression of compressed inputs (gzip, and zstd when
+|  built with -DHAVE_ZSTD), overlapped with their parsing.
+|
+|  A decompressor thread inflates the input into a ring of DECOMP_RING
+|  buffers of DECOMP_BUF bytes each, which the tokenizer (module
+|  "scan.c") consumes one by one: while one buffer is being parsed, the
+|  next ones are being filled. The decompressed input is never held in
+|  memory as a whole.
+|
+|  Every ring buffer has SCAN_SLACK free bytes in front of its data, so
+|  that the tokenizer can put the unfinished last token of the previous
+|  buffer right in front of the next one without copying the buffer.
+|
+|  The compressed input is either in memory (mapped file, batch buffer)
+|  or read from a file descriptor (pipe), after a first part that the
+|  caller already read to detect the format.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#   include <zstd.h>
+#endif
+
+#include "auto.h"
+
+#ifndef DECOMP_BUF
+#   define DECOMP_BUF	(1L << 20)	/* decompressed bytes per buffer */
+#endif
+#define DECOMP_RING	4		/* buffers in the ring           */
+#define DECOMP_IN	(1 << 16)	/* compressed bytes per read()   */
+
+void  trace_begin ();
+void  trace_end ();
+
+/*
+ |  A decompression in progress
+ */
+struct decomp {
+	int		format;		/* DECOMP_GZIP / DECOMP_ZSTD       */
+	char		*src;		/* compressed input in memory ...  */
+	size_t		srclen;
+	int		fd;		/* ... followed by this one, or -1 */
+	char		*inbuf;		/* read() buffer for 'fd'          */
+
+	char		*ring[DECOMP_RING];
+	size_t		len[DECOMP_RING];
+	int		rd, wr;		/* next buffer to take / to fill   */
+	int		nfull;		/* filled (or held) buffers        */
+	int		held;		/* TRUE: consumer holds ring[rd-1] */
+	int		done;		/* producer finished               */
+	int		stop;		/* consumer asks producer to quit  */
+	char		*err;		/* why the producer failed         */
+
+	pthread_t	tid;
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;
+};
+
+static void  *producer ();
+static int   get_input ();
+static char  *get_out ();
+static void  put_out ();
+static void  run_gzip ();
+#ifdef HAVE_ZSTD
+static void  run_zstd ();
+#endif
+
+/*-------------------------------------------------------------------------
+|  int  decomp_format (p, len)
+|  char    *p;
+|  size_t  len;
+|
+|  Return the compression format of an input beginning with the 'len'
+|  bytes at 'p': DECOMP_GZIP, DECOMP_ZSTD or DECOMP_NONE.
+`------------------------------------------------------------------------*/
+
+int  decomp_format (p, len)
+char    *p;
+size_t  len;
+{
+    unsigned char  *u = (unsigned char *) p;
+
+    if (len >= 2 && u[0] == 0x1f && u[1] == 0x8b)
+	return DECOMP_GZIP;
+    if (len >= 4 && u[0] == 0x28 && u[1] == 0xb5 && u[2] == 0x2f
+	&& u[3] == 0xfd)
+	return DECOMP_ZSTD;
+    return DECOMP_NONE;
+}
+
+/*-------------------------------------------------------------------------
+|  decomp_t  *decomp_start (format, src, srclen, fd)
+|  int     format;
+|  char    *src;
+|  size_t  srclen;
+|  int     fd;
+|
+|  Start decompressing the input made of the 'srclen' bytes at 'src'
+|  (which must stay valid until decomp_end()) followed by the rest of
+|  'fd' (unless fd < 0).
+`------------------------------------------------------------------------*/
+
+decomp_t  *decomp_start (format, src, srclen, fd)
+int     format;
+char    *src;
+size_t  srclen;
+int     fd;
+{
+    decomp_t  *d;
+    int       i;
+
+#ifndef HAVE_ZSTD
+    if (format == DECOMP_ZSTD)
+	Abort(("zstd-compressed input: minauto was built without zstd\n"));
+#endif
+
+    /* the producer thread must not allocate (mem_alloc() isn't MT-safe) */
+    d = (decomp_t *) mem_alloc(MEM_IO, sizeof(decomp_t));
+    for (i = 0; i < DECOMP_RING; i++)
+	d->ring[i] = (char *) mem_alloc(MEM_IO, SCAN_SLACK + DECOMP_BUF);
+    d->inbuf = (fd >= 0) ? (char *) mem_alloc(MEM_IO, DECOMP_IN) : NULL;
+    d->format = format;
+    d->src = src;
+    d->srclen = srclen;
+    d->fd = fd;
+
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->cond, NULL);
+    if ((i = pthread_create(&d->tid, NULL, producer, (void *) d)) != 0)
+	Abort(("Cannot start the decompression thread: %s\n", strerror(i)));
+    return d;
+}
+
+/*-------------------------------------------------------------------------
+|  char  *decomp_next (d, len)
+|  decomp_t  *d;
+|  size_t    *len;
+|
+|  Give the buffer taken by the previous call back to the ring, and
+|  return the next buffer of decompressed input with its length in
+|  '*len' (there are SCAN_SLACK free bytes before it).
+|  Return NULL at the end of the input. Aborts on corrupt input.
+`------------------------------------------------------------------------*/
+
+char  *decomp_next (d, len)
+decomp_t  *d;
+size_t    *len;
+{
+    char  *p;
+
+    trace_begin("decomp_wait", NULL, NULL);
+    pthread_mutex_lock(&d->lock);
+    if (d->held) {
+	d->held = FALSE;
+	d->nfull--;
+	pthread_cond_broadcast(&d->cond);
+    }
+    while (d->nfull == 0 && ! d->done)
+	pthread_cond_wait(&d->cond, &d->lock);
+    if (d->nfull == 0) {
+	pthread_mutex_unlock(&d->lock);
+	trace_end("decomp_wait");
+	if (d->err != NULL)
+	    Abort(("Bad compressed input: %s\n", d->err));
+	return NULL;
+    }
+    p = d->ring[d->rd] + SCAN_SLACK;
+    *len = d->len[d->rd];
+    d->rd = (d->rd + 1) % DECOMP_RING;
+    d->held = TRUE;
+    pthread_mutex_unlock(&d->lock);
+    trace_end("decomp_wait");
+    return p;
+}
+
+/*-------------------------------------------------------------------------
+|  void  decomp_end (d)
+|  decomp_t  *d;
+|
+|  Stop the decompression 'd' (wherever it is) and release it.
+`------------------------------------------------------------------------*/
+
+void  decomp_end (d)
+decomp_t  *d;
+{
+    int  i;
+
+    pthread_mutex_lock(&d->lock);
+    d->stop = TRUE;
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    pthread_join(d->tid, NULL);
+
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->cond);
+    for (i = 0; i < DECOMP_RING; i++)
+	mem_free(d->ring[i]);
+    if (d->inbuf != NULL)
+	mem_free(d->inbuf);
+    mem_free(d);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  *producer (arg)
+|  void  *arg;
+|
+|  Thread body: decompress the whole input into the ring.
+`------------------------------------------------------------------------*/
+
+static void  *producer (arg)
+void  *arg;
+{
+    decomp_t  *d = (decomp_t *) arg;
+
+    trace_begin("decompress", NULL, NULL);
+#ifdef HAVE_ZSTD
+    if (d->format == DECOMP_ZSTD)
+	run_zstd(d);
+    else
+#endif
+	run_gzip(d);
+    trace_end("decompress");
+
+    pthread_mutex_lock(&d->lock);
+    d->done = TRUE;
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  get_input (d, p, len)
+|  decomp_t  *d;
+|  char      **p;
+|  size_t    *len;
+|
+|  Get the next part of the compressed input into '*p' & '*len'.
+|  Return FALSE at its end.
+`------------------------------------------------------------------------*/
+
+static int  get_input (d, p, len)
+decomp_t  *d;
+char      **p;
+size_t    *len;
+{
+    ssize_t  n;
+
+    if (d->src != NULL) {
+	*p = d->src;
+	*len = d->srclen;
+	d->src = NULL;
+	if (*len > 0)
+	    return TRUE;
+    }
+    if (d->fd < 0 || (n = read(d->fd, d->inbuf, DECOMP_IN)) <= 0)
+	return FALSE;
+    *p = d->inbuf;
+    *len = (size_t) n;
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+|  static char  *get_out (d)
+|  decomp_t  *d;
+|
+|  Wait for a free ring buffer and return (the data part of) it, or
+|  NULL if the consumer asked to stop.
+`------------------------------------------------------------------------*/
+
+static char  *get_out (d)
+decomp_t  *d;
+{
+    char  *p;
+
+    pthread_mutex_lock(&d->lock);
+    while (d->nfull == DECOMP_RING && ! d->stop)
+	pthread_cond_wait(&d->cond, &d->lock);
+    p = d->stop ? NULL : d->ring[d->wr] + SCAN_SLACK;
+    pthread_mutex_unlock(&d->lock);
+    return p;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  put_out (d, len)
+|  decomp_t  *d;
+|  size_t    len;
+|
+|  Hand the buffer got by get_out(), now holding 'len' bytes, over to
+|  the consumer.
+`------------------------------------------------------------------------*/
+
+static void  put_out (d, len)
+decomp_t  *d;
+size_t    len;
+{
+    pthread_mutex_lock(&d->lock);
+    d->len[d->wr] = len;
+    d->wr = (d->wr + 1) % DECOMP_RING;
+    d->nfull++;
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  run_gzip (d)
+|  decomp_t  *d;
+|
+|  Inflate gzip input (possibly several concatenated members).
+`------------------------------------------------------------------------*/
+
+static void  run_gzip (d)
+decomp_t  *d;
+{
+    z_stream  z;
+    char      *out, *in;
+    size_t    inlen;
+    int       r = Z_OK, more = TRUE, member = FALSE;
+
+    memset(&z, 0, sizeof(z));
+    if (inflateInit2(&z, 15 + 16) != Z_OK) {	/* 16: gzip wrapper */
+	d->err = "cannot initialize zlib";
+	return;
+    }
+    while (more && (out = get_out(d)) != NULL) {
+	z.next_out = (Bytef *) out;
+	z.avail_out = DECOMP_BUF;
+	while (z.avail_out > 0) {
+	    if (z.avail_in == 0) {
+		if (! get_input(d, &in, &inlen)) {
+		    if (member)
+			d->err = "truncated gzip data";
+		    more = FALSE;
+		    break;
+		}
+		z.next_in = (Bytef *) in;
+		z.avail_in = (uInt) inlen;
+	    }
+	    member = TRUE;
+	    r = inflate(&z, Z_NO_FLUSH);
+	    if (r == Z_STREAM_END) {        /* next member, if any */
+		member = FALSE;
+		inflateReset(&z);
+	    } else if (r != Z_OK && r != Z_BUF_ERROR) {
+		d->err = (z.msg != NULL) ? z.msg : "corrupt gzip data";
+		more = FALSE;
+		break;
+	    }
+	}
+	if (d->err != NULL)
+	    break;
+	put_out(d, DECOMP_BUF - z.avail_out);
+    }
+    inflateEnd(&z);
+}
+
+#ifdef HAVE_ZSTD
+/*-------------------------------------------------------------------------
+|  static void  run_zstd (d)
+|  decomp_t  *d;
+|
+|  Decompress zstd input (possibly several concatenated frames).
+`------------------------------------------------------------------------*/
+
+static void  run_zstd (d)
+decomp_t  *d;
+{
+    ZSTD_DStream    *zs;
+    ZSTD_inBuffer   in;
+    ZSTD_outBuffer  out;
+    char            *p;
+    size_t          len, r;
+    int             more = TRUE, frame = FALSE;
+
+    if ((zs = ZSTD_createDStream()) == NULL) {
+	d->err = "cannot initialize zstd";
+	return;
+    }
+    ZSTD_initDStream(zs);
+    in.src = NULL;
+    in.size = in.pos = 0;
+    while (more && (out.dst = get_out(d)) != NULL) {
+	out.size = DECOMP_BUF;
+	out.pos = 0;
+	while (out.pos < out.size) {
+	    if (in.pos == in.size) {
+		if (! get_input(d, &p, &len)) {
+		    if (frame)
+			d->err = "truncated zstd data";
+		    more = FALSE;
+		    break;
+		}
+		in.src = p;
+		in.size = len;
+		in.pos = 0;
+	    }
+	    r = ZSTD_decompressStream(zs, &out, &in);
+	    if (ZSTD_isError(r)) {
+		d->err = (char *) ZSTD_getErrorName(r);
+		more = FALSE;
+		break;
+	    }
+	    frame = (r != 0);               /* 0: a frame was completed */
+	}
+	if (d->err != NULL)
+	    break;
+	put_out(d, out.pos);
+    }
+    ZSTD_freeDStream(zs);
+}
+#endif
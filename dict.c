@@ -0,0 +1,355 @@
+/*-------------------------------------------------------------------------*\
+|  Module "dict.c"
+|
+|  Dictionaries of multi-character symbols (the -k option): the letters
+|  of an alphabet of words - the tokens of a tokenizer, the opcodes of
+|  an instruction stream - instead of single characters.
+|
+|  The words are interned as they are read (dict_intern()), each one
+|  getting the next symbol number, through an open addressing hash
+|  table of their 64 bit (FNV-1a) hashes. Once all are in, dict_seal()
+|  makes a perfect hash of them for the matcher, after Belazzougui,
+|  Botelho & Dietzfelbinger, "Hash, displace, and compress" (CHD):
+|
+|      1. The words are spread over n / DICT_BUCKET buckets by their
+|         hash.
+|
+|      2. Largest first, every bucket is given a displacement 'd': the
+|         first one for which its words all land, by a second hash of
+|         their hash and 'd', in distinct free slots of a table of
+|         n * DICT_LOAD_DIV / DICT_LOAD_MUL slots.
+|
+|  A lookup (dict_lookup()) then hashes the word once, reads the
+|  displacement of its bucket and the slot it leads to, and compares
+|  the word with the one symbol in it - which it is, or none is: there
+|  are no probes or chains, whatever the number of words.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "auto.h"
+
+#ifndef DICT_BUCKET
+#   define DICT_BUCKET	4	/* words per bucket, on average */
+#endif
+
+#define DICT_LOAD_MUL	4	/* slots: 5/4 per word */
+#define DICT_LOAD_DIV	5
+
+#define DICT_MAX_DISP	(1 << 16)	/* displacements tried per bucket */
+#define DICT_MAX_SEEDS	16		/* ... before the hashes change   */
+
+static unsigned long long  hash_word ();
+static unsigned long long  mix ();
+static int                 place ();
+static int                 equal ();
+
+/*-------------------------------------------------------------------------
+|  dict_t  *dict_new (size)
+|  int  size;
+|
+|  Make an empty dictionary, with room for 'size' symbols.
+`------------------------------------------------------------------------*/
+
+dict_t  *dict_new (size)
+int  size;
+{
+    dict_t  *d;
+
+    d = (dict_t *) mem_alloc(MEM_DICT, sizeof(dict_t));
+    d->size = size;
+    d->text_size = 8 * (size_t) size + 64;
+    d->text = (char *) mem_alloc(MEM_DICT, d->text_size);
+    d->at = (size_t *) mem_alloc(MEM_DICT, (size + 1) * sizeof(size_t));
+    d->len = (int *) mem_alloc(MEM_DICT, (size + 1) * sizeof(int));
+    d->hash = (unsigned long long *)
+		mem_alloc(MEM_DICT, (size + 1) * sizeof(unsigned long long));
+    for (d->hsize = 16; d->hsize < 2 * size; d->hsize *= 2)
+	;
+    d->htab = (int *) mem_alloc(MEM_DICT, d->hsize * sizeof(int));
+    return d;
+}
+
+/*-------------------------------------------------------------------------
+|  void  dict_free (d)
+|  dict_t  *d;
+|
+|  Release the dictionary 'd' (if not NULL).
+`------------------------------------------------------------------------*/
+
+void  dict_free (d)
+dict_t  *d;
+{
+    if (d == NULL)
+	return;
+    mem_free(d->slot);
+    mem_free(d->disp);
+    mem_free(d->htab);
+    mem_free(d->hash);
+    mem_free(d->len);
+    mem_free(d->at);
+    mem_free(d->text);
+    mem_free(d);
+}
+
+/*-------------------------------------------------------------------------
+|  int  dict_intern (d, w, len)
+|  dict_t  *d;
+|  char    *w;
+|  int     len;
+|
+|  Return the symbol of the word 'w' (of 'len' characters) in 'd',
+|  making it the next one if it isn't in yet.
+`------------------------------------------------------------------------*/
+
+int  dict_intern (d, w, len)
+dict_t  *d;
+char    *w;
+int     len;
+{
+    unsigned long long  h = hash_word(w, len, 0ULL);
+    unsigned            k;
+    int                 i;
+    char                *ntext;
+
+    for (k = (unsigned) h & (d->hsize - 1); (i = d->htab[k]) != 0;
+	 k = (k + 1) & (d->hsize - 1))
+	if (d->hash[i] == h && equal(d, i, w, len))
+	    return i;
+
+    if (d->n == d->size)
+	Abort(("Too many symbols in the dictionary (%d)\n", d->size));
+    if (d->text_len + len > d->text_size) {
+	ntext = (char *) mem_alloc(MEM_DICT, 2 * (d->text_size + len));
+	memcpy(ntext, d->text, d->text_len);
+	mem_free(d->text);
+	d->text = ntext;
+	d->text_size = 2 * (d->text_size + len);
+    }
+    i = ++d->n;
+    d->htab[k] = i;
+    d->hash[i] = h;
+    d->at[i] = d->text_len;
+    d->len[i] = len;
+    memcpy(&d->text[d->text_len], w, len);
+    d->text_len += len;
+    if (len > d->maxlen)
+	d->maxlen = len;
+    return i;
+}
+
+/*-------------------------------------------------------------------------
+|  void  dict_seal (d)
+|  dict_t  *d;
+|
+|  Make the perfect hash of the symbols of 'd', for dict_lookup(); no
+|  symbol may be added to it afterwards.
+`------------------------------------------------------------------------*/
+
+void  dict_seal (d)
+dict_t  *d;
+{
+    int  tries;
+
+    d->nbuckets = d->n / DICT_BUCKET + 1;
+    d->nslots = d->n * DICT_LOAD_DIV / DICT_LOAD_MUL + 1;
+    d->disp = (unsigned *) mem_alloc(MEM_DICT, d->nbuckets * sizeof(unsigned));
+    d->slot = (int *) mem_alloc(MEM_DICT, d->nslots * sizeof(int));
+    for (tries = 0; ! place(d); tries++) {
+	/* some bucket found no displacement: new hashes, or more room */
+	if (tries >= DICT_MAX_SEEDS)
+	    Abort(("No perfect hash found for the %d symbols\n", d->n));
+	d->seed = mix(d->seed + 1);
+	if (tries % 4 == 3) {
+	    mem_free(d->slot);
+	    d->nslots += d->nslots / 4 + 1;
+	    d->slot = (int *) mem_alloc(MEM_DICT, d->nslots * sizeof(int));
+	}
+    }
+}
+
+/*-------------------------------------------------------------------------
+|  int  dict_lookup (d, w, len)
+|  dict_t  *d;
+|  char    *w;
+|  int     len;
+|
+|  Return the symbol of the word 'w' (of 'len' characters) in the
+|  sealed dictionary 'd', 0 if it isn't one.
+`------------------------------------------------------------------------*/
+
+int  dict_lookup (d, w, len)
+dict_t  *d;
+char    *w;
+int     len;
+{
+    unsigned long long  h;
+    int                 i;
+
+    if (len > d->maxlen)
+	return 0;
+    h = hash_word(w, len, d->seed);
+    i = d->slot[mix(h ^ d->disp[(h >> 32) % d->nbuckets]) % d->nslots];
+    return (i != 0 && equal(d, i, w, len)) ? i : 0;
+}
+
+/*-------------------------------------------------------------------------
+|  char  *dict_word (d, i, len)
+|  dict_t  *d;
+|  int     i;
+|  int     *len;
+|
+|  Return the characters of the symbol 'i' of 'd' (not '\0' terminated),
+|  and set '*len' to their number.
+`------------------------------------------------------------------------*/
+
+char  *dict_word (d, i, len)
+dict_t  *d;
+int     i;
+int     *len;
+{
+    *len = d->len[i];
+    return &d->text[d->at[i]];
+}
+
+/*-------------------------------------------------------------------------
+|  static int  place (d)
+|  dict_t  *d;
+|
+|  Find a displacement for every bucket of 'd' with the current seed,
+|  filling the slots. Return FALSE if some bucket has none.
+`------------------------------------------------------------------------*/
+
+static int  place (d)
+dict_t  *d;
+{
+    unsigned long long  *h;
+    int                 *count, *order, *first, *member, *at;
+    int                 i, b, k, j, big, n = d->n, ok = TRUE;
+    unsigned            disp;
+
+    h = (unsigned long long *) mem_alloc(MEM_DICT,
+					 (n + 1) * sizeof(unsigned long long));
+    count = (int *) mem_alloc(MEM_DICT, (d->nbuckets + 1) * sizeof(int));
+    first = (int *) mem_alloc(MEM_DICT, (d->nbuckets + 1) * sizeof(int));
+    order = (int *) mem_alloc(MEM_DICT, d->nbuckets * sizeof(int));
+    member = (int *) mem_alloc(MEM_DICT, (n + 1) * sizeof(int));
+    at = (int *) mem_alloc(MEM_DICT, (n + 1) * sizeof(int));
+    memset(d->slot, 0, d->nslots * sizeof(int));
+
+    /* the members of every bucket, and the buckets largest first
+       (counting sorts) */
+    for (i = 1, big = 0; i <= n; i++) {
+	h[i] = (d->seed == 0) ? d->hash[i]
+		: hash_word(&d->text[d->at[i]], d->len[i], d->seed);
+	if (++count[(h[i] >> 32) % d->nbuckets] > big)
+	    big = count[(h[i] >> 32) % d->nbuckets];
+    }
+    for (b = 0, k = 0; b < d->nbuckets; b++) {
+	first[b] = k;
+	k += count[b];
+    }
+    first[d->nbuckets] = k;
+    for (i = 1; i <= n; i++)
+	member[first[(h[i] >> 32) % d->nbuckets]++] = i;
+    for (b = d->nbuckets; b > 0; b--)	/* back to the starts */
+	first[b] = first[b - 1];
+    first[0] = 0;
+    for (k = 0, j = big; j >= 0; j--)
+	for (b = 0; b < d->nbuckets; b++)
+	    if (count[b] == j)
+		order[k++] = b;
+
+    for (k = 0; k < d->nbuckets && ok; k++) {
+	b = order[k];
+	if (count[b] == 0)
+	    break;
+	for (disp = 0; disp < DICT_MAX_DISP; disp++) {
+	    for (j = 0; j < count[b]; j++) {
+		i = member[first[b] + j];
+		at[j] = (int) (mix(h[i] ^ disp) % d->nslots);
+		if (d->slot[at[j]] != 0)
+		    break;
+		d->slot[at[j]] = i;	/* also catches two in one slot */
+	    }
+	    if (j == count[b])
+		break;
+	    while (--j >= 0)
+		d->slot[at[j]] = 0;
+	}
+	if (disp == DICT_MAX_DISP)
+	    ok = FALSE;
+	d->disp[b] = disp;
+    }
+
+    mem_free(at);
+    mem_free(member);
+    mem_free(order);
+    mem_free(first);
+    mem_free(count);
+    mem_free(h);
+    return ok;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  equal (d, i, w, len)
+|  dict_t  *d;
+|  int     i;
+|  char    *w;
+|  int     len;
+|
+|  Return TRUE iff the symbol 'i' of 'd' is the word 'w' of 'len'
+|  characters.
+`------------------------------------------------------------------------*/
+
+static int  equal (d, i, w, len)
+dict_t  *d;
+int     i;
+char    *w;
+int     len;
+{
+    return d->len[i] == len && memcmp(&d->text[d->at[i]], w, len) == 0;
+}
+
+/*-------------------------------------------------------------------------
+|  static unsigned long long  hash_word (w, len, seed)
+|  char                *w;
+|  int                 len;
+|  unsigned long long  seed;
+|
+|  The 64 bit FNV-1a hash of the 'len' characters at 'w', from a basis
+|  changed by 'seed'.
+`------------------------------------------------------------------------*/
+
+static unsigned long long  hash_word (w, len, seed)
+char                *w;
+int                 len;
+unsigned long long  seed;
+{
+    unsigned long long  h = 14695981039346656037ULL ^ seed;
+
+    while (len-- > 0)
+	h = (h ^ (unsigned char) *w++) * 1099511628211ULL;
+    return h;
+}
+
+/*-------------------------------------------------------------------------
+|  static unsigned long long  mix (h)
+|  unsigned long long  h;
+|
+|  Scramble the bits of 'h' (the finalizer of MurmurHash3), so that
+|  nearby values hash far apart.
+`------------------------------------------------------------------------*/
+
+static unsigned long long  mix (h)
+unsigned long long  h;
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
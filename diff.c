@@ -0,0 +1,250 @@
+/*-------------------------------------------------------------------------*\
+|  Module "diff.c"
+|
+|  Patches between two versions of a minimized DFA: the matchers using
+|  a DFA that is updated often get the rows that changed instead of the
+|  whole table.
+|
+|  Both versions are canonically numbered (see module "canon.c"), so
+|  that the states of the parts of the DFA the update left alone mostly
+|  keep their numbers, and their rows compare equal. The patch (written
+|  with the -u option) lists the rows of the new version that differ
+|  from those of the old one, and all those of the states it adds:
+|               +-------------------------+
+|               |  NOLD  NNEW  NAB        |
+|               |  L1 L2 ... Ln           |
+|               |  HOLD  HNEW             |
+|               |  NROWS                  |
+|               |  S  T1 T2 ... Tn  A     |
+|               |     .                   |
+|               |     .                   |
+|               +-------------------------+
+|  where NOLD & NNEW are the number of states of the old & new version
+|  (states from NNEW on are dropped), L1 ... Ln their alphabet, HOLD &
+|  HNEW the (FNV-1a, 64 bit, hexadecimal) hashes of their tables, and
+|  every one of the NROWS rows is the new row of state S: its targets
+|  (-1: none) and A, 1 if S is an accept state (0 otherwise).
+|
+|  A patch is applied (the -g option) to a DFA file of the old version
+|  in the DFA input format, as written by write_dfa() (module "inout.c",
+|  the -q option). It is checked to be that version (its hash), patched
+|  in memory, checked to be the new version, written to a new file, and
+|  renamed over the old one: the matchers reading the file find the old
+|  version or the new one, never a mix, nor a half written one.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "auto.h"
+
+extern char  ab_map[];
+extern void  write_dfa ();
+
+void  trace_begin ();
+void  trace_end ();
+
+/*
+ |  The table of a DFA as write_dfa() writes it: that of the empty
+ |  language (initial state dead) is one state, without transitions
+ */
+#define EMPTY(D)	((D)->state_attrib[(D)->init_state] == 'D')
+#define NROWS(D)	(EMPTY(D) ? 1 : (D)->nstates)
+#define TARGET(D, S, A)	(EMPTY(D) ? 0 : (D)->mat[S][A])
+#define ACCEPTS(D, S)	(! EMPTY(D) && (D)->state_attrib[S] == 'A')
+
+static unsigned long long  dfa_hash ();
+
+/*-------------------------------------------------------------------------
+|  long  diff_write (fp, old, new, nrows)
+|  FILE         *fp;
+|  automaton_t  *old, *new;
+|  int          *nrows;
+|
+|  Write to 'fp' the patch from the DFA 'old' to the DFA 'new' (both
+|  canonically numbered, over the same alphabet). Return its size in
+|  bytes, and the number of rows in it in '*nrows'.
+`------------------------------------------------------------------------*/
+
+long  diff_write (fp, old, new, nrows)
+FILE         *fp;
+automaton_t  *old, *new;
+int          *nrows;
+{
+    int      nold = NROWS(old), nnew = NROWS(new), nab = new->nab;
+    int      j;
+    long     bytes;
+    char     *diff;
+    state_t  s;
+
+    trace_begin("diff", NULL, NULL);
+    diff = (char *) mem_alloc(MEM_CLASSES, nnew + 1);
+    *nrows = 0;
+    for (s = 1; s <= nnew; s++) {
+	diff[s] = (s > nold || ACCEPTS(old, s) != ACCEPTS(new, s));
+	for (j = 1; j <= nab && ! diff[s]; j++)
+	    diff[s] = (TARGET(old, s, j) != TARGET(new, s, j));
+	*nrows += diff[s];
+    }
+
+    bytes = fprintf(fp, "%d %d %d\n", nold, nnew, nab);
+    for (j = 1; j <= nab; j++)
+	bytes += fprintf(fp, "%c%c", ab_map[j], j == nab ? '\n' : ' ');
+    bytes += fprintf(fp, "%016llx %016llx\n", dfa_hash(old), dfa_hash(new));
+    bytes += fprintf(fp, "%d\n", *nrows);
+    for (s = 1; s <= nnew; s++) {
+	if (! diff[s])
+	    continue;
+	bytes += fprintf(fp, "%d ", s - 1);
+	for (j = 1; j <= nab; j++)
+	    bytes += fprintf(fp, "%d ", TARGET(new, s, j) - 1);
+	bytes += fprintf(fp, "%d\n", ACCEPTS(new, s) ? 1 : 0);
+    }
+    fflush(fp);
+
+    mem_free(diff);
+    trace_end("diff");
+    return bytes;
+}
+
+/*-------------------------------------------------------------------------
+|  int  diff_apply (name, dfa)
+|  char         *name;
+|  automaton_t  *dfa;
+|
+|  Apply the patch file 'name' to the DFA 'dfa' (read from a file
+|  written by write_dfa()). Return the number of rows patched; abort,
+|  leaving 'dfa' as it was, if the patch is not one of it.
+`------------------------------------------------------------------------*/
+
+int  diff_apply (name, dfa)
+char         *name;
+automaton_t  *dfa;
+{
+    FILE                *fp;
+    unsigned long long  hold, hnew;
+    int                 nold, nnew, nab, nrows, j, r, t, a, nacc = 0;
+    state_t             s, *rows;
+    char                *acc, c;
+
+    trace_begin("patch", NULL, NULL);
+    if ((fp = fopen(name, "r")) == NULL) {
+	perror(name);
+	exit(1);
+    }
+    if (fscanf(fp, "%d %d %d", &nold, &nnew, &nab) != 3
+	|| nnew < 1 || nab < 1)
+	Abort(("Bad input while reading the patch %s\n", name));
+    if (nnew > MAX_STATES)
+	Abort(("Number of states (%d) too large, recompile with \"-DMAX_STATES=%d\"\n",
+	       nnew, nnew));
+    if (nold != NROWS(dfa) || nab != dfa->nab)
+	Abort(("The patch %s is not one of this DFA\n", name));
+    for (j = 1; j <= nab; j++)
+	if (fscanf(fp, " %c", &c) != 1 || c != ab_map[j])
+	    Abort(("The patch %s is over another alphabet\n", name));
+    if (fscanf(fp, "%llx %llx %d", &hold, &hnew, &nrows) != 3 || nrows < 0)
+	Abort(("Bad input while reading the patch %s\n", name));
+    if (hold != dfa_hash(dfa))
+	Abort(("The patch %s is not one of this DFA\n", name));
+
+    /* the rows, read in first: a bad patch leaves the DFA as it was */
+    rows = (state_t *) mem_alloc(MEM_CLASSES,
+				 ((size_t) nrows * (nab + 1) + 1) * sizeof(state_t));
+    acc = (char *) mem_alloc(MEM_CLASSES, nrows + 1);
+    for (r = 0; r < nrows; r++) {
+	if (fscanf(fp, "%d", &t) != 1 || t < 0 || t >= nnew)
+	    Abort(("Bad input while reading the patch %s\n", name));
+	rows[r * (nab + 1)] = t + 1;
+	for (j = 1; j <= nab; j++) {
+	    if (fscanf(fp, "%d", &t) != 1 || t < -1 || t >= nnew)
+		Abort(("Bad input while reading the patch %s\n", name));
+	    rows[r * (nab + 1) + j] = t + 1;
+	}
+	if (fscanf(fp, "%d", &a) != 1)
+	    Abort(("Bad input while reading the patch %s\n", name));
+	acc[r] = (a != 0);
+    }
+    fclose(fp);
+
+    for (r = 0; r < nrows; r++) {
+	s = rows[r * (nab + 1)];
+	for (j = 1; j <= nab; j++)
+	    dfa->mat[s][j] = rows[r * (nab + 1) + j];
+	dfa->state_attrib[s] = acc[r] ? 'A' : '\0';
+    }
+    dfa->nstates = nnew;
+    dfa->init_state = 1;
+    for (s = 1; s <= nnew; s++)
+	if (dfa->state_attrib[s] == 'A')
+	    dfa->accept[nacc++] = s;
+    dfa->accept[nacc] = 0;
+    if (dfa_hash(dfa) != hnew)
+	Abort(("The DFA patched by %s is not the new version\n", name));
+
+    mem_free(acc);
+    mem_free(rows);
+    trace_end("patch");
+    return nrows;
+}
+
+/*-------------------------------------------------------------------------
+|  void  diff_switch (name, dfa)
+|  char         *name;
+|  automaton_t  *dfa;
+|
+|  Replace the DFA file 'name' by the DFA 'dfa' at once: write it to a
+|  new file, and rename that over 'name'.
+`------------------------------------------------------------------------*/
+
+void  diff_switch (name, dfa)
+char         *name;
+automaton_t  *dfa;
+{
+    FILE  *fp;
+    char  *tmp;
+
+    tmp = (char *) mem_alloc(MEM_IO, strlen(name) + 32);
+    sprintf(tmp, "%s.patch%ld", name, (long) getpid());
+    if ((fp = fopen(tmp, "w")) == NULL) {
+	perror(tmp);
+	exit(1);
+    }
+    write_dfa(fp, dfa);
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0 || fclose(fp) != 0
+	|| rename(tmp, name) != 0) {
+	perror(name);
+	unlink(tmp);
+	exit(1);
+    }
+    mem_free(tmp);
+}
+
+/*-------------------------------------------------------------------------
+|  static unsigned long long  dfa_hash (dfa)
+|  automaton_t  *dfa;
+|
+|  The 64 bit FNV-1a hash of the table of 'dfa' (as write_dfa() writes
+|  it): its sizes, targets and accept states.
+`------------------------------------------------------------------------*/
+
+static unsigned long long  dfa_hash (dfa)
+automaton_t  *dfa;
+{
+    unsigned long long  h = 14695981039346656037ULL;
+    int                 j;
+    state_t             s;
+
+#define HASH(V)	(h = (h ^ (unsigned long long) (unsigned) (V)) * 1099511628211ULL)
+    HASH(NROWS(dfa));
+    HASH(dfa->nab);
+    for (s = 1; s <= NROWS(dfa); s++) {
+	for (j = 1; j <= dfa->nab; j++)
+	    HASH(TARGET(dfa, s, j));
+	HASH(ACCEPTS(dfa, s));
+    }
+#undef HASH
+    return h;
+}
@@ -0,0 +1,106 @@
+/*-------------------------------------------------------------------------*\
+|  Module "equiv.c"
+|
+|  Language equivalence of two DFAs over the same alphabet.
+|
+|  Method: J. E. Hopcroft & R. M. Karp's near-linear algorithm
+|  ("A linear algorithm for testing equivalence of finite automata",
+|   1971). The states of both DFAs are put in one Union-Find structure
+|  (module "ufind.c"). Starting by unifying the two initial states, every
+|  time two states are unified their successors on each symbol are
+|  unified as well. The DFAs are equivalent iff no class ever contains
+|  both an accept and a non-accept state (nor, for Mealy machines, two
+|  states with different output labels on some symbol).
+|
+|  The element numbering in the common Union-Find array is:
+|	1 .. na			states of the first DFA
+|	na+1 .. na+nb		states of the second DFA
+|	na+nb+1			the (common) sink of all missing transitions
+\*-------------------------------------------------------------------------*/
+
+#include "auto.h"
+
+extern state_t   find ();
+extern void      Union ();
+
+/*-------------------------------------------------------------------------
+|  int  equiv_dfa (a, b)
+|  automaton_t  *a, *b;
+|
+|  Return TRUE iff the DFAs 'a' and 'b' accept the same language (and
+|  for Mealy machines, emit the same labels on every input).
+`------------------------------------------------------------------------*/
+
+int  equiv_dfa (a, b)
+automaton_t  *a, *b;
+{
+    int        na = a->nstates, nb = b->nstates;
+    state_t    sink = na + nb + 1;
+    state_t    *rep;		/* the common Union-Find array      */
+    state_t    *stack;		/* pairs of unified, unchecked elems */
+    char       *accept;		/* accept[e]: element 'e' accepts   */
+    int        sp = 0, equal = TRUE;
+    state_t    p, q, p1, q1, s;
+    int        j, o1, o2;
+
+    if (a->nab != b->nab)
+	return FALSE;
+
+    rep = (state_t *) mem_alloc(MEM_CLASSES, (sink + 1) * sizeof(state_t));
+    stack = (state_t *) mem_alloc(MEM_CLASSES, 2 * (sink + 1) * sizeof(state_t));
+    accept = (char *) mem_alloc(MEM_CLASSES, sink + 1);
+
+    for (s = 1; s <= na; s++)
+	accept[s] = (a->state_attrib[s] == 'A');
+    for (s = 1; s <= nb; s++)
+	accept[na + s] = (b->state_attrib[s] == 'A');
+
+    Union(a->init_state, na + b->init_state, rep);
+    stack[sp++] = a->init_state;
+    stack[sp++] = na + b->init_state;
+
+    while (sp > 0 && equal) {
+	q = stack[--sp];
+	p = stack[--sp];
+	if (accept[p] != accept[q]) {
+	    equal = FALSE;
+	    break;
+	}
+	for (j = 1; j <= a->nab; j++) {
+	    o1 = (p == sink || a->outs == NULL) ? 0
+		 : (p <= na) ? OUT(a, p, j) : OUT(b, p - na, j);
+	    o2 = (q == sink || a->outs == NULL) ? 0
+		 : (q <= na) ? OUT(a, q, j) : OUT(b, q - na, j);
+	    if (o1 != o2) {
+		equal = FALSE;
+		break;
+	    }
+
+	    /* successors of p & q in the common numbering */
+	    if (p == sink)
+		p1 = sink;
+	    else if (p <= na)
+		p1 = a->mat[p][j] > 0 ? a->mat[p][j] : sink;
+	    else
+		p1 = b->mat[p - na][j] > 0 ? na + b->mat[p - na][j] : sink;
+
+	    if (q == sink)
+		q1 = sink;
+	    else if (q <= na)
+		q1 = a->mat[q][j] > 0 ? a->mat[q][j] : sink;
+	    else
+		q1 = b->mat[q - na][j] > 0 ? na + b->mat[q - na][j] : sink;
+
+	    if (find(p1, rep) != find(q1, rep)) {
+		Union(p1, q1, rep);
+		stack[sp++] = p1;
+		stack[sp++] = q1;
+	    }
+	}
+    }
+
+    mem_free(rep);
+    mem_free(stack);
+    mem_free(accept);
+    return equal;
+}
@@ -0,0 +1,360 @@
+/*-------------------------------------------------------------------------*\
+|  Module "hopcroft.c"
+|
+|  The "hopcroft" minimization engine:
+|  J. E. Hopcroft's O(n k log n) partition refinement
+|  ("An n log n algorithm for minimizing states in a finite automaton",
+|   1971), on top of the refinable partition of module "rpart.c".
+|
+|  The partial transition function is completed by an extra element 0
+|  (the internal representation of a missing transition), which goes to
+|  itself on every symbol. It is put in a class of its own, so that -
+|  exactly as in the "aho" engine of module "partit.c" - a missing
+|  transition is distinguished from a transition into a real state.
+|  Both engines therefore compute the same partition of the states.
+|
+|  Work-list entries are (class, symbol) splitters. For every splitter
+|  the predecessors of its members on its symbol are marked, and every
+|  class containing both marked and unmarked states is split. Of the two
+|  halves only the smaller needs to be added as a new splitter (unless
+|  the old class was still pending, in which case both are).
+|
+|  A Mealy machine (output labels on its transitions, see module
+|  "inout.c") is minimized by the same refinement, started from the
+|  initial partition further split by the labels of the states' rows:
+|  then two states end up in a class iff they emit the same labels on
+|  their transitions and go to equivalent states.
+|
+|  The inverse transitions are built one symbol at a time, from the
+|  column copy of the matrix when there is one (see module "layout.c"),
+|  or one state at a time from the packed copy (module "packed.c").
+\*-------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+
+#include "auto.h"
+
+extern void  rp_init ();
+extern void  rp_free ();
+extern void  rp_mark ();
+extern int   rp_split ();
+extern void  pk_seek ();
+extern int   pk_next ();
+extern void  pk_next_row ();
+
+void  trace_begin ();
+void  trace_end ();
+
+/*
+ |  Inverse transitions: the predecessors of state 't' on symbol 'a'
+ |  (a = 1 .. nab) are inv_src[inv_start[IDX(a, t)] .. inv_start[IDX(a, t)+1]-1]
+ */
+#define IDX(A, T)	(((A) - 1) * nelems + (T))
+
+static int   nelems;		/* number of elements: states + 1 */
+static int   *inv_start;
+static int   *inv_src;
+
+static automaton_t  *odfa;	/* split_outputs(): the DFA sorted */
+
+static void  build_inverse ();
+static void  build_inverse_packed ();
+static void  split_outputs ();
+static int   cmp_outputs ();
+
+/*-------------------------------------------------------------------------
+|  int  hopcroft_refine (dfa, groups)
+|  automaton_t  *dfa;
+|  state_t      groups[];
+|
+|  Partition the states of 'dfa' into equivalence-classes, and store the
+|  result in the Union-Find array 'groups[]' (see module "ufind.c").
+|  Return the number of splitters processed.
+`------------------------------------------------------------------------*/
+
+int  hopcroft_refine (dfa, groups)
+automaton_t  *dfa;
+state_t      groups[];
+{
+    rpart_t  P;
+    int      nab = dfa->nab;
+    int      *wl_set, *wl_sym;	/* work-list of (class, symbol) splitters */
+    int      nwl = 0;
+    char     *in_wl;		/* in_wl[s * nab + a - 1]: (s, a) pending */
+    int      *members;		/* members of the current splitter class  */
+    int      *new_sets;
+    int      nmembers, count, steps = 0;
+    int      s, ns, small, a, c, i, j, q, e;
+
+    nelems = dfa->nstates + 1;
+
+    trace_begin("build_inverse", NULL, NULL);
+    if (dfa->packed != NULL)
+	build_inverse_packed(dfa);
+    else
+	build_inverse(dfa);
+    trace_end("build_inverse");
+
+    trace_begin("refine", NULL, NULL);
+    rp_init(&P, nelems);
+
+    /* initial partition: accept states / other states / missing */
+    for (e = 1; e < nelems; e++)
+	if (dfa->state_attrib[e] == 'A')
+	    rp_mark(&P, e);
+    rp_split(&P, NULL);
+    rp_mark(&P, 0);
+    rp_split(&P, NULL);
+    if (dfa->outs != NULL)
+	split_outputs(dfa, &P);
+
+    /*
+     | There are never more than 'nelems' classes, and a (class, symbol)
+     | pair is never twice in the work-list.
+     */
+    wl_set = (int *) mem_alloc(MEM_CLASSES, (size_t) nelems * nab * sizeof(int));
+    wl_sym = (int *) mem_alloc(MEM_CLASSES, (size_t) nelems * nab * sizeof(int));
+    in_wl = (char *) mem_alloc(MEM_CLASSES, (size_t) nelems * nab);
+    members = (int *) mem_alloc(MEM_CLASSES, nelems * sizeof(int));
+    new_sets = (int *) mem_alloc(MEM_CLASSES, nelems * sizeof(int));
+
+    for (s = 0; s < P.nsets; s++)
+	for (a = 1; a <= nab; a++) {
+	    wl_set[nwl] = s;
+	    wl_sym[nwl++] = a;
+	    in_wl[s * nab + a - 1] = TRUE;
+	}
+
+    while (nwl > 0) {
+	s = wl_set[--nwl];
+	a = wl_sym[nwl];
+	in_wl[s * nab + a - 1] = FALSE;
+	steps++;
+
+	/*
+	 | Copy the splitter's members first: marking may reorder
+	 | the slice of 'elems[]' that holds them.
+	 */
+	nmembers = 0;
+	for (i = P.first[s]; i < P.end[s]; i++)
+	    members[nmembers++] = P.elems[i];
+
+	for (i = 0; i < nmembers; i++) {
+	    q = members[i];
+	    for (j = inv_start[IDX(a, q)]; j < inv_start[IDX(a, q) + 1]; j++)
+		rp_mark(&P, inv_src[j]);
+	}
+
+	count = rp_split(&P, new_sets);
+
+	for (i = 0; i < count; i++) {
+	    ns = new_sets[i];
+	    s = P.split_from[ns];
+	    small = (P.end[ns] - P.first[ns] <= P.end[s] - P.first[s]) ? ns : s;
+	    for (c = 1; c <= nab; c++) {
+		e = in_wl[s * nab + c - 1] ? ns : small;
+		wl_set[nwl] = e;
+		wl_sym[nwl++] = c;
+		in_wl[e * nab + c - 1] = TRUE;
+	    }
+	}
+    }
+    trace_end("refine");
+
+    /*
+     | Convert to Union-Find form: the lowest-numbered member of every
+     | class is its representative (the missing-transition element 0
+     | is alone in its class and is not a state).
+     */
+    for (s = 0; s < P.nsets; s++) {
+	q = nelems;
+	for (i = P.first[s]; i < P.end[s]; i++)
+	    if (P.elems[i] < q)
+		q = P.elems[i];
+	if (q == 0)
+	    continue;
+	groups[q] = -(P.end[s] - P.first[s] - 1);
+	for (i = P.first[s]; i < P.end[s]; i++)
+	    if (P.elems[i] != q)
+		groups[P.elems[i]] = q;
+    }
+
+    mem_free(wl_set);
+    mem_free(wl_sym);
+    mem_free(in_wl);
+    mem_free(members);
+    mem_free(new_sets);
+    mem_free(inv_start);
+    mem_free(inv_src);
+    rp_free(&P);
+
+    return steps;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  build_inverse (dfa)
+|  automaton_t  *dfa;
+|
+|  Build the inverse transition lists 'inv_start[]' & 'inv_src[]' of
+|  'dfa' (including the self loops of the missing-transition element 0)
+|  by counting sort on (symbol, target). Reads 'dfa->cols' if present,
+|  'dfa->mat' otherwise.
+`------------------------------------------------------------------------*/
+
+static void  build_inverse (dfa)
+automaton_t  *dfa;
+{
+    int      nab = dfa->nab;
+    int      nidx = nab * nelems;
+    int      a, p, t, i;
+    state_t  *col;
+
+    inv_start = (int *) mem_alloc(MEM_INVERSE, (nidx + 1) * sizeof(int));
+    inv_src = (int *) mem_alloc(MEM_INVERSE, (size_t) nidx * sizeof(int));
+
+    for (a = 1; a <= nab; a++) {
+	inv_start[IDX(a, 0)]++;                 /* 0 --a--> 0 */
+	if (dfa->cols != NULL) {
+	    col = &COL(dfa, a, 0);
+	    for (p = 1; p < nelems; p++)
+		inv_start[IDX(a, col[p])]++;
+	} else
+	    for (p = 1; p < nelems; p++)
+		inv_start[IDX(a, dfa->mat[p][a])]++;
+    }
+
+    /* prefix sums, shifted by one: inv_start[i] = end of list i */
+    for (i = 1; i <= nidx; i++)
+	inv_start[i] += inv_start[i - 1];
+
+    for (a = 1; a <= nab; a++) {
+	if (dfa->cols != NULL) {
+	    col = &COL(dfa, a, 0);
+	    for (p = nelems - 1; p >= 1; p--)
+		inv_src[--inv_start[IDX(a, col[p])]] = p;
+	} else
+	    for (p = nelems - 1; p >= 1; p--) {
+		t = dfa->mat[p][a];
+		inv_src[--inv_start[IDX(a, t)]] = p;
+	    }
+	inv_src[--inv_start[IDX(a, 0)]] = 0;
+    }
+}
+
+/*-------------------------------------------------------------------------
+|  static void  build_inverse_packed (dfa)
+|  automaton_t  *dfa;
+|
+|  As build_inverse(), decoding the packed transitions of 'dfa' state by
+|  state (the gaps between defined symbols are missing transitions, i.e.
+|  go to element 0).
+`------------------------------------------------------------------------*/
+
+static void  build_inverse_packed (dfa)
+automaton_t  *dfa;
+{
+    int          nab = dfa->nab;
+    int          nidx = nab * nelems;
+    int          a, b, p, i, pass;
+    state_t      t;
+    pk_cursor_t  c;
+
+    inv_start = (int *) mem_alloc(MEM_INVERSE, (nidx + 1) * sizeof(int));
+    inv_src = (int *) mem_alloc(MEM_INVERSE, (size_t) nidx * sizeof(int));
+
+    /*
+     | Pass 0 counts the lists' lengths, pass 1 fills them in, from
+     | their start on (inv_start[i] ends up at the end of list i).
+     */
+    for (pass = 0; pass < 2; pass++) {
+	for (a = 1; a <= nab; a++)
+	    if (pass == 0)
+		inv_start[IDX(a, 0)]++;             /* 0 --a--> 0 */
+	    else
+		inv_src[inv_start[IDX(a, 0)]++] = 0;
+
+	pk_seek(dfa->packed, 1, &c);
+	for (p = 1; p < nelems; p++) {
+	    if (p > 1)
+		pk_next_row(&c);
+	    for (b = 1; b <= nab; b = a + 1) {
+		if (! pk_next(&c, &a, &t)) {
+		    a = nab;
+		    t = 0;
+		}
+		for (; b < a; b++)                  /* missing transitions */
+		    if (pass == 0)
+			inv_start[IDX(b, 0)]++;
+		    else
+			inv_src[inv_start[IDX(b, 0)]++] = p;
+		if (pass == 0)
+		    inv_start[IDX(a, t)]++;
+		else
+		    inv_src[inv_start[IDX(a, t)]++] = p;
+	    }
+	}
+
+	if (pass == 0) {
+	    /* exclusive prefix sums: inv_start[i] = start of list i */
+	    for (i = nidx; i > 0; i--)
+		inv_start[i] = inv_start[i - 1];
+	    inv_start[0] = 0;
+	    for (i = 1; i <= nidx; i++)
+		inv_start[i] += inv_start[i - 1];
+	}
+    }
+
+    /* back from ends to starts */
+    for (i = nidx; i > 0; i--)
+	inv_start[i] = inv_start[i - 1];
+    inv_start[0] = 0;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  split_outputs (dfa, P)
+|  automaton_t  *dfa;
+|  rpart_t      *P;
+|
+|  Split the classes of 'P' so that the states of the Mealy machine
+|  'dfa' in a class have the same output labels on every symbol.
+`------------------------------------------------------------------------*/
+
+static void  split_outputs (dfa, P)
+automaton_t  *dfa;
+rpart_t      *P;
+{
+    state_t  *order;
+    int      i, j, n = dfa->nstates;
+
+    order = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    for (i = 0; i < n; i++)
+	order[i] = i + 1;
+    odfa = dfa;
+    qsort((char *) order, n, sizeof(state_t), cmp_outputs);
+
+    /* every run of equal rows is split from the rest of its class */
+    for (i = 0; i < n; i = j) {
+	for (j = i; j < n && cmp_outputs(&order[i], &order[j]) == 0; j++)
+	    rp_mark(P, order[j]);
+	rp_split(P, NULL);
+    }
+    mem_free(order);
+}
+
+/*-------------------------------------------------------------------------
+|  static int  cmp_outputs (s1, s2)
+|  state_t  *s1, *s2;
+|
+|  qsort() comparison of the rows of output labels of two states.
+`------------------------------------------------------------------------*/
+
+static int  cmp_outputs (s1, s2)
+state_t  *s1, *s2;
+{
+    int  j, d;
+
+    for (j = 1; j <= odfa->nab; j++)
+	if ((d = OUT(odfa, *s1, j) - OUT(odfa, *s2, j)) != 0)
+	    return d;
+    return 0;
+}
@@ -37,6 +37,9 @@
 |  Letters and states may be separated by any amount of white space
 |  (blanks, tabs, newlines, or formfeeds)
 |
+|  The input is scanned from memory (module "scan.c"); the transition
+|  matrix may be parsed by several threads (see scan_set_threads()).
+|
 |  The number of states in the input (not including the last line of
 |  accept states) must equal the product NSTATES * NAB
 |  and the states should represent the state-transition matrix of
@@ -44,6 +47,35 @@
 |  which a transition from Si occurs on input symbol j, where symbol j
 |  signifies the alphabet symbol (letter) which appears in column j
 |  above the matrix of state transitions.
+|
+|  --- Mealy machines (the -w option) ---
+|  The transitions of a Mealy machine (a transducer) carry output
+|  labels, e.g. the actions of a tokenizer. They are given by a second
+|  matrix of NSTATES * NAB integers right after the transition matrix:
+|  Oij is the output label (a nonnegative integer) of the transition
+|  Sij, or -1 if it has none (as must be the case of missing ones).
+|  The minimized machine is printed with "target/label" entries.
+|
+|  --- Alphabets of words (the -k option) ---
+|  The letters L1 ... Ln may be words (any nonwhite characters, up to
+|  DICT_WORD_MAX of them) instead of single characters, e.g. the
+|  tokens of a tokenizer. They are interned in the dictionary
+|  'ab_dict' (see module "dict.c"), symbol j being the word Lj.
+|
+|  --- NFA Input file format (the -n and -b options) ---
+|  The transitions of an NFA are listed as edges instead of a matrix:
+|               +----------------+
+|               |  NSTATES  NAB  |
+|               |  L1 L2 ... Ln  |
+|               |  NEDGES        |
+|               |  Si  Lx  Sj    |
+|               |     .		 |
+|               |     .		 |
+|               |  A1 A2 ... Am  |
+|               +----------------+
+|  Where each of the NEDGES lines is an edge from state Si to state Sj
+|  on the letter Lx (one of L1 ... Ln). A state may have any number of
+|  edges on the same letter; there are no empty (epsilon) edges.
 \*-------------------------------------------------------------------------*/
 
 #include <stdio.h>
@@ -61,24 +93,47 @@
 
 #define ATTRIB(S) (dfa->state_attrib[S] == '\0' ? 's' : dfa->state_attrib[S])
 
-static char ab_map[AB_SIZE + 1]; /* Serial number mapping to Alphabet symbols */
+char ab_map[AB_SIZE + 1]; /* Serial number mapping to Alphabet symbols */
+dict_t *ab_dict = NULL;   /* ... of words, with the -k option          */
+
+extern int   scan_int ();
+extern int   scan_sym ();
+extern int   scan_word ();
+extern void  scan_matrix ();
+dict_t       *dict_new ();
+int          dict_intern ();
+void         dict_seal ();
+char         *dict_word ();
+
+static void  input_words ();
+static void  input_outputs ();
+static void  output_mealy ();
+static int   sym_width ();
+static void  print_sym ();
 
 /*-------------------------------------------------------------------------
-|  void input_dfa (dfa)
+|  void input_dfa (dfa, sc, flags)
 |  automaton_t *dfa;
+|  scan_t      *sc;
+|  int         flags;
 |
-|  Inputs a DFA into an internal structure 'dfa'
+|  Inputs a DFA, scanned by 'sc', into an internal structure 'dfa'
+|  (if INPUT_MEALY is in 'flags', a Mealy machine, with its output labels
+|  in 'dfa->outs'; if INPUT_WORDS, over an alphabet of words, interned
+|  in 'ab_dict').
 |  Input is assumed to be correct and meaningful
 |  (Only partial checks are performed).
 `------------------------------------------------------------------------*/
-void  input_dfa (dfa)
+void  input_dfa (dfa, sc, flags)
 automaton_t  *dfa;
+scan_t       *sc;
+int          flags;
 {
-    int         nstates, nab, j;
+    int         nstates, nab, j, r;
     state_t     i, s;
-    char        c[2];
+    char        c;
 
-    if (scanf("%d %d", &nstates, &nab) != 2)
+    if (scan_int(sc, &nstates) != TRUE || scan_int(sc, &nab) != TRUE)
 	Abort(("Input must begin with no_of_states alphabet_size\n"));
 
     if (nstates < 1)
@@ -100,30 +155,28 @@ automaton_t  *dfa;
     dfa->init_state = 1;	/* internal representation of state 0 */
 
     /* read-in alphabet symbols */
-    for (j = 1; j <= nab; j++) {
-	if (scanf("%1s",c) == 1) {
-	    ab_map[j] = c[0];
-	} else
-	    Abort(("Bad input while reading alphabet\n"));
-    }
-
-    /* read-in state-transition matrix + clear attributes */
-    for (i = 1; i <= nstates; i++) {
-	dfa->state_attrib[i] = '\0';	/* initialize attributes */
+    if (flags & INPUT_WORDS)
+	input_words(nab, sc);
+    else
 	for (j = 1; j <= nab; j++) {
-	    if (scanf("%d",&s) != 1)
-		Abort(("Bad input while reading states\n"));
-	    else {
-		if (s >= nstates)
-		    Abort(("State (%d) - out of range\n",s));
-		else
-		    dfa->mat[i][j] = (s >= 0) ? s + 1 : 0 ;
-	    }
+	    if (scan_sym(sc, &c) == TRUE) {
+		ab_map[j] = c;
+	    } else
+		Abort(("Bad input while reading alphabet\n"));
 	}
-    }
+
+    /* clear attributes + read-in state-transition matrix */
+    for (i = 1; i <= nstates; i++)
+	dfa->state_attrib[i] = '\0';	/* initialize attributes */
+    scan_matrix(sc, dfa);
+    if (flags & INPUT_MEALY)
+	input_outputs(dfa, sc);
+
     /* Read in list of accept-states */
     i = 0;
-    while (scanf("%d",&s) != EOF) {
+    while ((r = scan_int(sc, &s)) != EOF) {
+	if (r == FALSE)
+	    Abort(("Bad input while reading accept states\n"));
 	if (s < 0 || nstates <= s)
 	    Abort(("Accept state (%d) - out of range\n", s));
 	else {
@@ -146,7 +199,7 @@ automaton_t  *dfa;
 void  output_dfa (dfa)
 automaton_t  *dfa;
 {
-    int       j, empty = TRUE;  /* initially assume the automaton is empty */
+    int       j, len, w, empty = TRUE;  /* initially assume the automaton is empty */
     state_t   i, s;
 
     if (dfa->nstates == 0) {
@@ -154,10 +207,16 @@ automaton_t  *dfa;
 	return;
     }
 
+    if (dfa->outs != NULL) {
+	output_mealy(dfa);
+	return;
+    }
+
     printf("%9s","");
 
+    w = sym_width(5);
     for (j = 1; j <= dfa->nab; j++)
-	printf("%-5c",ab_map[j]);
+	print_sym(j, w);
 
     putchar('\n');
 
@@ -175,10 +234,11 @@ automaton_t  *dfa;
 	    s = dfa->mat[i][j];
 	    if (s <= 0 || IS_DEAD(s)) {
 		/* No transition from state i on symbol j */
-		printf("%-5c", '-');
+		len = printf("-");
 	    } else {
-		printf("%c%-4d", ATTRIB(s), s - 1);
+		len = printf("%c%d", ATTRIB(s), s - 1);
 	    }
+	    printf("%*s", len < w ? w - len : 0, "");
 	}
     }
     if (empty)
@@ -188,3 +248,327 @@ automaton_t  *dfa;
     
 }
 
+/*-------------------------------------------------------------------------
+|  void  write_dfa (fp, dfa)
+|  FILE         *fp;
+|  automaton_t  *dfa;
+|
+|  Write the canonically numbered (see module "canon.c") DFA 'dfa' to
+|  'fp' in the DFA input format; if its initial state is dead, as the
+|  DFA of the empty language: one state, without transitions.
+`------------------------------------------------------------------------*/
+
+void  write_dfa (fp, dfa)
+FILE         *fp;
+automaton_t  *dfa;
+{
+    int      j, n;
+    state_t  i;
+
+    n = IS_DEAD(dfa->init_state) ? 0 : dfa->nstates;
+    fprintf(fp, "%d %d\n", n > 0 ? n : 1, dfa->nab);
+    for (j = 1; j <= dfa->nab; j++)
+	fprintf(fp, "%c%c", ab_map[j], j == dfa->nab ? '\n' : ' ');
+    for (i = 1; i <= (n > 0 ? n : 1); i++)
+	for (j = 1; j <= dfa->nab; j++)
+	    fprintf(fp, "%d%c", (n > 0) ? dfa->mat[i][j] - 1 : -1,
+		    j == dfa->nab ? '\n' : ' ');
+    for (i = 1; i <= n; i++)
+	if (IS_ACCEPT(i))
+	    fprintf(fp, "%d ", i - 1);
+    fprintf(fp, "\n");
+}
+
+/*-------------------------------------------------------------------------
+|  static void  input_outputs (dfa, sc)
+|  automaton_t  *dfa;
+|  scan_t       *sc;
+|
+|  Inputs the matrix of output labels of the Mealy machine 'dfa' (whose
+|  transitions were just scanned by 'sc') into 'dfa->outs'.
+`------------------------------------------------------------------------*/
+
+static void  input_outputs (dfa, sc)
+automaton_t  *dfa;
+scan_t       *sc;
+{
+    int      j, o;
+    state_t  i;
+
+    dfa->outs = (int *) mem_alloc(MEM_AUTOMATON, (size_t) (dfa->nstates + 1)
+				  * (dfa->nab + 1) * sizeof(int));
+    for (i = 1; i <= dfa->nstates; i++)
+	for (j = 1; j <= dfa->nab; j++) {
+	    if (scan_int(sc, &o) != TRUE || o < -1)
+		Abort(("Bad input while reading output labels\n"));
+	    if (o >= 0 && dfa->mat[i][j] == 0)
+		Abort(("Output label (%d) on a missing transition of state %d\n",
+		       o, i - 1));
+	    OUT(dfa, i, j) = o + 1;
+	}
+}
+
+/*-------------------------------------------------------------------------
+|  static void  output_mealy (dfa)
+|  automaton_t  *dfa;
+|
+|  Print out the Mealy machine 'dfa' as output_dfa() does a DFA, every
+|  transition followed by "/" and its output label, if it has one.
+`------------------------------------------------------------------------*/
+
+static void  output_mealy (dfa)
+automaton_t  *dfa;
+{
+    int       j, len, w = sym_width(9), empty = TRUE;
+    state_t   i, s;
+
+    printf("%9s","");
+    for (j = 1; j <= dfa->nab; j++)
+	print_sym(j, w);
+    putchar('\n');
+
+    for (i = 1; i <= dfa->nstates; i++) {
+	if (IS_DEAD(i))
+	    continue;
+	empty = FALSE;
+
+	printf("\n%c%-8d", ATTRIB(i), i - 1);
+	for (j = 1; j <= dfa->nab; j++) {
+	    s = dfa->mat[i][j];
+	    if (s <= 0 || IS_DEAD(s))
+		len = printf("-");
+	    else
+		len = printf("%c%d", ATTRIB(s), s - 1);
+	    if (OUT(dfa, i, j) > 0)
+		len += printf("/%d", OUT(dfa, i, j) - 1);
+	    printf("%*s", len < w ? w - len : 1, "");
+	}
+    }
+    if (empty)
+	printf("DFA minimized to EMPTY DFA...\n");
+    else
+	printf("\n\nInitial state: %c%d\n", ATTRIB(dfa->init_state), dfa->init_state - 1);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  input_words (nab, sc)
+|  int     nab;
+|  scan_t  *sc;
+|
+|  Inputs the 'nab' words of an alphabet of words, scanned by 'sc', into
+|  a new 'ab_dict' (sealed for dict_lookup()).
+`------------------------------------------------------------------------*/
+
+static void  input_words (nab, sc)
+int     nab;
+scan_t  *sc;
+{
+    char  *w;
+    int   j, len;
+
+    ab_dict = dict_new(nab);
+    for (j = 1; j <= nab; j++) {
+	if (scan_word(sc, &w, &len) != TRUE)
+	    Abort(("Bad input while reading alphabet\n"));
+	if (len > DICT_WORD_MAX)
+	    Abort(("Alphabet symbol %d longer than %d characters\n",
+		   j, DICT_WORD_MAX));
+	if (dict_intern(ab_dict, w, len) != j)
+	    Abort(("Alphabet symbol %d (%.*s) given twice\n", j, len, w));
+    }
+    dict_seal(ab_dict);
+}
+
+/*-------------------------------------------------------------------------
+|  static int  sym_width (min)
+|  int  min;
+|
+|  The width of the columns of a printed DFA: 'min', or more for the
+|  symbols of an alphabet of words to fit.
+`------------------------------------------------------------------------*/
+
+static int  sym_width (min)
+int  min;
+{
+    return (ab_dict != NULL && ab_dict->maxlen >= min) ? ab_dict->maxlen + 1
+						       : min;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  print_sym (j, width)
+|  int  j, width;
+|
+|  Print the alphabet symbol 'j' in a column 'width' wide.
+`------------------------------------------------------------------------*/
+
+static void  print_sym (j, width)
+int  j, width;
+{
+    char  *w;
+    int   len;
+
+    if (ab_dict == NULL)
+	printf("%-*c", width, ab_map[j]);
+    else {
+	w = dict_word(ab_dict, j, &len);
+	printf("%-*.*s", width, len, w);
+    }
+}
+
+/*-------------------------------------------------------------------------
+|  void  input_nfa (nfa, sc)
+|  nfa_t   *nfa;
+|  scan_t  *sc;
+|
+|  Inputs an NFA, scanned by 'sc', into 'nfa' (see "NFA Input file
+|  format" above); its edges are sorted by source state, then symbol.
+`------------------------------------------------------------------------*/
+
+void  input_nfa (nfa, sc)
+nfa_t   *nfa;
+scan_t  *sc;
+{
+    int      nstates, nab, nedges, j, e, r;
+    int      sym[256];		/* sym[letter]: its symbol, 0 if none */
+    int      *esym, *order, *cnt;
+    state_t  *efrom, *eto, s, t;
+    char     c;
+
+    if (scan_int(sc, &nstates) != TRUE || scan_int(sc, &nab) != TRUE)
+	Abort(("Input must begin with no_of_states alphabet_size\n"));
+    if (nstates < 1)
+	Abort(("Nonsensible number of states (%d)\n", nstates));
+    if (nab < 1)
+	Abort(("Nonsensible number of alphabet symbols (%d)\n", nab));
+    if (nab > AB_SIZE)
+	Abort(("Alphabet size (%d) too large, recompile with \"-DAB_SIZE=%d\"\n",
+	       nab, nab));
+    nfa->nstates = nstates;
+    nfa->nab = nab;
+
+    /* read-in alphabet symbols */
+    for (j = 0; j < 256; j++)
+	sym[j] = 0;
+    for (j = 1; j <= nab; j++) {
+	if (scan_sym(sc, &c) != TRUE)
+	    Abort(("Bad input while reading alphabet\n"));
+	ab_map[j] = c;
+	sym[(unsigned char) c] = j;
+    }
+
+    /* read-in the edges */
+    if (scan_int(sc, &nedges) != TRUE || nedges < 0)
+	Abort(("Bad input while reading the number of edges\n"));
+    nfa->nedges = nedges;
+    efrom = (state_t *) mem_alloc(MEM_IO, (nedges + 1) * sizeof(state_t));
+    eto = (state_t *) mem_alloc(MEM_IO, (nedges + 1) * sizeof(state_t));
+    esym = (int *) mem_alloc(MEM_IO, (nedges + 1) * sizeof(int));
+    for (e = 0; e < nedges; e++) {
+	if (scan_int(sc, &s) != TRUE || scan_sym(sc, &c) != TRUE
+	    || scan_int(sc, &t) != TRUE)
+	    Abort(("Bad input while reading edges\n"));
+	if (s < 0 || nstates <= s)
+	    Abort(("State (%d) - out of range\n", s));
+	if (t < 0 || nstates <= t)
+	    Abort(("State (%d) - out of range\n", t));
+	if ((j = sym[(unsigned char) c]) == 0)
+	    Abort(("Letter '%c' - not in the alphabet\n", c));
+	efrom[e] = s + 1;
+	eto[e] = t + 1;
+	esym[e] = j;
+    }
+
+    /* sort them by symbol, then (stable) by source state */
+    order = (int *) mem_alloc(MEM_IO, (nedges + 1) * sizeof(int));
+    cnt = (int *) mem_alloc(MEM_IO, (nab + nstates + 2) * sizeof(int));
+    for (e = 0; e < nedges; e++)
+	cnt[esym[e]]++;
+    for (j = 1; j <= nab + 1; j++)
+	cnt[j] += cnt[j - 1];
+    for (e = nedges - 1; e >= 0; e--)
+	order[--cnt[esym[e]]] = e;
+
+    nfa->first = (int *) mem_alloc(MEM_AUTOMATON, (nstates + 2) * sizeof(int));
+    nfa->sym = (int *) mem_alloc(MEM_AUTOMATON, (nedges + 1) * sizeof(int));
+    nfa->to = (state_t *) mem_alloc(MEM_AUTOMATON,
+				    (nedges + 1) * sizeof(state_t));
+    nfa->accept = (char *) mem_alloc(MEM_AUTOMATON, nstates + 1);
+    for (e = 0; e < nedges; e++)
+	nfa->first[efrom[e] + 1]++;
+    for (s = 1; s <= nstates + 1; s++)
+	nfa->first[s] += nfa->first[s - 1];
+    for (s = 0; s <= nstates; s++)
+	cnt[s] = nfa->first[s];
+    for (j = 0; j < nedges; j++) {
+	e = order[j];
+	nfa->sym[cnt[efrom[e]]] = esym[e];
+	nfa->to[cnt[efrom[e]]++] = eto[e];
+    }
+    mem_free(cnt);
+    mem_free(order);
+    mem_free(esym);
+    mem_free(eto);
+    mem_free(efrom);
+
+    /* Read in list of accept-states */
+    while ((r = scan_int(sc, &s)) != EOF) {
+	if (r == FALSE)
+	    Abort(("Bad input while reading accept states\n"));
+	if (s < 0 || nstates <= s)
+	    Abort(("Accept state (%d) - out of range\n", s));
+	nfa->accept[s + 1] = TRUE;
+    }
+}
+
+/*-------------------------------------------------------------------------
+|  void  free_nfa (nfa)
+|  nfa_t  *nfa;
+|
+|  Release the edges & accept states of 'nfa'.
+`------------------------------------------------------------------------*/
+
+void  free_nfa (nfa)
+nfa_t  *nfa;
+{
+    mem_free(nfa->first);
+    mem_free(nfa->sym);
+    mem_free(nfa->to);
+    mem_free(nfa->accept);
+}
+
+/*-------------------------------------------------------------------------
+|  void  output_nfa (nfa)
+|  nfa_t  *nfa;
+|
+|  Print out the NFA 'nfa' in human readable form, as output_dfa() does
+|  a DFA: an entry of the table lists the targets of the edges of a
+|  state on a symbol, separated by commas.
+`------------------------------------------------------------------------*/
+
+void  output_nfa (nfa)
+nfa_t  *nfa;
+{
+    int      j, e, len;
+    state_t  i, t;
+
+    printf("%9s","");
+    for (j = 1; j <= nfa->nab; j++)
+	printf("%-9c",ab_map[j]);
+    putchar('\n');
+
+    for (i = 1; i <= nfa->nstates; i++) {
+	printf("\n%c%-8d", nfa->accept[i] ? 'A' : 's', i - 1);
+	e = nfa->first[i];
+	for (j = 1; j <= nfa->nab; j++) {
+	    for (len = 0; e < nfa->first[i + 1] && nfa->sym[e] == j; e++) {
+		t = nfa->to[e];
+		len += printf("%s%c%d", len > 0 ? "," : "",
+			      nfa->accept[t] ? 'A' : 's', t - 1);
+	    }
+	    if (len == 0)	/* No edge from state i on symbol j */
+		len = printf("-");
+	    printf("%*s", len < 9 ? 9 - len : 1, "");
+	}
+    }
+    printf("\n\nInitial state: %c0\n", nfa->accept[1] ? 'A' : 's');
+}
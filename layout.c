@@ -0,0 +1,94 @@
+/*-------------------------------------------------------------------------*\
+|  Module "layout.c"
+|
+|  Symbol-major (column) copy of a transition matrix.
+|
+|  The matrix 'mat[state][symbol]' is row-major: all the transitions of
+|  a state are adjacent, which suits output_dfa() and the row compares
+|  of the "aho" engine. A pass over one symbol at a time (building the
+|  inverse transitions of the "hopcroft" engine, say) strides through
+|  it by AB_SIZE + 1 entries though, touching a new cache line for
+|  every state. For such passes an engine may ask for a column copy,
+|  'dfa->cols', in which the transitions of every symbol are adjacent:
+|
+|      COL(dfa, a, p) == dfa->mat[p][a]     (p = 0 .. nstates)
+|
+|  The copy is made by a tiled transposition, so that both the matrix
+|  and the copy are walked a cache-friendly tile at a time.
+|
+|  The copy only pays for itself on large matrices: on the benchmark
+|  (bench.t) the "hopcroft" engine ran up to ~20% faster with it at
+|  20000 states x 64 symbols, but slower at 1000 x 64, where the whole
+|  matrix stays in cache anyway. So engines preferring the column
+|  layout get it from COL_MIN_ENTRIES transitions on (unless "-l"
+|  forces a layout).
+\*-------------------------------------------------------------------------*/
+
+#include "auto.h"
+
+#ifndef COL_MIN_ENTRIES
+#   define COL_MIN_ENTRIES	(1L << 18)	/* nstates * nab */
+#endif
+
+#ifndef LAYOUT_TILE
+#   define LAYOUT_TILE	32	/* states (and symbols) per tile */
+#endif
+
+/*-------------------------------------------------------------------------
+|  int  columns_pay (dfa)
+|  automaton_t  *dfa;
+|
+|  Return TRUE iff 'dfa' is large enough for an engine preferring the
+|  column layout to be given one.
+`------------------------------------------------------------------------*/
+
+int  columns_pay (dfa)
+automaton_t  *dfa;
+{
+    return (long) dfa->nstates * dfa->nab >= COL_MIN_ENTRIES;
+}
+
+/*-------------------------------------------------------------------------
+|  void  make_columns (dfa)
+|  automaton_t  *dfa;
+|
+|  Make the column copy 'dfa->cols' of the transitions of 'dfa'.
+`------------------------------------------------------------------------*/
+
+void  make_columns (dfa)
+automaton_t  *dfa;
+{
+    int      n = dfa->nstates, nab = dfa->nab;
+    int      p0, a0, p, a, pmax, amax;
+    state_t  *col;
+
+    dfa->cols = (state_t *) mem_alloc(MEM_LAYOUT,
+				      (size_t) nab * (n + 1) * sizeof(state_t));
+
+    for (p0 = 1; p0 <= n; p0 += LAYOUT_TILE) {
+	pmax = (p0 + LAYOUT_TILE - 1 < n) ? p0 + LAYOUT_TILE - 1 : n;
+	for (a0 = 1; a0 <= nab; a0 += LAYOUT_TILE) {
+	    amax = (a0 + LAYOUT_TILE - 1 < nab) ? a0 + LAYOUT_TILE - 1 : nab;
+	    for (a = a0; a <= amax; a++) {
+		col = &COL(dfa, a, 0);
+		for (p = p0; p <= pmax; p++)
+		    col[p] = dfa->mat[p][a];
+	    }
+	}
+    }
+}
+
+/*-------------------------------------------------------------------------
+|  void  free_columns (dfa)
+|  automaton_t  *dfa;
+|
+|  Release the column copy of 'dfa', if any.
+`------------------------------------------------------------------------*/
+
+void  free_columns (dfa)
+automaton_t  *dfa;
+{
+    if (dfa->cols != NULL)
+	mem_free(dfa->cols);
+    dfa->cols = NULL;
+}
@@ -0,0 +1,330 @@
+/*-------------------------------------------------------------------------*\
+|  Module "lazy.c"
+|
+|  Matching byte strings with an NFA through a lazily built DFA.
+|
+|  The matcher of a minimized DFA (module "match.c") comes out of a
+|  subset construction done in full before the scan. Determinizing an
+|  NFA may blow up - the NFA of "(a|b)*a(a|b)^k" has k + 2 states, its
+|  DFA 2^(k+1) - though any given text only visits a few of the subsets.
+|  So nothing is built in advance here: a DFA state (a set of NFA
+|  states, standing for the partial matches under way as in match.c) is
+|  made the first time the scan reaches it, and so is every transition,
+|  in a row of the state indexed by symbol (0: bytes not in the
+|  alphabet, which lead to the empty set).
+|
+|  The DFA states are cached in tables of a fixed size: at most 'max'
+|  states (see lazy_new()), and their NFA states in a pool of
+|  LAZY_SET_AVG per DFA state. When a new state doesn't fit, the cache
+|  is flushed: all the states and transitions are dropped, and only the
+|  current state is made again. Memory stays bounded whatever the text,
+|  and while the states of the common paths fit in the cache the scan
+|  runs as fast as a DFA's - one table lookup per byte.
+|
+|  The cached fragment is not minimized: two states of it may only be
+|  merged once all their transitions are known, which over a fragment
+|  built by a scan is rarely the case; flushing is what keeps it small.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "auto.h"
+
+#define NEXT(LZ, S, C)	((LZ)->next[(size_t) (S) * (LZ)->width + (C)])
+
+#define LAZY_ACCEPT	1	/* kind[S]: 'S' is an accept state     */
+#define LAZY_DEAD	2	/* ... the empty set, matching anchored */
+
+#ifndef LAZY_SET_AVG
+#   define LAZY_SET_AVG	16	/* NFA states per cached DFA state */
+#endif
+
+extern char  ab_map[];
+
+void          feed_file ();
+
+static int    add_set ();
+static int    step ();
+static void   flush ();
+static int    cmp_states ();
+
+/*-------------------------------------------------------------------------
+|  lazy_t  *lazy_new (nfa, max, anchored)
+|  nfa_t  *nfa;
+|  int    max;
+|  int    anchored;
+|
+|  Make a lazy matcher of the NFA 'nfa', caching at most 'max' DFA
+|  states; if 'anchored', of the matches starting at the start of the
+|  input only.
+`------------------------------------------------------------------------*/
+
+lazy_t  *lazy_new (nfa, max, anchored)
+nfa_t  *nfa;
+int    max;
+int    anchored;
+{
+    lazy_t  *lz;
+    int     j;
+
+    if (max < 2)		/* room for a state and its successor */
+	max = 2;
+    lz = (lazy_t *) mem_alloc(MEM_MATCHER, sizeof(lazy_t));
+    lz->nfa = nfa;
+    lz->anchored = anchored;
+    lz->width = nfa->nab + 1;
+    for (j = 1; j <= nfa->nab; j++)
+	lz->cls[(unsigned char) ab_map[j]] = j;
+    lz->max = max;
+
+    lz->next = (int *) mem_alloc(MEM_MATCHER,
+				 (size_t) (max + 1) * lz->width * sizeof(int));
+    lz->kind = (char *) mem_alloc(MEM_MATCHER, max + 1);
+    /* after a flush, the current state and its successor always fit */
+    lz->pool_size = (size_t) max * LAZY_SET_AVG + 2 * nfa->nstates;
+    lz->pool = (state_t *) mem_alloc(MEM_MATCHER,
+				     lz->pool_size * sizeof(state_t));
+    lz->set_at = (size_t *) mem_alloc(MEM_MATCHER,
+				      (max + 1) * sizeof(size_t));
+    lz->set_len = (int *) mem_alloc(MEM_MATCHER, (max + 1) * sizeof(int));
+    lz->htab = (int *) mem_alloc(MEM_MATCHER, 2 * max * sizeof(int));
+    lz->set = (state_t *) mem_alloc(MEM_MATCHER,
+				    (nfa->nstates + 1) * sizeof(state_t));
+    lz->keep = (state_t *) mem_alloc(MEM_MATCHER,
+				     (nfa->nstates + 1) * sizeof(state_t));
+    lz->mark = (int *) mem_alloc(MEM_MATCHER,
+				 (nfa->nstates + 1) * sizeof(int));
+    return lz;
+}
+
+/*-------------------------------------------------------------------------
+|  void  lazy_free (lz)
+|  lazy_t  *lz;
+|
+|  Release the lazy matcher 'lz' (but not its NFA).
+`------------------------------------------------------------------------*/
+
+void  lazy_free (lz)
+lazy_t  *lz;
+{
+    mem_free(lz->mark);
+    mem_free(lz->keep);
+    mem_free(lz->set);
+    mem_free(lz->htab);
+    mem_free(lz->set_len);
+    mem_free(lz->set_at);
+    mem_free(lz->pool);
+    mem_free(lz->kind);
+    mem_free(lz->next);
+    mem_free(lz);
+}
+
+/*-------------------------------------------------------------------------
+|  void  lazy_start (lz, report, arg)
+|  lazy_t  *lz;
+|  void    (*report) ();
+|  void    *arg;
+|
+|  Start 'lz' on a new stream, calling (*report)(arg, offset) at every
+|  match as match_start() does. The cache is kept from stream to stream.
+`------------------------------------------------------------------------*/
+
+void  lazy_start (lz, report, arg)
+lazy_t  *lz;
+void    (*report) ();
+void    *arg;
+{
+    int  len = lz->anchored ? 1 : 0;	/* {initial state}, or the empty set */
+
+    lz->set[0] = 1;
+    if ((lz->s = add_set(lz, lz->set, len)) == 0) {
+	flush(lz);
+	lz->s = add_set(lz, lz->set, len);
+    }
+    lz->offset = 0;
+    lz->count = 0;
+    lz->report = report;
+    lz->arg = arg;
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  lazy_feed (lz, buf, len)
+|  lazy_t         *lz;
+|  unsigned char  *buf;
+|  size_t         len;
+|
+|  Scan the next 'len' bytes of the stream of 'lz', at 'buf', making
+|  the states & transitions not cached on the way. Return the number of
+|  matches ending in them.
+`------------------------------------------------------------------------*/
+
+size_t  lazy_feed (lz, buf, len)
+lazy_t         *lz;
+unsigned char  *buf;
+size_t         len;
+{
+    unsigned char  *p = buf, *end = buf + len;
+    int            S = lz->s, T, c;
+    size_t         count = 0;
+
+    lz->scanned += len;
+    while (p < end) {
+	c = lz->cls[*p++];
+	if ((T = NEXT(lz, S, c)) == 0)
+	    T = step(lz, S, c);
+	S = T;
+	if (lz->kind[S] == 0)
+	    continue;
+	if (lz->kind[S] & LAZY_DEAD) {	/* no match can start any more */
+	    lz->skipped += end - p;
+	    break;
+	}
+	count++;
+	if (lz->report != NULL)
+	    (*lz->report)(lz->arg, lz->offset + (size_t) (p - buf));
+    }
+    lz->s = S;
+    lz->offset += len;
+    lz->count += count;
+    return count;
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  lazy_file (lz, name, report, arg)
+|  lazy_t  *lz;
+|  char    *name;
+|  void    (*report) ();
+|  void    *arg;
+|
+|  Scan the file 'name' with 'lz' as a stream (see lazy_start() and
+|  feed_file()). Return the number of matches.
+`------------------------------------------------------------------------*/
+
+size_t  lazy_file (lz, name, report, arg)
+lazy_t  *lz;
+char    *name;
+void    (*report) ();
+void    *arg;
+{
+    lazy_start(lz, report, arg);
+    feed_file(name, lazy_feed, (void *) lz);
+    return lz->count;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  step (lz, S, c)
+|  lazy_t  *lz;
+|  int     S, c;
+|
+|  Make (and cache) the transition of state 'S' on symbol 'c', and return
+|  its target; the cache is flushed if the target doesn't fit in it.
+`------------------------------------------------------------------------*/
+
+static int  step (lz, S, c)
+lazy_t  *lz;
+int     S, c;
+{
+    nfa_t    *nfa = lz->nfa;
+    state_t  *set = lz->set, *from = &lz->pool[lz->set_at[S]], q, t;
+    int      i, e, len = 0, nfrom = lz->set_len[S], T;
+
+    if (++lz->stamp < 0) {		/* wrapped around */
+	memset(lz->mark, 0, (nfa->nstates + 1) * sizeof(int));
+	lz->stamp = 1;
+    }
+    for (i = lz->anchored ? 0 : -1; i < nfrom; i++) {
+	/* -1: a match may start here */
+	q = (i < 0) ? 1 : from[i];
+	for (e = nfa->first[q]; e < nfa->first[q + 1] && nfa->sym[e] <= c; e++)
+	    if (nfa->sym[e] == c && lz->mark[t = nfa->to[e]] != lz->stamp) {
+		lz->mark[t] = lz->stamp;
+		set[len++] = t;
+	    }
+    }
+    qsort((char *) set, len, sizeof(state_t), cmp_states);
+
+    if ((T = add_set(lz, set, len)) == 0) {	/* the cache is full */
+	memcpy(lz->keep, from, nfrom * sizeof(state_t));
+	flush(lz);
+	S = add_set(lz, lz->keep, nfrom);
+	T = add_set(lz, set, len);
+    }
+    NEXT(lz, S, c) = T;
+    return T;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  add_set (lz, set, len)
+|  lazy_t   *lz;
+|  state_t  set[];
+|  int      len;
+|
+|  Return the cached DFA state of the sorted set of NFA states 'set[0 ..
+|  len-1]', making it if the set isn't cached; return 0 if there is no
+|  room left in the cache for it.
+`------------------------------------------------------------------------*/
+
+static int  add_set (lz, set, len)
+lazy_t   *lz;
+state_t  set[];
+int      len;
+{
+    unsigned  h = 2166136261u, hsize = 2 * lz->max;
+    int       i, S;
+
+    for (i = 0; i < len; i++)
+	h = (h ^ (unsigned) set[i]) * 16777619u;
+    for (h %= hsize; (S = lz->htab[h]) != 0; h = (h + 1) % hsize)
+	if (lz->set_len[S] == len
+	    && memcmp(&lz->pool[lz->set_at[S]], set, len * sizeof(state_t)) == 0)
+	    return S;
+
+    if (lz->nsets == lz->max || lz->pool_len + len > lz->pool_size)
+	return 0;
+    S = ++lz->nsets;
+    lz->htab[h] = S;
+    lz->set_at[S] = lz->pool_len;
+    lz->set_len[S] = len;
+    memcpy(&lz->pool[lz->pool_len], set, len * sizeof(state_t));
+    lz->pool_len += len;
+    memset(&NEXT(lz, S, 0), 0, lz->width * sizeof(int));
+    lz->kind[S] = 0;
+    for (i = 0; i < len; i++)
+	if (lz->nfa->accept[set[i]])
+	    lz->kind[S] = LAZY_ACCEPT;
+    if (len == 0 && lz->anchored)
+	lz->kind[S] = LAZY_DEAD;
+    lz->made++;
+    return S;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  flush (lz)
+|  lazy_t  *lz;
+|
+|  Drop all the states (and so transitions) cached by 'lz'.
+`------------------------------------------------------------------------*/
+
+static void  flush (lz)
+lazy_t  *lz;
+{
+    memset(lz->htab, 0, 2 * lz->max * sizeof(int));
+    lz->nsets = 0;
+    lz->pool_len = 0;
+    lz->flushes++;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  cmp_states (a, b)
+|  state_t  *a, *b;
+|
+|  qsort() comparison of two states.
+`------------------------------------------------------------------------*/
+
+static int  cmp_states (a, b)
+state_t  *a, *b;
+{
+    return *a - *b;
+}
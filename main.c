@@ -3,10 +3,116 @@
 |
 |  Synopsis:
 |
-|             minauto   [ dfa_1 ... dfa_N ]
+|             minauto   [ options ]  [ dfa_1 ... dfa_N ]
 |
 |    Where each 'dfa_i' is a filename containing a DFA description.
 |    When no arguments are given - standard input is assumed.
+|    The files of a batch are read ahead (see module "batch.c").
+|    Compressed (gzip, zstd) inputs are decompressed on the fly.
+|
+|  Options:
+|
+|    -t tracefile   Write a timeline of the run (parse, refinement rounds,
+|                   output...) to 'tracefile' in Chrome trace-event JSON.
+|    -s             Print statistics of every DFA (sizes, partition rounds,
+|                   current & peak memory per data structure) to stderr.
+|    -m bytes       Abort cleanly when tracked memory would exceed 'bytes'
+|                   (a 'k', 'm' or 'g' suffix multiplies by 2^10, 2^20, 2^30).
+|    -e engine      Minimization engine: "auto" (default: chosen by the
+|                   shape of each DFA, see module "select.c"), "aho",
+|                   "hopcroft", "acyclic" or "scc" (also spelled --engine
+|                   engine).
+|    -c             Print the minimized DFA canonically numbered (live states
+|                   only, breadth-first from the initial state), so results
+|                   of different engines can be compared textually.
+|    -v             Verify that the minimized DFA is equivalent to the input
+|                   DFA (Hopcroft-Karp); abort if it is not.
+|    -w             The inputs are Mealy machines: their transitions carry
+|                   output labels (see module "inout.c"), which the
+|                   minimized machine keeps. They are minimized by the
+|                   "hopcroft" engine (the only one that splits by the
+|                   labels): another one can not be requested.
+|    -k             The alphabets are words (see module "inout.c"), e.g.
+|                   tokens or opcodes, interned in a dictionary (module
+|                   "dict.c"); -x scans a text of white-space separated
+|                   words with them. Not with -p, -o, -d or -n.
+|    -j threads     Parse large transition matrices with 'threads' threads.
+|    -l layout      Transition layout for the engine: "row", "col" to
+|                   give it a symbol-major copy of the matrix as well (by
+|                   default engines preferring "col" get it for large
+|                   matrices, see module "layout.c"), or "packed" for a
+|                   delta + varint compressed copy (module "packed.c").
+|                   Engines fall back to "row" for layouts they can't use.
+|    -p             Print the prefilter of the minimized DFA: a literal
+|                   every match contains, and the bytes matches begin
+|                   with (see module "prefilter.c").
+|    -x textfile    Scan 'textfile' with every minimized DFA (see module
+|                   "match.c"), printing the offset of the end of every
+|                   match. A 'textfile' of "-" is the standard input,
+|                   scanned as it comes in.
+|    -a             Anchored -x scans: only matches starting at the start
+|                   of the text.
+|    -o             One pass: scan the text of -x once, after the last
+|                   DFA, with all the minimized DFAs together (see module
+|                   "multi.c"), printing the offset & name of every match.
+|    -d depth       Scan -x with the matcher compressed by default
+|                   transitions (see module "d2fa.c"), taking at most
+|                   'depth' of them in a row.
+|    -n states      The inputs are NFAs (see module "inout.c"), which are
+|                   not minimized but matched by -x through a DFA built
+|                   lazily as the text is scanned, in a cache of at most
+|                   'states' states (see module "lazy.c").
+|    -f length      Also print a minimal cover automaton of the minimized
+|                   DFA, for words of at most 'length' symbols: a DFA
+|                   accepting the same of these, and maybe longer words
+|                   too (see module "cover.c"). The language must be
+|                   finite. -v checks the cover, -c numbers it
+|                   canonically. Not with -w.
+|    -r states      Also print a DFA of at most 'states' states accepting
+|                   the words of the minimized DFA, and more: a smaller
+|                   prefilter for it (see module "reduce.c"). The states
+|                   merged are chosen on the text of -x (not "-"), on
+|                   which the false positives added are then counted.
+|                   -v checks it, -c numbers it canonically. Not with
+|                   -w, -k or -n.
+|    -i             Also print the minimal DFA of the reversed language
+|                   (see module "reverse.c"); -x then prints the start of
+|                   every match before its end, found by running it
+|                   backwards from the end. Not with -w, -k, -b, -o, -d
+|                   or -n.
+|    -z certfile    Write to 'certfile' the certificate of the DFA (of a
+|                   single dfa_file): the map of its states to those of
+|                   the minimized DFA, and the latter (see module
+|                   "cert.c").
+|    -y certfile    Don't minimize the DFA (of a single dfa_file), but
+|                   check that of the certificate 'certfile' is its
+|                   minimal DFA, by the map of the certificate (also
+|                   spelled --verify certfile). Not with -w, -k, -b or
+|                   -n.
+|    -q tablefile   Write to 'tablefile' the minimized DFA (of a single
+|                   dfa_file), canonically numbered, in the DFA input
+|                   format: the table matchers load.
+|    -u patchfile   Write to 'patchfile' the patch from the minimized DFA
+|                   of the first of two dfa_files (the old version) to
+|                   that of the second (the new one): the rows of the
+|                   table of -q that changed (see module "diff.c").
+|    -g patchfile   Don't minimize the DFA (of a single dfa_file, a table
+|                   of -q), but apply the patch 'patchfile' to it, and
+|                   replace the file by the DFA patched, at once. Not
+|                   with -w, -k, -b or -n, nor with -q, -u, -z or -y.
+|    -h packfile    Write to 'packfile' a pack of the minimized DFAs of
+|                   the batch, canonically numbered, each found by the
+|                   name of its dfa_file (see module "pack.c"). Not with
+|                   -w, -k, -b, -n, -g or -y.
+|    -H packfile    The dfa_files are the names of DFAs in the pack
+|                   'packfile', which is mapped into memory: they are
+|                   found in it, printed, and matched by -x (with -p,
+|                   -a, -o or -d), as they are minimized already.
+|    -b             The inputs are labelled transition systems, in the
+|                   NFA format (see module "inout.c"), minimized modulo
+|                   strong bisimulation (Paige-Tarjan, see module
+|                   "bisim.c"); -v checks the classes found are one.
+|                   Not with -x, -w, -k or -p.
 |
 |  Input:
 |
@@ -20,7 +126,8 @@
 |
 |  Algorithm:
 |
-|    Generally - as outlined in Aho & Ullman "Principles of Compiler design"
+|    Generally (engine "aho") - as outlined in Aho & Ullman "Principles
+|    of Compiler design"
 |
 |    Partition is done using Robert Tarjan's fast Union-Find algorithm.
 |
@@ -30,6 +137,10 @@
 |    and not only after an entire partition iteration is completed on all
 |    the groups of the previous iteration.
 |
+|    Engine "hopcroft" is Hopcroft's O(n k log n) partition refinement.
+|    Engine "acyclic" is Revuz's linear algorithm for acyclic DFAs.
+|    Engine "scc" minimizes nearly acyclic DFAs SCC by SCC.
+|
 |    Dead states are discovered using Warshall's transitive-closure
 |    algorithm.
 |
@@ -43,45 +154,279 @@
 |    Module "main.c"    -   Main program.
 |    Module "ufind.c"   -   Union-Find functions.
 |    Module "partit.c"  -   Initialize partitions and partition iteration.
+|    Module "rpart.c"   -   Refinable partition data structure.
+|    Module "hopcroft.c"-   Hopcroft's partition refinement engine.
+|    Module "acyclic.c" -   Revuz's engine for acyclic DFAs.
+|    Module "scc.c"     -   SCC-ordered engine for nearly acyclic DFAs.
+|    Module "select.c"  -   Automatic engine selection.
+|    Module "canon.c"   -   Canonical numbering of minimized DFAs.
+|    Module "equiv.c"   -   DFA equivalence (Hopcroft-Karp).
 |    Module "dead.c"    -   Find dead-states (transitive closure) functions.
 |    Module "inout.c"   -   DFA-input and DFA-output functions.
+|    Module "scan.c"    -   Input loading & (parallel) tokenizing.
+|    Module "batch.c"   -   Read-ahead of batch input files (io_uring).
+|    Module "decomp.c"  -   Streaming decompression of compressed input.
+|    Module "layout.c"  -   Symbol-major copy of transition matrices.
+|    Module "packed.c"  -   Delta + varint compressed transition rows.
+|    Module "match.c"   -   Matching byte strings with minimized DFAs.
+|    Module "prefilter.c" - Literal prefilters of minimized DFAs.
+|    Module "multi.c"   -   Matching many minimized DFAs in one pass.
+|    Module "lazy.c"    -   Matching NFAs through a lazily built DFA.
+|    Module "d2fa.c"    -   Default-transition compression of matchers.
+|    Module "dict.c"    -   Dictionaries of multi-character symbols.
+|    Module "bisim.c"   -   Bisimulation minimization of LTSs.
+|    Module "cover.c"   -   Minimal cover automata of finite languages.
+|    Module "reduce.c"  -   Over-approximating reduction of DFAs.
+|    Module "reverse.c" -   Minimal DFAs of reversed languages.
+|    Module "cert.c"    -   Certificates of minimization results.
+|    Module "diff.c"    -   Patches between versions of minimized DFAs.
+|    Module "pack.c"    -   Packs of minimized DFAs, found by name.
+|    Module "trace.c"   -   Optional trace-event timeline output.
+|    Module "mem.c"     -   Tracked memory allocation & accounting.
 \*--------------------------------------------------------------------------*/
 
 
 #include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <errno.h>
+#include  <time.h>
 #include  "auto.h"
 
+static void     usage ();
+static size_t   parse_size ();
 static void     process_file ();
+static void     print_stats ();
+static double   now_usec ();
 static void     minimize_dfa ();
 static void     compress_dfa ();
+static void     scan_text ();
 
 void            input_dfa ();
 void            output_dfa ();
 void            find_dead_states ();
+void            trace_open ();
+void            trace_close ();
+void            trace_begin ();
+void            trace_end ();
+void            mem_set_cap ();
+void            mem_report ();
+void            scan_set_threads ();
+void            scan_open ();
+void            scan_close ();
+void            batch_open ();
+int             batch_next ();
+void            batch_close ();
+void            canon_dfa ();
+int             equiv_dfa ();
+int             aho_refine ();
+int             hopcroft_refine ();
+int             acyclic_refine ();
+int             scc_refine ();
+void            dfa_features ();
+char            *select_engine ();
+int             columns_pay ();
+void            make_columns ();
+void            free_columns ();
+void            make_packed ();
+void            free_packed ();
+size_t          packed_size ();
+matcher_t       *match_compile ();
+void            match_free ();
+size_t          match_file ();
+void            find_prefilter ();
+void            print_prefilter ();
+multi_t         *multi_new ();
+void            multi_add ();
+void            multi_build ();
+size_t          multi_file ();
+void            multi_free ();
+static void     scan_one_pass ();
+static void     print_multi_match ();
+static void     print_match ();
+static void     process_nfa ();
+static void     process_lts ();
+void            input_nfa ();
+void            output_nfa ();
+void            free_nfa ();
+lazy_t          *lazy_new ();
+size_t          lazy_file ();
+void            lazy_free ();
+d2fa_t          *d2fa_build ();
+size_t          d2fa_file ();
+void            d2fa_free ();
+void            dict_free ();
+int             bisim_refine ();
+void            bisim_quotient ();
+int             bisim_check ();
+void            cover_dfa ();
+int             cover_check ();
+int             reduce_dfa ();
+int             reduce_check ();
+static void     reduce_text ();
+static void     reverse ();
+void            reverse_dfa ();
+size_t          match_scan ();
+size_t          match_back ();
+void            feed_file ();
+static size_t   add_text ();
+static void     print_span ();
+void            cert_write ();
+state_t         *cert_read ();
+char            *cert_check ();
+static void     verify_cert ();
+void            write_dfa ();
+long            diff_write ();
+int             diff_apply ();
+void            diff_switch ();
+static void     write_table ();
+static void     patch_file ();
+pack_t          *pack_new ();
+void            pack_add ();
+long            pack_write ();
+pack_t          *pack_open ();
+int             pack_find ();
+void            pack_load ();
+void            pack_free ();
+static void     process_packed ();
 
 #if DEBUG > 0
   void dump_state ();
 #endif
 
 extern state_t   find ();
+extern dict_t    *ab_dict;
+extern char      ab_map[];
 
 
-static automaton_t   in_dfa;	/* Input DFA  */
-static automaton_t   out_dfa;	/* Output DFA */
+static automaton_t   *in_dfa;	/* Input DFA  */
+static automaton_t   *out_dfa;	/* Output DFA */
+static automaton_t   *cover;	/* -f: its cover automaton */
+static automaton_t   *reduced;	/* -r: its reduction       */
+static automaton_t   *reversed;	/* -i: of its reversed language */
+static automaton_t   *table;	/* -q, -u: canonically numbered */
+static automaton_t   *base;	/* -u: ... of the old version   */
 
 /*
  |  The partition into equivalence-classes or groups (Union-Find) array
  |  (see module "ufind.c" for details)
  */
-static state_t   groups[MAX_STATES + 1];
+static state_t   *groups;
+
+/*
+ |  Minimization engines: each partitions the states of a DFA into
+ |  equivalence-classes, in Union-Find form, and returns the number
+ |  of refinement rounds (or steps) it took.
+ */
+typedef struct {
+	char	*name;
+	int	(*refine) ();
+	int	layout;		/* preferred transition layout (LAYOUT_xxx) */
+	int	layouts;	/* layouts it can use (LAYOUT_MASK()s)      */
+} engine_t;
+
+#define L_ROW		LAYOUT_MASK(LAYOUT_ROW)
+#define L_COL		LAYOUT_MASK(LAYOUT_COL)
+#define L_PACKED	LAYOUT_MASK(LAYOUT_PACKED)
+
+static engine_t  engines[] = {
+	{ "auto",	NULL,		  LAYOUT_ROW, L_ROW },	/* module "select.c"   */
+	{ "aho",	aho_refine,	  LAYOUT_ROW, L_ROW },	/* module "partit.c"   */
+	{ "hopcroft",	hopcroft_refine,  LAYOUT_COL, L_ROW | L_COL | L_PACKED },
+							/* module "hopcroft.c" */
+	{ "acyclic",	acyclic_refine,	  LAYOUT_ROW, L_ROW | L_PACKED },
+							/* module "acyclic.c"  */
+	{ "scc",	scc_refine,	  LAYOUT_ROW, L_ROW },	/* module "scc.c"      */
+	{ NULL,		NULL,		  LAYOUT_ROW, L_ROW }
+};
+
+static char  *layout_names[] = { "row", "col", "packed", NULL };
+
+static engine_t  *engine = &engines[0];	/* requested engine */
+static engine_t  *used;			/* engine used for the current DFA */
+static features_t features;		/* ... chosen by these features    */
+static int       canon_flag = FALSE;	/* -c: canonical numbering */
+static int       verify_flag = FALSE;	/* -v: equivalence check   */
+static int       layout = -1;		/* -l: layout (-1: engine's) */
+static int       prefilter_flag = FALSE;	/* -p: print the prefilter */
+static char      *text_file = NULL;	/* -x: text to scan          */
+static int       anchored_flag = FALSE;	/* -a: ... from its start only */
+static multi_t   *one_pass = NULL;	/* -o: ... by all DFAs at once  */
+static int       nfa_cache = 0;		/* -n: NFAs, lazy DFA states    */
+static int       d2fa_depth = 0;	/* -d: default chains, at most  */
+static int       mealy_flag = FALSE;	/* -w: output labels         */
+static int       words_flag = FALSE;	/* -k: alphabets of words    */
+static int       lts_flag = FALSE;	/* -b: LTSs, by bisimulation */
+static int       cover_len = 0;		/* -f: cover automata, words <= */
+static int       reduce_states = 0;	/* -r: reductions, states <=    */
+static int       reverse_flag = FALSE;	/* -i: reversed DFAs, match starts */
+static FILE      *cert_out = NULL;	/* -z: certificate written   */
+static char      *cert_in = NULL;	/* -y: certificate checked   */
+static FILE      *table_out = NULL;	/* -q: table written         */
+static FILE      *patch_out = NULL;	/* -u: patch written         */
+static char      *patch_in = NULL;	/* -g: patch applied         */
+static char      *base_name = NULL;	/* -u: the old version       */
+static char      base_ab[AB_SIZE + 1];	/* ... its alphabet          */
+static pack_t    *pack_out = NULL;	/* -h: pack written ...      */
+static FILE      *pack_file = NULL;	/* ... to this file          */
+static pack_t    *pack_in = NULL;	/* -H: pack the DFAs are in  */
+static char      *pack_name = NULL;
+
+/*
+ |  The text of -x in memory (-i): the start of a match is found back
+ |  from its end, with the matcher of the reversed DFA
+ */
+typedef struct {
+	unsigned char	*buf;
+	size_t		len;
+	size_t		size;
+	matcher_t	*back;		/* anchored */
+} text_t;
+
+/*
+ |  Statistics of the DFA being processed (printed with the -s option)
+ */
+static int       stats_flag = FALSE;
+static struct {
+	int	in_states;	/* states of the input DFA           */
+	int	out_states;	/* states of the compressed DFA      */
+	int	live_states;	/* ... of which are not dead         */
+	int	rounds;		/* refinement rounds until stability */
+	int	layout;		/* transition layout used (LAYOUT_xxx) */
+	size_t	matrix_bytes;	/* n * nab transitions, unpacked     */
+	size_t	packed_bytes;	/* LAYOUT_PACKED: size of the store  */
+	double	pack_usec;	/* ... and time to make it           */
+	double	usec;		/* minimization time (microseconds)  */
+	double	refine_usec;	/* ... of which spent by the engine  */
+	double	select_usec;	/* ... choosing it ("auto")          */
+	size_t	text_bytes;	/* -x: size of the text scanned      */
+	size_t	matches;	/* ... matches found                 */
+	int	cover_states;	/* -f: states of the cover automaton */
+	int	red_states;	/* -r: states of the reduced DFA     */
+	int	merges;		/* ... merges made                   */
+	int	rev_states;	/* -i: states of the reversed DFA    */
+	size_t	red_matches;	/* ... its matches on the text       */
+	size_t	exact_matches;	/* ... those of the minimized DFA    */
+	size_t	skipped;	/* ... bytes skipped by acceleration */
+	int	mstates;	/* ... matcher states                */
+	int	naccel;		/* ... of which accelerated          */
+	size_t	table_bytes;	/* -d: matcher table size            */
+	size_t	d2fa_bytes;	/* ... D2FA tables                   */
+	size_t	labeled;	/* ... its labeled transitions       */
+	int	roots;		/* ... states without a default      */
+	int	depth;		/* ... longest chain of defaults     */
+	size_t	hops;		/* ... defaults taken while scanning */
+	double	match_usec;	/* ... scanning time                 */
+} stats;
 
 /*-------------------------------------------------------------------------
 |  main (argc, argv)
 |  int   argc;
 |  char  *argv[];
 |
-|  Main program - each argument is a DFA description file.
-|  when no arguments standard input is processed
+|  Main program - leading '-x' arguments are options,
+|  each remaining argument is a DFA description file.
+|  when no file arguments standard input is processed
 `------------------------------------------------------------------------*/
 
 main (argc, argv)
@@ -90,40 +435,462 @@ char *argv[];
 {
     int    i;
 
-    if (argc > 1) {            /* Handle arguments one by one */
-	for (i = 1; i < argc; i++) {
+    for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+	if (strcmp(argv[i], "--engine") == 0)
+	    argv[i] = "-e";
+	if (strcmp(argv[i], "--verify") == 0)
+	    argv[i] = "-y";
+	switch (argv[i][1]) {
+	case 't':              /* -t tracefile */
+	    if (++i >= argc)
+		usage();
+	    trace_open(argv[i]);
+	    break;
+	case 's':              /* -s */
+	    stats_flag = TRUE;
+	    break;
+	case 'm':              /* -m bytes */
+	    if (++i >= argc)
+		usage();
+	    mem_set_cap(parse_size(argv[i]));
+	    break;
+	case 'e':              /* -e engine */
+	    if (++i >= argc)
+		usage();
+	    for (engine = engines; engine->name != NULL; engine++)
+		if (strcmp(engine->name, argv[i]) == 0)
+		    break;
+	    if (engine->name == NULL)
+		usage();
+	    break;
+	case 'j':              /* -j threads */
+	    if (++i >= argc)
+		usage();
+	    scan_set_threads(atoi(argv[i]));
+	    break;
+	case 'l':              /* -l layout */
+	    if (++i >= argc)
+		usage();
+	    for (layout = 0; layout_names[layout] != NULL; layout++)
+		if (strcmp(layout_names[layout], argv[i]) == 0)
+		    break;
+	    if (layout_names[layout] == NULL)
+		usage();
+	    break;
+	case 'c':              /* -c */
+	    canon_flag = TRUE;
+	    break;
+	case 'v':              /* -v */
+	    verify_flag = TRUE;
+	    break;
+	case 'w':              /* -w */
+	    mealy_flag = TRUE;
+	    break;
+	case 'k':              /* -k */
+	    words_flag = TRUE;
+	    break;
+	case 'b':              /* -b */
+	    lts_flag = TRUE;
+	    break;
+	case 'f':              /* -f length */
+	    if (++i >= argc || (cover_len = atoi(argv[i])) < 1)
+		usage();
+	    break;
+	case 'r':              /* -r states */
+	    if (++i >= argc || (reduce_states = atoi(argv[i])) < 1)
+		usage();
+	    break;
+	case 'z':              /* -z certfile */
+	    if (++i >= argc)
+		usage();
+	    if ((cert_out = fopen(argv[i], "w")) == NULL) {
+		perror(argv[i]);
+		exit(1);
+	    }
+	    break;
+	case 'y':              /* -y certfile */
+	    if (++i >= argc)
+		usage();
+	    cert_in = argv[i];
+	    break;
+	case 'q':              /* -q tablefile */
+	    if (++i >= argc)
+		usage();
+	    if ((table_out = fopen(argv[i], "w")) == NULL) {
+		perror(argv[i]);
+		exit(1);
+	    }
+	    break;
+	case 'u':              /* -u patchfile */
+	    if (++i >= argc)
+		usage();
+	    if ((patch_out = fopen(argv[i], "w")) == NULL) {
+		perror(argv[i]);
+		exit(1);
+	    }
+	    break;
+	case 'h':              /* -h packfile */
+	    if (++i >= argc)
+		usage();
+	    if ((pack_file = fopen(argv[i], "w")) == NULL) {
+		perror(argv[i]);
+		exit(1);
+	    }
+	    pack_out = pack_new();
+	    break;
+	case 'H':              /* -H packfile */
+	    if (++i >= argc)
+		usage();
+	    pack_name = argv[i];
+	    break;
+	case 'g':              /* -g patchfile */
+	    if (++i >= argc)
+		usage();
+	    patch_in = argv[i];
+	    break;
+	case 'i':              /* -i */
+	    reverse_flag = TRUE;
+	    break;
+	case 'a':              /* -a */
+	    anchored_flag = TRUE;
+	    break;
+	case 'o':              /* -o */
+	    if (one_pass == NULL)
+		one_pass = multi_new();
+	    break;
+	case 'p':              /* -p */
+	    prefilter_flag = TRUE;
+	    break;
+	case 'x':              /* -x textfile */
+	    if (++i >= argc)
+		usage();
+	    text_file = argv[i];
+	    break;
+	case 'd':              /* -d depth */
+	    if (++i >= argc || (d2fa_depth = atoi(argv[i])) < 1)
+		usage();
+	    break;
+	case 'n':              /* -n states */
+	    if (++i >= argc || (nfa_cache = atoi(argv[i])) < 1)
+		usage();
+	    break;
+	default:
+	    usage();
+	}
+    }
+    if (nfa_cache > 0 && (text_file == NULL || one_pass != NULL))
+	usage();		/* NFAs are only matched, one by one */
+    if (d2fa_depth > 0 && (text_file == NULL || one_pass != NULL
+			   || nfa_cache > 0))
+	usage();
+    if (words_flag && (prefilter_flag || one_pass != NULL || d2fa_depth > 0
+		       || nfa_cache > 0))
+	usage();		/* byte matchers only */
+    if (mealy_flag && engine->refine != NULL
+	&& engine->refine != hopcroft_refine)
+	usage();		/* only hopcroft splits by output labels */
+    if (lts_flag && (text_file != NULL || mealy_flag || words_flag
+		     || prefilter_flag))
+	usage();
+    if (cover_len > 0 && (mealy_flag || lts_flag || nfa_cache > 0))
+	usage();
+    if (reduce_states > 0 && (text_file == NULL || strcmp(text_file, "-") == 0
+			      || mealy_flag || words_flag || lts_flag
+			      || nfa_cache > 0))
+	usage();		/* the text is read more than once */
+    if ((cert_out != NULL || cert_in != NULL)
+	&& (argc - i != 1 || mealy_flag || words_flag || lts_flag
+	    || nfa_cache > 0))
+	usage();		/* a certificate is of a single DFA */
+    if ((table_out != NULL || patch_out != NULL || patch_in != NULL)
+	&& (argc - i != (patch_out != NULL ? 2 : 1) || mealy_flag
+	    || words_flag || lts_flag || nfa_cache > 0))
+	usage();		/* tables of a single DFA, patches of two */
+    if (patch_in != NULL && (table_out != NULL || patch_out != NULL
+			     || cert_out != NULL || cert_in != NULL))
+	usage();
+    if (pack_out != NULL && (mealy_flag || words_flag || lts_flag
+			     || nfa_cache > 0 || patch_in != NULL
+			     || cert_in != NULL))
+	usage();
+    if (pack_name != NULL && (argc - i < 1 || stats_flag || verify_flag
+			      || mealy_flag || words_flag || lts_flag
+			      || nfa_cache > 0 || cover_len > 0
+			      || reduce_states > 0 || reverse_flag
+			      || cert_out != NULL || cert_in != NULL
+			      || table_out != NULL || patch_out != NULL
+			      || patch_in != NULL || pack_out != NULL))
+	usage();		/* the DFAs are minimized already */
+    if (reverse_flag && (mealy_flag || words_flag || lts_flag
+			 || one_pass != NULL || d2fa_depth > 0 || nfa_cache > 0))
+	usage();
+
+    in_dfa = (automaton_t *) mem_alloc(MEM_AUTOMATON, sizeof(automaton_t));
+    out_dfa = (automaton_t *) mem_alloc(MEM_AUTOMATON, sizeof(automaton_t));
+    if (cover_len > 0)
+	cover = (automaton_t *) mem_alloc(MEM_AUTOMATON, sizeof(automaton_t));
+    if (reduce_states > 0)
+	reduced = (automaton_t *) mem_alloc(MEM_AUTOMATON, sizeof(automaton_t));
+    if (reverse_flag)
+	reversed = (automaton_t *) mem_alloc(MEM_AUTOMATON, sizeof(automaton_t));
+    if (table_out != NULL || patch_out != NULL || pack_out != NULL) {
+	table = (automaton_t *) mem_alloc(MEM_AUTOMATON, sizeof(automaton_t));
+	base = (automaton_t *) mem_alloc(MEM_AUTOMATON, sizeof(automaton_t));
+    }
+
+    if (pack_name != NULL) {   /* DFAs of a pack, by name */
+	pack_in = pack_open(pack_name);
+	for (; i < argc; i++)
+	    process_packed(argv[i]);
+	pack_free(pack_in);
+    } else if (i < argc) {     /* Handle arguments one by one */
+	batch_open(&argv[i], argc - i);
+	for (; i < argc; i++) {
 	    process_file(argv[i]);
 	}
+	batch_close();
     } else                     /* no arguments */
 	process_file(NULL);   /* process standard input */
+    if (one_pass != NULL && text_file != NULL)
+	scan_one_pass();
+    if (pack_out != NULL) {
+	printf("\nPack written: %d DFAs, %ld bytes\n", pack_out->n,
+	       pack_write(pack_out, pack_file));
+	pack_free(pack_out);
+    }
 
+    trace_close();
     return 0;
 }
 
+/*-------------------------------------------------------------------------
+|  static void usage ()
+|
+|  Print a usage message and exit.
+`------------------------------------------------------------------------*/
+
+static  void usage ()
+{
+    engine_t  *e;
+
+    fprintf(stderr, "Usage: minauto [-s] [-c] [-v] [-w] [-k] [-b] [-f length] [-i] [-z certfile | -y certfile] [-q tablefile | -u patchfile | -g patchfile] [-h packfile | -H packfile] [-p] [-e engine] [-j threads] [-l row|col|packed] [-m bytes] [-t tracefile] [-x textfile [-a] [-o] [-d depth] [-n states] [-r states]] [dfa_file ...]\n");
+    fprintf(stderr, "Engines:");
+    for (e = engines; e->name != NULL; e++)
+	fprintf(stderr, " %s", e->name);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+/*-------------------------------------------------------------------------
+|  static size_t parse_size (arg)
+|  char  *arg;
+|
+|  Convert a size argument such as "4096", "64k" or "2g" to bytes.
+`------------------------------------------------------------------------*/
+
+static  size_t parse_size (arg)
+char  *arg;
+{
+    char    *end;
+    size_t  size = (size_t) strtoul(arg, &end, 10);
+
+    switch (*end) {
+    case 'g': case 'G':  size <<= 10;	/* FALLTHROUGH */
+    case 'm': case 'M':  size <<= 10;	/* FALLTHROUGH */
+    case 'k': case 'K':  size <<= 10;  end++;
+    }
+    if (end == arg || *end != '\0')
+	usage();
+    return size;
+}
+
 /*-------------------------------------------------------------------------
 |  static void process_file (filename)
 |  char   *filename;
 |
 |  Process an argument file. a NULL argument means standard input is
-|  to be processed, otherwise - standard input is substituted by the
-|  argument file
+|  to be processed, otherwise - the argument file, which is the next
+|  file of the batch (see batch_open()).
 `------------------------------------------------------------------------*/
 
 static  void process_file (filename)
 char    *filename;
 {
-    if (filename != NULL)  /* if there's need to open a file */
-	if (freopen(filename, "r", stdin) != stdin) {
+    scan_t       sc;
+    prefilter_t  pf;
+    int          err;
+
+    trace_begin("process_file", "file", filename ? filename : "<stdin>");
+    if (filename != NULL) {    /* the next file of the batch */
+	if ((err = batch_next(&sc)) != 0) {
+	    errno = err;
 	    perror(filename);
+	    trace_end("process_file");
 	    return;
 	}
-    input_dfa(&in_dfa);
+    } else
+	scan_open(&sc, fileno(stdin));
+
+    if (nfa_cache > 0) {
+	process_nfa(filename ? filename : "<stdin>", &sc);
+	trace_end("process_file");
+	return;
+    }
+    if (lts_flag) {
+	process_lts(filename ? filename : "<stdin>", &sc);
+	trace_end("process_file");
+	return;
+    }
+
+    trace_begin("input", NULL, NULL);
+    input_dfa(in_dfa, &sc, (mealy_flag ? INPUT_MEALY : 0)
+			   | (words_flag ? INPUT_WORDS : 0));
+    scan_close(&sc);
+    trace_end("input");
+    if (cert_in != NULL) {
+	verify_cert(filename);
+	trace_end("process_file");
+	return;
+    }
+    if (patch_in != NULL) {
+	patch_file(filename);
+	trace_end("process_file");
+	return;
+    }
+
+    trace_begin("output", NULL, NULL);
     printf("\n------- Original  DFA -------\n\n");
-    output_dfa(&in_dfa);
+    output_dfa(in_dfa);
+    trace_end("output");
 
-    minimize_dfa(&in_dfa, &out_dfa, groups);
+    groups = (state_t *) mem_alloc(MEM_CLASSES,
+				   (in_dfa->nstates + 1) * sizeof(state_t));
+    minimize_dfa(in_dfa, out_dfa, groups);
+    if (cert_out != NULL)
+	cert_write(cert_out, in_dfa, out_dfa, groups);
+
+    if (verify_flag) {
+	trace_begin("verify", NULL, NULL);
+	if (! equiv_dfa(in_dfa, out_dfa))
+	    Abort(("Minimized DFA is NOT equivalent to the input DFA (engine %s)\n",
+		   used->name));
+	trace_end("verify");
+    }
+    if (canon_flag)
+	canon_dfa(out_dfa, NULL);
+
+    trace_begin("output", NULL, NULL);
     printf("\n\n------- Minimized DFA -------\n\n");
-    output_dfa(&out_dfa);
+    output_dfa(out_dfa);
+    if (prefilter_flag) {
+	find_prefilter(out_dfa, &pf);
+	print_prefilter(&pf);
+    }
+    fflush(stdout);
+    trace_end("output");
+    if (table_out != NULL || patch_out != NULL || pack_out != NULL)
+	write_table(filename ? filename : "<stdin>");
+
+    if (cover_len > 0) {
+	cover_dfa(out_dfa, cover, cover_len);
+	stats.cover_states = cover->nstates;
+	if (verify_flag) {
+	    trace_begin("verify", NULL, NULL);
+	    if (! cover_check(out_dfa, cover, cover_len))
+		Abort(("The cover automaton does NOT accept the words of at most %d symbols of the DFA\n",
+		       cover_len));
+	    trace_end("verify");
+	}
+	if (canon_flag)
+	    canon_dfa(cover, NULL);
+	trace_begin("output", NULL, NULL);
+	printf("\n\n------- Cover automaton (words of at most %d symbols) -------\n\n",
+	       cover_len);
+	output_dfa(cover);
+	fflush(stdout);
+	trace_end("output");
+    }
+    if (reduce_states > 0)
+	reduce_text(out_dfa);
+    if (reverse_flag)
+	reverse(out_dfa);
+
+    if (text_file != NULL && one_pass != NULL)
+	multi_add(one_pass, match_compile(out_dfa, anchored_flag),
+		  filename ? filename : "<stdin>");
+    else if (text_file != NULL)
+	scan_text(out_dfa);
+
+    if (stats_flag)
+	print_stats(filename ? filename : "<stdin>");
+    mem_free(groups);
+    mem_free(in_dfa->outs);
+    mem_free(out_dfa->outs);
+    in_dfa->outs = out_dfa->outs = NULL;
+    dict_free(ab_dict);
+    ab_dict = NULL;
+    trace_end("process_file");
+}
+
+/*-------------------------------------------------------------------------
+|  static void print_stats (name)
+|  char   *name;
+|
+|  Print the statistics gathered while processing the DFA 'name'
+|  to the standard error.
+`------------------------------------------------------------------------*/
+
+static  void print_stats (name)
+char    *name;
+{
+    fprintf(stderr, "minauto: %s\n", name);
+    fprintf(stderr, "  %-20s %d -> %d (%d live)\n", "states",
+	    stats.in_states, stats.out_states, stats.live_states);
+    if (engine->refine == NULL) {
+	fprintf(stderr, "  %-20s %s (auto)\n", "engine", used->name);
+	fprintf(stderr, "  %-20s %d states, %d symbols (%d classes), density %.2f, %s\n",
+		"features", features.nstates, features.nab, features.ab_classes,
+		features.density, features.acyclic ? "acyclic" : "cyclic");
+	if (! features.acyclic)
+	    fprintf(stderr, "  %-20s %d states\n", "largest SCC", features.max_scc);
+	fprintf(stderr, "  %-20s %.0f\n", "select usec", stats.select_usec);
+    } else
+	fprintf(stderr, "  %-20s %s\n", "engine", used->name);
+    fprintf(stderr, "  %-20s %s\n", "layout", layout_names[stats.layout]);
+    if (stats.layout == LAYOUT_PACKED)
+	fprintf(stderr, "  %-20s %lu bytes, %.1f%% of the matrix (%lu), %.0f usec to pack\n",
+		"packed", (unsigned long) stats.packed_bytes,
+		100.0 * stats.packed_bytes / stats.matrix_bytes,
+		(unsigned long) stats.matrix_bytes, stats.pack_usec);
+    fprintf(stderr, "  %-20s %d\n", "refinement rounds", stats.rounds);
+    fprintf(stderr, "  %-20s %.0f\n", "refine usec", stats.refine_usec);
+    fprintf(stderr, "  %-20s %.0f\n", "minimize usec", stats.usec);
+    if (cover_len > 0)
+	fprintf(stderr, "  %-20s %d states (words of at most %d symbols)\n",
+		"cover automaton", stats.cover_states, cover_len);
+    if (reverse_flag)
+	fprintf(stderr, "  %-20s %d states\n", "reversed DFA", stats.rev_states);
+    if (reduce_states > 0)
+	fprintf(stderr, "  %-20s %d states (budget %d, %d merges), %lu matches vs %lu\n",
+		"reduced DFA", stats.red_states, reduce_states, stats.merges,
+		(unsigned long) stats.red_matches,
+		(unsigned long) stats.exact_matches);
+    if (text_file != NULL && one_pass == NULL)
+	fprintf(stderr, "  %-20s %lu bytes, %lu matches, %.1f MB/s (%d states, %d accelerated, skipped %lu bytes)\n",
+		"scan", (unsigned long) stats.text_bytes,
+		(unsigned long) stats.matches,
+		stats.text_bytes / (stats.match_usec > 0 ? stats.match_usec : 1),
+		stats.mstates, stats.naccel, (unsigned long) stats.skipped);
+    if (text_file != NULL && d2fa_depth > 0) {
+	fprintf(stderr, "  %-20s %lu labeled transitions, %d states without a default, chains <= %d\n",
+		"D2FA", (unsigned long) stats.labeled, stats.roots, stats.depth);
+	fprintf(stderr, "  %-20s %lu bytes vs %lu (%.1fx smaller), %.2f defaults per byte\n",
+		"D2FA tables", (unsigned long) stats.d2fa_bytes,
+		(unsigned long) stats.table_bytes,
+		(double) stats.table_bytes / stats.d2fa_bytes,
+		(double) stats.hops / (stats.text_bytes > 0 ? stats.text_bytes : 1));
+    }
+    mem_report(stderr);
 }
 
 /*-------------------------------------------------------------------------
@@ -133,29 +900,80 @@ char    *filename;
 |
 |  Minimize the DFA 'old_dfa' into 'new_dfa'
 |  using the partition array 'groups[]'.
-|  Algorithm according to:
-|  Al Aho & Jeffrey D. Ullman - Principles of Compiler Design.
+|  The equivalence-classes are computed by the selected engine
+|  (by default according to:
+|   Al Aho & Jeffrey D. Ullman - Principles of Compiler Design).
 `------------------------------------------------------------------------*/
 
 static  void  minimize_dfa (old_dfa, new_dfa, groups)
 automaton_t  *old_dfa, *new_dfa;
 state_t      groups[];
 {
-    extern   void     init_partitions ();
-    extern   int      partition ();
+    state_t  i;
+    double   t0 = now_usec(), t1;
+
+    used = engine;
+    if (used->refine == NULL) {         /* "auto": choose by features */
+	trace_begin("select_engine", NULL, NULL);
+	dfa_features(old_dfa, &features);
+	for (used = engines; used->name != NULL; used++)
+	    if (strcmp(used->name, select_engine(&features)) == 0)
+		break;
+	stats.select_usec = now_usec() - t0;
+	trace_end("select_engine");
+    }
+    if (old_dfa->outs != NULL)		/* only it splits by output labels */
+	for (used = engines; used->refine != hopcroft_refine; used++)
+	    ;
 
-    init_partitions(old_dfa->nstates, old_dfa->state_attrib, groups);
+    trace_begin("minimize", "engine", used->name);
+    stats.in_states = old_dfa->nstates;
+    stats.matrix_bytes = (size_t) old_dfa->nstates * old_dfa->nab
+			 * sizeof(state_t);
 
     /*
      |  Partition equivalence-classes of states
      |  until no further partition can be done.
      */
-    while (partition(old_dfa, groups) == TRUE)
-	;
+    stats.layout = (layout >= 0) ? layout : used->layout;
+    if (! (used->layouts & LAYOUT_MASK(stats.layout))
+	|| (layout < 0 && stats.layout == LAYOUT_COL && ! columns_pay(old_dfa)))
+	stats.layout = LAYOUT_ROW;
+    if (stats.layout == LAYOUT_COL) {
+	trace_begin("make_columns", NULL, NULL);
+	make_columns(old_dfa);
+	trace_end("make_columns");
+    }
+    if (stats.layout == LAYOUT_PACKED) {
+	trace_begin("make_packed", NULL, NULL);
+	t1 = now_usec();
+	make_packed(old_dfa);
+	stats.pack_usec = now_usec() - t1;
+	stats.packed_bytes = packed_size(old_dfa->packed);
+	trace_end("make_packed");
+    }
+    t1 = now_usec();			/* the engine alone, not the
+					   selection nor the layout */
+    stats.rounds = (*used->refine)(old_dfa, groups);
+    stats.refine_usec = now_usec() - t1;
+    free_columns(old_dfa);
+    free_packed(old_dfa);
 
+    trace_begin("compress", NULL, NULL);
     compress_dfa(old_dfa, new_dfa, groups);
+    trace_end("compress");
 
+    trace_begin("find_dead_states", NULL, NULL);
     find_dead_states(new_dfa);
+    trace_end("find_dead_states");
+
+    stats.out_states = new_dfa->nstates;
+    stats.live_states = 0;
+    for (i = 1; i <= new_dfa->nstates; i++)
+	if (new_dfa->state_attrib[i] != 'D')
+	    stats.live_states++;
+    stats.usec = now_usec() - t0;
+    trace_end("minimize");
 }
 
 /*-------------------------------------------------------------------------
@@ -204,11 +1022,18 @@ state_t       groups[];
 	}
     }
 
+    if (old_dfa->outs != NULL)      /* Mealy machine: the output labels */
+	new_dfa->outs = (int *) mem_alloc(MEM_AUTOMATON, (size_t)
+				(rep_count + 1) * (old_dfa->nab + 1) * sizeof(int));
+    new_dfa->nab = old_dfa->nab;
+
     /* Fill transition matrix for compressed DFA */
     for (i = 1; i <= rep_count; i++) {
 
 	for (j = 1; j <= old_dfa->nab; j++) {
 	    new_dfa->mat[i][j] = map[ rep[ old_dfa->mat[pam[i]][j] ] ];
+	    if (new_dfa->outs != NULL)
+		OUT(new_dfa, i, j) = OUT(old_dfa, pam[i], j);
 	}
 
 	/* Set state attributes in new_dfa */
@@ -219,12 +1044,533 @@ state_t       groups[];
 	    new_dfa->accept[a_count++] = i;
 	}
     }
+    new_dfa->accept[a_count] = 0;     /* mark end of accept states */
 
     new_dfa->nstates = rep_count;                       /* Number of states */
     new_dfa->nab = old_dfa->nab;                         /* Alphabet size   */
     new_dfa->init_state = map[rep[old_dfa->init_state]]; /* Initial state   */
 }
 
+/*-------------------------------------------------------------------------
+|  static void  scan_text (dfa)
+|  automaton_t  *dfa;
+|
+|  Scan the text file of the -x option with the minimized DFA 'dfa',
+|  printing the offset of the end of every match.
+`------------------------------------------------------------------------*/
+
+static  void  scan_text (dfa)
+automaton_t  *dfa;
+{
+    matcher_t  *m;
+    d2fa_t     *d = NULL;
+    text_t     txt;
+    double     t0;
+
+    trace_begin("match", "file", text_file);
+    m = match_compile(dfa, anchored_flag);
+    if (d2fa_depth > 0)
+	d = d2fa_build(m, d2fa_depth);
+    printf("\n\n------- Matches in %s -------\n\n", text_file);
+    t0 = now_usec();
+    if (d != NULL)
+	stats.matches = d2fa_file(d, text_file, print_match, (void *) NULL);
+    else if (reverse_flag) {
+	/* two passes: the ends of the matches, and back from every one,
+	   its start - in the text, kept in memory */
+	txt.back = match_compile(reversed, TRUE);
+	txt.buf = NULL;
+	txt.len = txt.size = 0;
+	feed_file(text_file, add_text, (void *) &txt);
+	stats.matches = match_scan(m, txt.buf, txt.len, print_span,
+				   (void *) &txt);
+	mem_free(txt.buf);
+	match_free(txt.back);
+    } else
+	stats.matches = match_file(m, text_file, print_match, (void *) NULL);
+    stats.match_usec = now_usec() - t0;
+    printf("%lu matches\n", (unsigned long) stats.matches);
+    fflush(stdout);
+    stats.text_bytes = m->scanned;
+    stats.skipped = m->skipped;
+    stats.mstates = m->nstates;
+    stats.naccel = m->naccel;
+    if (d != NULL) {
+	stats.text_bytes = d->scanned;
+	stats.skipped = 0;
+	stats.table_bytes = (size_t) (m->nstates + 1) * m->width
+			    * sizeof(state_t);
+	stats.d2fa_bytes = d->bytes;
+	stats.labeled = d->nlabeled;
+	stats.roots = d->nroots;
+	stats.depth = d->depth;
+	stats.hops = d->hops;
+	d2fa_free(d);
+    }
+    match_free(m);
+    trace_end("match");
+}
+
+/*-------------------------------------------------------------------------
+|  static void  reduce_text (dfa)
+|  automaton_t  *dfa;
+|
+|  Reduce the minimized DFA 'dfa' to the states of the -r option, on
+|  the text file of the -x option, and print the reduced DFA, and the
+|  false positives it adds on that text.
+`------------------------------------------------------------------------*/
+
+static  void  reduce_text (dfa)
+automaton_t  *dfa;
+{
+    matcher_t  *m;
+    size_t     fp;
+
+    stats.merges = reduce_dfa(dfa, reduced, reduce_states, text_file,
+			      anchored_flag);
+    stats.red_states = reduced->nstates;
+    if (verify_flag) {
+	trace_begin("verify", NULL, NULL);
+	if (! reduce_check(dfa, reduced))
+	    Abort(("The reduced DFA does NOT accept every word of the DFA\n"));
+	trace_end("verify");
+    }
+    if (canon_flag)
+	canon_dfa(reduced, NULL);
+    trace_begin("output", NULL, NULL);
+    printf("\n\n------- Reduced DFA (at most %d states) -------\n\n",
+	   reduce_states);
+    output_dfa(reduced);
+    trace_end("output");
+
+    trace_begin("match", "file", text_file);
+    m = match_compile(dfa, anchored_flag);
+    stats.exact_matches = match_file(m, text_file, NULL, (void *) NULL);
+    match_free(m);
+    m = match_compile(reduced, anchored_flag);
+    stats.red_matches = match_file(m, text_file, NULL, (void *) NULL);
+    fp = stats.red_matches - stats.exact_matches;
+    printf("\n%lu false positives in %s: %lu matches vs %lu (%.2f%% of them, at %.3f%% of the %lu bytes)\n",
+	   (unsigned long) fp, text_file, (unsigned long) stats.red_matches,
+	   (unsigned long) stats.exact_matches,
+	   100.0 * fp / (stats.red_matches > 0 ? stats.red_matches : 1),
+	   100.0 * fp / (m->scanned > 0 ? m->scanned : 1),
+	   (unsigned long) m->scanned);
+    fflush(stdout);
+    match_free(m);
+    trace_end("match");
+}
+
+/*-------------------------------------------------------------------------
+|  static void  verify_cert (name)
+|  char  *name;
+|
+|  Check that the DFA of the certificate of the -y option is the
+|  minimal DFA of the input DFA 'name' (without minimizing it).
+`------------------------------------------------------------------------*/
+
+static  void  verify_cert (name)
+char  *name;
+{
+    state_t  *map;
+    char     *why;
+
+    trace_begin("verify", NULL, NULL);
+    map = cert_read(cert_in, in_dfa, out_dfa);
+    if ((why = cert_check(in_dfa, out_dfa, map)) != NULL)
+	Abort(("The certificate %s of %s is WRONG: %s\n", cert_in, name, why));
+    printf("The certificate %s of %s is right: %d states, minimized to %d\n",
+	   cert_in, name, in_dfa->nstates,
+	   out_dfa->accept[0] != 0 ? out_dfa->nstates : 0);
+    mem_free(map);
+    trace_end("verify");
+}
+
+/*-------------------------------------------------------------------------
+|  static void  write_table (name)
+|  char  *name;
+|
+|  Write the minimized DFA of 'name', canonically numbered, to the table
+|  file of the -q option, add it to the pack of the -h option, and, for
+|  the -u option, keep it if it is the old version, or write the patch
+|  to it if it is the new one.
+`------------------------------------------------------------------------*/
+
+static  void  write_table (name)
+char  *name;
+{
+    automaton_t  *t;
+    long         bytes;
+    int          nrows;
+
+    memcpy(table, out_dfa, sizeof(automaton_t));
+    canon_dfa(table, NULL);
+    if (pack_out != NULL)
+	pack_add(pack_out, name, table);
+    if (table_out != NULL) {
+	write_dfa(table_out, table);
+	fflush(table_out);
+    }
+    if (patch_out == NULL)
+	return;
+    if (base_name == NULL) {		/* the old version */
+	t = base, base = table, table = t;
+	base_name = name;
+	memcpy(base_ab, ab_map, sizeof(base_ab));
+	return;
+    }
+    if (table->nab != base->nab
+	|| memcmp(base_ab, ab_map, table->nab + 1) != 0)
+	Abort(("The DFAs %s and %s have different alphabets\n",
+	       base_name, name));
+
+    bytes = diff_write(patch_out, base, table, &nrows);
+    printf("\n\n------- Patch from %s -------\n\n", base_name);
+    printf("%d of the %d rows, %ld bytes\n", nrows,
+	   (table->state_attrib[table->init_state] == 'D') ? 1 : table->nstates,
+	   bytes);
+    fflush(stdout);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  patch_file (name)
+|  char  *name;
+|
+|  Apply the patch of the -g option to the table file 'name', just
+|  read, and replace it by the DFA patched.
+`------------------------------------------------------------------------*/
+
+static  void  patch_file (name)
+char  *name;
+{
+    int  nrows;
+
+    trace_begin("patch_file", NULL, NULL);
+    if (name == NULL)
+	usage();			/* the file is replaced */
+    nrows = diff_apply(patch_in, in_dfa);
+    diff_switch(name, in_dfa);
+    printf("The patch %s of %s is applied: %d rows, %d states\n",
+	   patch_in, name, nrows, in_dfa->nstates);
+    trace_end("patch_file");
+}
+
+/*-------------------------------------------------------------------------
+|  static void  process_packed (name)
+|  char  *name;
+|
+|  Process the (minimized) DFA 'name' of the pack of the -H option: as
+|  the minimized DFA of a file is.
+`------------------------------------------------------------------------*/
+
+static  void  process_packed (name)
+char  *name;
+{
+    pack_dfa_t   view;
+    prefilter_t  pf;
+
+    trace_begin("process_packed", "dfa", name);
+    if (! pack_find(pack_in, name, &view)) {
+	fprintf(stderr, "%s: not in the pack %s\n", name, pack_name);
+	trace_end("process_packed");
+	return;
+    }
+    pack_load(&view, out_dfa);
+
+    trace_begin("output", NULL, NULL);
+    printf("\n\n------- Minimized DFA %s -------\n\n", name);
+    output_dfa(out_dfa);
+    if (prefilter_flag) {
+	find_prefilter(out_dfa, &pf);
+	print_prefilter(&pf);
+    }
+    fflush(stdout);
+    trace_end("output");
+
+    if (text_file != NULL && one_pass != NULL)
+	multi_add(one_pass, match_compile(out_dfa, anchored_flag), name);
+    else if (text_file != NULL)
+	scan_text(out_dfa);
+    trace_end("process_packed");
+}
+
+/*-------------------------------------------------------------------------
+|  static void  reverse (dfa)
+|  automaton_t  *dfa;
+|
+|  Make & print the minimal DFA of the reversed language of the
+|  minimized DFA 'dfa' (the -i option).
+`------------------------------------------------------------------------*/
+
+static  void  reverse (dfa)
+automaton_t  *dfa;
+{
+    automaton_t  *twice;
+
+    reverse_dfa(dfa, reversed);
+    stats.rev_states = reversed->nstates;
+    if (verify_flag) {
+	/* reversed again, it is the minimized DFA (Brzozowski) */
+	trace_begin("verify", NULL, NULL);
+	twice = (automaton_t *) mem_alloc(MEM_AUTOMATON, sizeof(automaton_t));
+	reverse_dfa(reversed, twice);
+	if (! equiv_dfa(dfa, twice))
+	    Abort(("The reversed DFA does NOT accept the words of the DFA reversed\n"));
+	mem_free(twice);
+	trace_end("verify");
+    }
+    if (canon_flag)
+	canon_dfa(reversed, NULL);
+    trace_begin("output", NULL, NULL);
+    printf("\n\n------- Reversed DFA -------\n\n");
+    output_dfa(reversed);
+    fflush(stdout);
+    trace_end("output");
+}
+
+/*-------------------------------------------------------------------------
+|  static void  process_nfa (name, sc)
+|  char    *name;
+|  scan_t  *sc;
+|
+|  Process the NFA 'name' scanned by 'sc' (the -n option): match the
+|  text file of the -x option with it through a lazily built DFA,
+|  printing the offset of the end of every match.
+`------------------------------------------------------------------------*/
+
+static  void  process_nfa (name, sc)
+char    *name;
+scan_t  *sc;
+{
+    nfa_t   nfa;
+    lazy_t  *lz;
+    size_t  count;
+    double  t0;
+
+    trace_begin("input", NULL, NULL);
+    input_nfa(&nfa, sc);
+    scan_close(sc);
+    trace_end("input");
+
+    trace_begin("output", NULL, NULL);
+    printf("\n------- Original  NFA -------\n\n");
+    output_nfa(&nfa);
+    trace_end("output");
+
+    trace_begin("match", "file", text_file);
+    lz = lazy_new(&nfa, nfa_cache, anchored_flag);
+    printf("\n\n------- Matches in %s (lazy DFA) -------\n\n", text_file);
+    t0 = now_usec();
+    count = lazy_file(lz, text_file, print_match, (void *) NULL);
+    t0 = now_usec() - t0;
+    printf("%lu matches\n", (unsigned long) count);
+    fflush(stdout);
+    trace_end("match");
+
+    if (stats_flag) {
+	fprintf(stderr, "minauto: %s\n", name);
+	fprintf(stderr, "  %-20s %d states, %d symbols, %d edges\n", "NFA",
+		nfa.nstates, nfa.nab, nfa.nedges);
+	fprintf(stderr, "  %-20s %lu bytes, %lu matches, %.1f MB/s (skipped %lu bytes)\n",
+		"lazy scan", (unsigned long) lz->scanned, (unsigned long) count,
+		lz->scanned / (t0 > 0 ? t0 : 1), (unsigned long) lz->skipped);
+	fprintf(stderr, "  %-20s %lu states made, %d flushes of %d states\n",
+		"lazy DFA", (unsigned long) lz->made, lz->flushes, lz->max);
+	mem_report(stderr);
+    }
+    lazy_free(lz);
+    free_nfa(&nfa);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  process_lts (name, sc)
+|  char    *name;
+|  scan_t  *sc;
+|
+|  Process the LTS 'name' scanned by 'sc' (the -b option): print its
+|  quotient by strong bisimulation.
+`------------------------------------------------------------------------*/
+
+static  void  process_lts (name, sc)
+char    *name;
+scan_t  *sc;
+{
+    nfa_t   lts, q;
+    int     *block, steps;
+    double  t0;
+
+    trace_begin("input", NULL, NULL);
+    input_nfa(&lts, sc);
+    scan_close(sc);
+    trace_end("input");
+
+    trace_begin("output", NULL, NULL);
+    printf("\n------- Original  LTS -------\n\n");
+    output_nfa(&lts);
+    trace_end("output");
+
+    block = (int *) mem_alloc(MEM_CLASSES, (lts.nstates + 1) * sizeof(int));
+    t0 = now_usec();
+    steps = bisim_refine(&lts, block);
+    bisim_quotient(&lts, block, &q);
+    t0 = now_usec() - t0;
+    if (verify_flag) {
+	trace_begin("verify", NULL, NULL);
+	if (! bisim_check(&lts, block))
+	    Abort(("The classes found are NOT a bisimulation\n"));
+	trace_end("verify");
+    }
+
+    trace_begin("output", NULL, NULL);
+    printf("\n\n------- Minimized LTS -------\n\n");
+    output_nfa(&q);
+    fflush(stdout);
+    trace_end("output");
+
+    if (stats_flag) {
+	fprintf(stderr, "minauto: %s\n", name);
+	fprintf(stderr, "  %-20s %d -> %d, %d -> %d edges\n", "states",
+		lts.nstates, q.nstates, lts.nedges, q.nedges);
+	fprintf(stderr, "  %-20s %d\n", "compound splits", steps);
+	fprintf(stderr, "  %-20s %.0f\n", "minimize usec", t0);
+	mem_report(stderr);
+    }
+    free_nfa(&q);
+    free_nfa(&lts);
+    mem_free(block);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  scan_one_pass ()
+|
+|  Scan the text file of the -x option in one pass with all the DFAs
+|  (the -o option), printing the offset & name of every match.
+`------------------------------------------------------------------------*/
+
+static  void  scan_one_pass ()
+{
+    size_t  count;
+    double  t0 = now_usec(), t1;
+
+    trace_begin("match", "file", text_file);
+    multi_build(one_pass);
+    printf("\n\n------- Matches in %s (%d DFAs, one pass) -------\n\n",
+	   text_file, one_pass->n);
+    t1 = now_usec();
+    count = multi_file(one_pass, text_file, print_multi_match, (void *) NULL);
+    t1 = now_usec() - t1;
+    printf("%lu matches\n", (unsigned long) count);
+    fflush(stdout);
+    if (stats_flag) {
+	fprintf(stderr, "minauto: one pass over %s\n", text_file);
+	fprintf(stderr, "  %-20s %d DFAs, %d byte classes, %.0f usec to build\n",
+		"matchers", one_pass->n, one_pass->ncls, now_usec() - t0 - t1);
+	fprintf(stderr, "  %-20s %lu bytes, %lu matches, %.1f MB/s (%d retired, skipped %lu bytes)\n",
+		"scan", (unsigned long) one_pass->scanned, (unsigned long) count,
+		one_pass->scanned / (t1 > 0 ? t1 : 1), one_pass->retired,
+		(unsigned long) one_pass->skipped);
+	mem_report(stderr);
+    }
+    multi_free(one_pass);
+    one_pass = NULL;
+    trace_end("match");
+}
+
+/*-------------------------------------------------------------------------
+|  static void  print_multi_match (arg, i, offset)
+|  void    *arg;
+|  int     i;
+|  size_t  offset;
+|
+|  Print the (end) 'offset' of a match of the i-th DFA of the -o option.
+`------------------------------------------------------------------------*/
+
+static  void  print_multi_match (arg, i, offset)
+void    *arg;
+int     i;
+size_t  offset;
+{
+    (void) arg;				/* nothing to carry */
+    printf("%lu %s\n", (unsigned long) offset, one_pass->names[i]);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  print_match (arg, offset)
+|  void    *arg;
+|  size_t  offset;
+|
+|  Print the (end) 'offset' of a match.
+`------------------------------------------------------------------------*/
+
+static  void  print_match (arg, offset)
+void    *arg;
+size_t  offset;
+{
+    (void) arg;				/* nothing to carry */
+    printf("%lu\n", (unsigned long) offset);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  print_span (txt, offset)
+|  text_t  *txt;
+|  size_t  offset;
+|
+|  Print the start (found backwards in the text 'txt') and the end
+|  'offset' of a match.
+`------------------------------------------------------------------------*/
+
+static  void  print_span (txt, offset)
+text_t  *txt;
+size_t  offset;
+{
+    printf("%lu %lu\n", (unsigned long) match_back(txt->back, txt->buf, offset),
+	   (unsigned long) offset);
+}
+
+/*-------------------------------------------------------------------------
+|  static size_t  add_text (txt, buf, len)
+|  text_t         *txt;
+|  unsigned char  *buf;
+|  size_t         len;
+|
+|  feed_file() scanner: append the 'len' bytes at 'buf' to the text
+|  'txt'.
+`------------------------------------------------------------------------*/
+
+static  size_t  add_text (txt, buf, len)
+text_t         *txt;
+unsigned char  *buf;
+size_t         len;
+{
+    unsigned char  *nbuf;
+
+    if (txt->len + len > txt->size) {
+	txt->size = 2 * txt->size + len;
+	nbuf = (unsigned char *) mem_alloc(MEM_IO, txt->size);
+	if (txt->len > 0)
+	    memcpy(nbuf, txt->buf, txt->len);
+	mem_free(txt->buf);
+	txt->buf = nbuf;
+    }
+    memcpy(txt->buf + txt->len, buf, len);
+    txt->len += len;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------
+|  static double  now_usec ()
+|
+|  Return a monotonic time stamp in microseconds.
+`------------------------------------------------------------------------*/
+
+static  double  now_usec ()
+{
+    struct timespec  ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
 #if DEBUG > 0
 /*-------------------------------------------------------------------------
 |  void  dump_state (dfa, groups)
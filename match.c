@@ -0,0 +1,673 @@
+/*-------------------------------------------------------------------------*\
+|  Module "match.c"
+|
+|  Matching byte strings with a minimized DFA.
+|
+|  A match is any nonempty substring of the input that the DFA accepts
+|  (symbol j of the alphabet being the byte ab_map[j], see module
+|  "inout.c"), and is reported at its end. So the matcher must follow
+|  every partial match at once: a matcher state is the set of the DFA
+|  states of the partial matches under way, and on every byte a new one
+|  starts from the initial state. These sets are found by a subset
+|  construction from the empty set, and the matcher is compiled into a
+|  byte table, 'next[S * 256 + byte]'. For the DFAs
+|  of sets of words there are hardly more sets than DFA states (as in
+|  Aho-Corasick); a matcher needing more than MATCH_MAX_STATES aborts.
+|
+|  Acceleration: scanning text that rarely matches, the DFA spends most
+|  of its time in states that loop on almost every byte (the empty set
+|  for one, which only leaves on the first bytes of the words looked
+|  for). A non-accepting state that leaves on at most ACCEL_MAX bytes is
+|  marked MATCH_ACCEL, with these exit bytes; while in it the matcher
+|  searches for the next exit byte instead of taking one transition per
+|  byte: memchr() for a single exit byte, otherwise SSE2 compares of 16
+|  bytes at a time against every exit byte. On text where the exit
+|  bytes are rare, this scanned ~14 times faster than one transition per
+|  byte (compile with -DACCEL_MAX=0 to compare).
+|
+|  Prefilter: if every match contains some literal (see module
+|  "prefilter.c"), the matcher, whenever no match is under way, looks
+|  for the next occurrence of the literal with memmem() and resumes
+|  only a little before it.
+|
+|  Anchored matching (matches must start at the start of the input) is
+|  the same without the new partial match on every byte: the matcher is
+|  the DFA itself, with the empty set as its dead state.
+|
+|  Streams: a matcher state sums up all that matters of the input seen
+|  so far, so a stream is scanned as it comes, buffer by buffer, through
+|  a context carrying the state across match_feed() calls; nothing is
+|  copied or kept of the buffers. A literal not in a buffer may still
+|  start in its last bytes, so the scan only skips to a little before
+|  them.
+|
+|  Words: over an alphabet of words (the -k option, see module
+|  "dict.c"), the input is a stream of white-space separated words,
+|  each looked up in the perfect hash of the dictionary once, and the
+|  rows of the matcher have a transition per symbol instead of per
+|  byte (0: words not in the alphabet). A match is reported at the end
+|  of its last word. A word cut by the end of a buffer is carried over
+|  to the next one in the context (a word longer than any symbol only
+|  as far as to tell that it's none); match_end() ends the last one.
+|
+|  Match starts: a match is found at its end, in one pass. Where it
+|  starts, a second pass tells, backwards from the end, with the
+|  matcher of the DFA of the reversed language (module "reverse.c"),
+|  anchored: every accept state it goes through is the start of a match
+|  ending there, the last one of the longest (match_back()).
+\*-------------------------------------------------------------------------*/
+
+#define _GNU_SOURCE		/* memmem() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#ifdef __SSE2__
+#   include <emmintrin.h>
+#endif
+
+#include "auto.h"
+
+#define NEXT(M, S, C)	((M)->next[(size_t) (S) * (M)->width + (C)])
+
+#define IS_WHITE(C)	((C) == ' ' || (C) == '\t' || (C) == '\n' || \
+			 (C) == '\r' || (C) == '\f' || (C) == '\v')
+
+extern char    ab_map[];
+extern dict_t  *ab_dict;
+
+#ifndef MATCH_MAX_STATES
+#   define MATCH_MAX_STATES	(1 << 16)	/* states of a matcher */
+#endif
+
+#define MATCH_HASH	(2 * MATCH_MAX_STATES)
+
+#ifndef MATCH_CHUNK
+#   define MATCH_CHUNK	(1 << 16)	/* bytes read at a time */
+#endif
+
+/*
+ |  The subset construction: the sets of DFA states of the matcher
+ |  states, one after the other in 'pool[]', and a hash table of them.
+ */
+static state_t  *pool;
+static size_t   pool_len, pool_size;
+static size_t   *set_at;	/* set_at[S]: set of matcher state 'S' ... */
+static int      *set_len;	/* ... is pool[set_at[S] .. + set_len[S]-1] */
+static int      *htab;		/* (0: empty)                               */
+static int      nsets;
+
+void                  find_prefilter ();
+int                   dict_lookup ();
+size_t                match_end ();
+
+static int            add_set ();
+static size_t         feed_words ();
+static void           step_word ();
+static int            cmp_states ();
+static unsigned char  *skip_to_exit ();
+void                  feed_file ();
+
+/*-------------------------------------------------------------------------
+|  matcher_t  *match_compile (dfa, anchored)
+|  automaton_t  *dfa;
+|  int          anchored;
+|
+|  Compile the (minimized, dead states marked) DFA 'dfa' into a matcher;
+|  if 'anchored', of the matches starting at the start of the input only.
+|  If 'ab_dict' is set, the matcher is one of words.
+`------------------------------------------------------------------------*/
+
+matcher_t  *match_compile (dfa, anchored)
+automaton_t  *dfa;
+int          anchored;
+{
+    matcher_t      *m;
+    state_t        *set, *nnext, t;
+    int            sym[256];	/* sym[byte]: its symbol, 0 if none */
+    int            *mark, stamp = 0;
+    int            empty = 0;	/* the empty set, once made */
+    int            S, cap, i, j, c, len, nexit;
+    unsigned char  *x;
+
+    m = (matcher_t *) mem_alloc(MEM_MATCHER, sizeof(matcher_t));
+    m->width = 256;
+    for (c = 0; c < 256; c++)
+	sym[c] = 0;
+    if ((m->dict = ab_dict) != NULL)	/* a row entry per symbol */
+	m->width = dfa->nab + 1;
+    else
+	for (j = 1; j <= dfa->nab; j++)
+	    sym[(unsigned char) ab_map[j]] = j;
+
+    pool_size = 1024;
+    pool = (state_t *) mem_alloc(MEM_MATCHER, pool_size * sizeof(state_t));
+    pool_len = 0;
+    set_at = (size_t *) mem_alloc(MEM_MATCHER,
+				  (MATCH_MAX_STATES + 1) * sizeof(size_t));
+    set_len = (int *) mem_alloc(MEM_MATCHER,
+				(MATCH_MAX_STATES + 1) * sizeof(int));
+    htab = (int *) mem_alloc(MEM_MATCHER, MATCH_HASH * sizeof(int));
+    nsets = 0;
+    mark = (int *) mem_alloc(MEM_MATCHER, (dfa->nstates + 1) * sizeof(int));
+    set = (state_t *) mem_alloc(MEM_MATCHER,
+				(dfa->nstates + 1) * sizeof(state_t));
+
+    /* subset construction: from the empty set ({initial state} if
+       'anchored', where the empty set is a dead end) */
+    set[0] = dfa->init_state;
+    m->init = add_set(set, anchored ? 1 : 0);
+    cap = 256;
+    m->next = (state_t *) mem_alloc(MEM_MATCHER,
+				    (cap + 1) * m->width * sizeof(state_t));
+    for (S = 1; S <= nsets; S++) {
+	if (S > cap) {
+	    nnext = (state_t *) mem_alloc(MEM_MATCHER, (2 * cap + 1)
+					  * m->width * sizeof(state_t));
+	    memcpy(nnext, m->next, (cap + 1) * m->width * sizeof(state_t));
+	    mem_free(m->next);
+	    m->next = nnext;
+	    cap *= 2;
+	}
+	for (c = 0; c < m->width; c++) {
+	    if ((j = (m->dict != NULL) ? c : sym[c]) == 0) {	/* not in the alphabet */
+		if (empty == 0)
+		    empty = add_set(set, 0);
+		NEXT(m, S, c) = empty;
+		continue;
+	    }
+	    stamp++;
+	    len = 0;
+	    for (i = anchored ? 0 : -1; i < set_len[S]; i++) {
+		/* -1: a match may start here */
+		t = dfa->mat[(i < 0) ? dfa->init_state : pool[set_at[S] + i]][j];
+		if (t > 0 && dfa->state_attrib[t] != 'D' && mark[t] != stamp) {
+		    mark[t] = stamp;
+		    set[len++] = t;
+		}
+	    }
+	    qsort((char *) set, len, sizeof(state_t), cmp_states);
+	    NEXT(m, S, c) = add_set(set, len);
+	}
+    }
+    m->nstates = nsets;
+    if (m->dict == NULL)
+	find_prefilter(dfa, &m->pf);
+    if (anchored)
+	m->pf.nlit = 0;		/* only one match start */
+
+    m->kind = (unsigned char *) mem_alloc(MEM_MATCHER, nsets + 1);
+    m->exits = (unsigned char *) mem_alloc(MEM_MATCHER,
+					   (nsets + 1) * ACCEL_MAX + 1);
+    for (S = 1; S <= nsets; S++) {
+	for (i = 0; i < set_len[S]; i++)
+	    if (dfa->state_attrib[pool[set_at[S] + i]] == 'A')
+		m->kind[S] = MATCH_ACCEPT;
+	if ((m->kind[S] & MATCH_ACCEPT) || m->dict != NULL)
+	    continue;
+
+	/* few exit bytes: accelerate */
+	x = &m->exits[S * ACCEL_MAX];
+	for (c = 0, nexit = 0; c < 256 && nexit <= ACCEL_MAX; c++)
+	    if (NEXT(m, S, c) != S) {
+		if (nexit < ACCEL_MAX)
+		    x[nexit] = (unsigned char) c;
+		nexit++;
+	    }
+	if (nexit <= ACCEL_MAX && ACCEL_MAX > 0) {
+	    m->kind[S] = MATCH_ACCEL;
+	    m->naccel++;
+	    if (nexit == 0)
+		m->kind[S] |= MATCH_LOOP;
+	    for (j = nexit; j < ACCEL_MAX && nexit > 0; j++)
+		x[j] = x[0];		/* pad with a repeat */
+	}
+    }
+
+    mem_free(set);
+    mem_free(mark);
+    mem_free(htab);
+    mem_free(set_len);
+    mem_free(set_at);
+    mem_free(pool);
+    return m;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  add_set (set, len)
+|  state_t  set[];
+|  int      len;
+|
+|  Return the matcher state of the sorted set of DFA states 'set[0 ..
+|  len-1]', making it a new one if the set wasn't seen before.
+`------------------------------------------------------------------------*/
+
+static int  add_set (set, len)
+state_t  set[];
+int      len;
+{
+    unsigned  h = 2166136261u;
+    state_t   *npool;
+    int       i, S;
+
+    for (i = 0; i < len; i++)
+	h = (h ^ (unsigned) set[i]) * 16777619u;
+    for (h %= MATCH_HASH; (S = htab[h]) != 0; h = (h + 1) % MATCH_HASH)
+	if (set_len[S] == len
+	    && memcmp(&pool[set_at[S]], set, len * sizeof(state_t)) == 0)
+	    return S;
+
+    if (nsets == MATCH_MAX_STATES)
+	Abort(("The matcher of this DFA needs more than %d states, recompile with \"-DMATCH_MAX_STATES=...\"\n",
+	       MATCH_MAX_STATES));
+    if (pool_len + len > pool_size) {
+	npool = (state_t *) mem_alloc(MEM_MATCHER,
+				      2 * (pool_size + len) * sizeof(state_t));
+	memcpy(npool, pool, pool_len * sizeof(state_t));
+	mem_free(pool);
+	pool = npool;
+	pool_size = 2 * (pool_size + len);
+    }
+    S = ++nsets;
+    htab[h] = S;
+    set_at[S] = pool_len;
+    set_len[S] = len;
+    memcpy(&pool[pool_len], set, len * sizeof(state_t));
+    pool_len += len;
+    return S;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  cmp_states (a, b)
+|  state_t  *a, *b;
+|
+|  qsort() comparison of two states.
+`------------------------------------------------------------------------*/
+
+static int  cmp_states (a, b)
+state_t  *a, *b;
+{
+    return *a - *b;
+}
+
+/*-------------------------------------------------------------------------
+|  void  match_free (m)
+|  matcher_t  *m;
+|
+|  Release the matcher 'm'.
+`------------------------------------------------------------------------*/
+
+void  match_free (m)
+matcher_t  *m;
+{
+    mem_free(m->next);
+    mem_free(m->kind);
+    mem_free(m->exits);
+    mem_free(m);
+}
+
+/*-------------------------------------------------------------------------
+|  void  match_start (ctx, m, report, arg)
+|  match_ctx_t  *ctx;
+|  matcher_t    *m;
+|  void         (*report) ();
+|  void         *arg;
+|
+|  Start 'ctx' on a new stream scanned with the matcher 'm', calling
+|  (*report)(arg, offset) at every match ('offset' being that of the
+|  byte after the match, counted from the start of the stream).
+`------------------------------------------------------------------------*/
+
+void  match_start (ctx, m, report, arg)
+match_ctx_t  *ctx;
+matcher_t    *m;
+void         (*report) ();
+void         *arg;
+{
+    ctx->m = m;
+    ctx->s = m->init;
+    ctx->part_len = 0;
+    ctx->offset = 0;
+    ctx->count = 0;
+    ctx->report = report;
+    ctx->arg = arg;
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  match_feed (ctx, buf, len)
+|  match_ctx_t    *ctx;
+|  unsigned char  *buf;
+|  size_t         len;
+|
+|  Scan the next 'len' bytes of the stream of 'ctx', at 'buf' (which is
+|  not used after the call). Return the number of matches ending in them.
+`------------------------------------------------------------------------*/
+
+size_t  match_feed (ctx, buf, len)
+match_ctx_t    *ctx;
+unsigned char  *buf;
+size_t         len;
+{
+    matcher_t      *m = ctx->m;
+    unsigned char  *p = buf, *end = buf + len, *q;
+    unsigned char  *lit = NULL;	/* next occurrence of the literal */
+    int            tail = FALSE;	/* ... is not in this buffer      */
+    long           skip;
+    state_t        s = ctx->s;
+    size_t         count = 0;
+
+    if (m->dict != NULL)
+	return feed_words(ctx, buf, len);
+    m->scanned += len;
+    while (p < end) {
+	if (s == m->init && m->pf.nlit > 0 && ! tail) {	/* no match under way */
+	    if (lit == NULL || lit < p)
+		lit = (unsigned char *) memmem(p, end - p, m->pf.lit,
+					       m->pf.nlit);
+	    if (lit == NULL) {
+		/* it may still start in the last nlit - 1 bytes */
+		tail = TRUE;
+		skip = (long) (end - p) - (m->pf.nlit - 1) - m->pf.before;
+	    } else
+		skip = (long) (lit - p) - m->pf.before;
+	    if (skip > 0) {
+		m->skipped += skip;
+		p += skip;
+		continue;
+	    }
+	}
+	if (m->kind[s] & MATCH_ACCEL) {
+	    q = skip_to_exit(m, s, p, end);
+	    m->skipped += q - p;
+	    if ((p = q) == end)
+		break;
+	}
+	s = NEXT(m, s, *p++);
+	if (m->kind[s] & MATCH_ACCEPT) {
+	    count++;
+	    if (ctx->report != NULL)
+		(*ctx->report)(ctx->arg, ctx->offset + (size_t) (p - buf));
+	}
+    }
+    ctx->s = s;
+    ctx->offset += len;
+    ctx->count += count;
+    return count;
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  match_scan (m, buf, len, report, arg)
+|  matcher_t      *m;
+|  unsigned char  *buf;
+|  size_t         len;
+|  void           (*report) ();
+|  void           *arg;
+|
+|  Scan the 'len' bytes at 'buf' with the matcher 'm' as a stream of its
+|  own (see match_start()). Return the number of matches.
+`------------------------------------------------------------------------*/
+
+size_t  match_scan (m, buf, len, report, arg)
+matcher_t      *m;
+unsigned char  *buf;
+size_t         len;
+void           (*report) ();
+void           *arg;
+{
+    match_ctx_t  ctx;
+
+    match_start(&ctx, m, report, arg);
+    match_feed(&ctx, buf, len);
+    return match_end(&ctx);
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  match_back (m, buf, end)
+|  matcher_t      *m;
+|  unsigned char  *buf;
+|  size_t         end;
+|
+|  Return the start of the longest match ending at 'end' in the bytes
+|  at 'buf', by scanning them backwards from 'end' with the anchored
+|  matcher 'm' of the reversed language; 'end' if there is none.
+`------------------------------------------------------------------------*/
+
+size_t  match_back (m, buf, end)
+matcher_t      *m;
+unsigned char  *buf;
+size_t         end;
+{
+    size_t   p = end, start = end;
+    state_t  s = m->init;
+
+    while (p > 0) {
+	s = NEXT(m, s, buf[--p]);
+	if (m->kind[s] & MATCH_ACCEPT)
+	    start = p;
+	else if (m->kind[s] & MATCH_LOOP)
+	    break;			/* (the dead end, for one) */
+    }
+    return start;
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  match_end (ctx)
+|  match_ctx_t  *ctx;
+|
+|  End the stream of 'ctx': a matcher of words takes the last word, if
+|  the stream didn't end with white space. Return the number of matches
+|  of the whole stream.
+`------------------------------------------------------------------------*/
+
+size_t  match_end (ctx)
+match_ctx_t  *ctx;
+{
+    if (ctx->part_len > 0) {
+	step_word(ctx, ctx->part, ctx->part_len, ctx->offset);
+	ctx->part_len = 0;
+    }
+    return ctx->count;
+}
+
+/*-------------------------------------------------------------------------
+|  static size_t  feed_words (ctx, buf, len)
+|  match_ctx_t    *ctx;
+|  unsigned char  *buf;
+|  size_t         len;
+|
+|  match_feed() of a matcher of words: scan the words of the next 'len'
+|  bytes of the stream of 'ctx', at 'buf'.
+`------------------------------------------------------------------------*/
+
+static size_t  feed_words (ctx, buf, len)
+match_ctx_t    *ctx;
+unsigned char  *buf;
+size_t         len;
+{
+    unsigned char  *p = buf, *end = buf + len, *w;
+    size_t         count = ctx->count;
+    int            n;
+
+    ctx->m->scanned += len;
+    if (ctx->part_len > 0) {		/* the rest of a word cut before */
+	for (; p < end && ! IS_WHITE(*p); p++)
+	    if (ctx->part_len <= DICT_WORD_MAX)
+		ctx->part[ctx->part_len++] = (char) *p;
+	if (p == end) {
+	    ctx->offset += len;
+	    return 0;
+	}
+	step_word(ctx, ctx->part, ctx->part_len, ctx->offset + (p - buf));
+	ctx->part_len = 0;
+    }
+    for (;;) {
+	while (p < end && IS_WHITE(*p))
+	    p++;
+	for (w = p; p < end && ! IS_WHITE(*p); p++)
+	    ;
+	if (p == end)
+	    break;
+	step_word(ctx, (char *) w, (int) (p - w), ctx->offset + (p - buf));
+    }
+    /* keep a word cut by the end (enough of it to know it's none) */
+    n = (p - w > DICT_WORD_MAX) ? DICT_WORD_MAX + 1 : (int) (p - w);
+    memcpy(ctx->part, w, n);
+    ctx->part_len = n;
+    ctx->offset += len;
+    return ctx->count - count;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  step_word (ctx, w, len, at)
+|  match_ctx_t  *ctx;
+|  char         *w;
+|  int          len;
+|  size_t       at;
+|
+|  Move the matcher of words of 'ctx' on the word 'w' of 'len'
+|  characters, which ends at the stream offset 'at'.
+`------------------------------------------------------------------------*/
+
+static void  step_word (ctx, w, len, at)
+match_ctx_t  *ctx;
+char         *w;
+int          len;
+size_t       at;
+{
+    matcher_t  *m = ctx->m;
+
+    ctx->s = NEXT(m, ctx->s, dict_lookup(m->dict, w, len));
+    if (m->kind[ctx->s] & MATCH_ACCEPT) {
+	ctx->count++;
+	if (ctx->report != NULL)
+	    (*ctx->report)(ctx->arg, at);
+    }
+}
+
+/*-------------------------------------------------------------------------
+|  static unsigned char  *skip_to_exit (m, s, p, end)
+|  matcher_t      *m;
+|  state_t        s;
+|  unsigned char  *p, *end;
+|
+|  Return the first position from 'p' on (before 'end') of a byte on
+|  which the accelerated state 's' leaves, or 'end' if there is none.
+`------------------------------------------------------------------------*/
+
+static unsigned char  *skip_to_exit (m, s, p, end)
+matcher_t      *m;
+state_t        s;
+unsigned char  *p, *end;
+{
+    unsigned char  *x = &m->exits[s * ACCEL_MAX];
+    unsigned char  *q;
+    int            i;
+#ifdef __SSE2__
+    __m128i        v[ACCEL_MAX], b, eq;
+    int            mask;
+#endif
+
+    if (m->kind[s] & MATCH_LOOP)
+	return end;
+    for (i = 1; i < ACCEL_MAX && x[i] == x[0]; i++)
+	;
+    if (i == ACCEL_MAX) {			/* one exit byte */
+	q = (unsigned char *) memchr(p, x[0], end - p);
+	return (q != NULL) ? q : end;
+    }
+
+#ifdef __SSE2__
+    for (i = 0; i < ACCEL_MAX; i++)
+	v[i] = _mm_set1_epi8((char) x[i]);
+    for (; end - p >= 16; p += 16) {
+	b = _mm_loadu_si128((__m128i *) p);
+	eq = _mm_cmpeq_epi8(b, v[0]);
+	for (i = 1; i < ACCEL_MAX; i++)
+	    eq = _mm_or_si128(eq, _mm_cmpeq_epi8(b, v[i]));
+	if ((mask = _mm_movemask_epi8(eq)) != 0)
+	    return p + __builtin_ctz(mask);
+    }
+#endif
+    for (; p < end; p++)
+	for (i = 0; i < ACCEL_MAX; i++)
+	    if (*p == x[i])
+		return p;
+    return end;
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  match_file (m, name, report, arg)
+|  matcher_t  *m;
+|  char       *name;
+|  void       (*report) ();
+|  void       *arg;
+|
+|  Scan the file 'name' with the matcher 'm' as a stream (see
+|  match_start() and feed_file()). Return the number of matches.
+`------------------------------------------------------------------------*/
+
+size_t  match_file (m, name, report, arg)
+matcher_t  *m;
+char       *name;
+void       (*report) ();
+void       *arg;
+{
+    match_ctx_t  ctx;
+
+    match_start(&ctx, m, report, arg);
+    feed_file(name, match_feed, (void *) &ctx);
+    return match_end(&ctx);
+}
+
+/*-------------------------------------------------------------------------
+|  void  feed_file (name, feed, ctx)
+|  char    *name;
+|  size_t  (*feed) ();
+|  void    *ctx;
+|
+|  Feed the file 'name' ("-": the standard input) to a stream scanner,
+|  by calls (*feed)(ctx, buf, len): a regular file is mapped and fed at
+|  once, anything else as it is read, MATCH_CHUNK bytes at a time.
+`------------------------------------------------------------------------*/
+
+void  feed_file (name, feed, ctx)
+char    *name;
+size_t  (*feed) ();
+void    *ctx;
+{
+    struct stat    st;
+    unsigned char  *buf;
+    size_t         len;
+    ssize_t        n;
+    int            fd;
+
+    if (strcmp(name, "-") == 0)
+	fd = fileno(stdin);
+    else if ((fd = open(name, O_RDONLY)) < 0) {
+	perror(name);
+	exit(1);
+    }
+    buf = NULL;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+	len = (size_t) st.st_size;
+	buf = (unsigned char *) mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (buf != (unsigned char *) MAP_FAILED) {
+	    (*feed)(ctx, buf, len);
+	    munmap(buf, len);
+	} else
+	    buf = NULL;
+    }
+    if (buf == NULL) {
+	buf = (unsigned char *) mem_alloc(MEM_IO, MATCH_CHUNK);
+	while ((n = read(fd, buf, MATCH_CHUNK)) > 0)
+	    (*feed)(ctx, buf, (size_t) n);
+	mem_free(buf);
+    }
+    if (fd != fileno(stdin))
+	close(fd);
+}
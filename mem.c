@@ -0,0 +1,142 @@
+/*-------------------------------------------------------------------------*\
+|  Module "mem.c"
+|
+|  Tracked memory allocation.
+|
+|  All the dynamically allocated data structures are obtained through
+|  mem_alloc() under one of the categories MEM_xxx (see "auto.h").
+|  For every category the number of bytes currently allocated and the
+|  peak (high-water mark) are maintained, so that the stats output can
+|  tell which data structure dominates memory use.
+|
+|  An optional hard cap on the total number of allocated bytes may be
+|  set with mem_set_cap(). An allocation that would exceed the cap (or
+|  that malloc() cannot satisfy) aborts the program with a message
+|  naming the category instead of letting the process get OOM-killed.
+|
+|  Every block is preceded by a small header recording its size and
+|  category so mem_free() needs nothing but the pointer.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "auto.h"
+
+typedef union {		/* block header; the union keeps user data aligned */
+	struct {
+		size_t	size;	/* user size of the block in bytes */
+		int	cat;	/* MEM_xxx category                */
+	} h;
+	long double	align;
+	void		*palign;
+} mem_hdr_t;
+
+static char *mem_names[MEM_NCATS] = {
+	"automata",		/* MEM_AUTOMATON */
+	"class arrays",		/* MEM_CLASSES   */
+	"closure matrix",	/* MEM_CLOSURE   */
+	"inverse index",	/* MEM_INVERSE   */
+	"i/o buffers",		/* MEM_IO        */
+	"layout copies",	/* MEM_LAYOUT    */
+	"matcher tables",	/* MEM_MATCHER   */
+	"symbol dictionary",	/* MEM_DICT      */
+};
+
+static size_t  mem_cur[MEM_NCATS];	/* bytes currently allocated  */
+static size_t  mem_peak[MEM_NCATS];	/* peak bytes per category    */
+static size_t  mem_total;		/* all categories: current    */
+static size_t  mem_total_peak;		/* all categories: peak       */
+static size_t  mem_cap = 0;		/* hard cap (0: unlimited)    */
+
+/*-------------------------------------------------------------------------
+|  void  mem_set_cap (bytes)
+|  size_t  bytes;
+|
+|  Limit the total tracked memory to 'bytes' (0 means no limit).
+`------------------------------------------------------------------------*/
+
+void  mem_set_cap (bytes)
+size_t  bytes;
+{
+    mem_cap = bytes;
+}
+
+/*-------------------------------------------------------------------------
+|  void  *mem_alloc (cat, size)
+|  int     cat;
+|  size_t  size;
+|
+|  Allocate 'size' bytes (zero filled) accounted under category 'cat'.
+|  Never returns NULL.
+`------------------------------------------------------------------------*/
+
+void  *mem_alloc (cat, size)
+int     cat;
+size_t  size;
+{
+    mem_hdr_t  *hdr;
+
+    if (mem_cap != 0 && mem_total + size > mem_cap)
+	Abort(("Memory cap (%lu bytes) exceeded: %lu more bytes needed for %s (%lu in use)\n",
+	       (unsigned long) mem_cap, (unsigned long) size,
+	       mem_names[cat], (unsigned long) mem_total));
+
+    if ((hdr = (mem_hdr_t *) calloc(1, sizeof(mem_hdr_t) + size)) == NULL)
+	Abort(("Out of memory: %lu bytes needed for %s (%lu in use)\n",
+	       (unsigned long) size, mem_names[cat], (unsigned long) mem_total));
+
+    hdr->h.size = size;
+    hdr->h.cat = cat;
+
+    mem_cur[cat] += size;
+    if (mem_cur[cat] > mem_peak[cat])
+	mem_peak[cat] = mem_cur[cat];
+    mem_total += size;
+    if (mem_total > mem_total_peak)
+	mem_total_peak = mem_total;
+
+    return (void *) (hdr + 1);
+}
+
+/*-------------------------------------------------------------------------
+|  void  mem_free (ptr)
+|  void  *ptr;
+|
+|  Release a block obtained from mem_alloc(). NULL is ignored.
+`------------------------------------------------------------------------*/
+
+void  mem_free (ptr)
+void  *ptr;
+{
+    mem_hdr_t  *hdr;
+
+    if (ptr == NULL)
+	return;
+    hdr = (mem_hdr_t *) ptr - 1;
+    mem_cur[hdr->h.cat] -= hdr->h.size;
+    mem_total -= hdr->h.size;
+    free(hdr);
+}
+
+/*-------------------------------------------------------------------------
+|  void  mem_report (fp)
+|  FILE  *fp;
+|
+|  Print current and peak bytes of every category to 'fp'.
+`------------------------------------------------------------------------*/
+
+void  mem_report (fp)
+FILE  *fp;
+{
+    int  cat;
+
+    fprintf(fp, "  %-20s %12s %12s\n", "memory", "current", "peak");
+    for (cat = 0; cat < MEM_NCATS; cat++)
+	fprintf(fp, "  %-20s %12lu %12lu\n", mem_names[cat],
+		(unsigned long) mem_cur[cat], (unsigned long) mem_peak[cat]);
+    fprintf(fp, "  %-20s %12lu %12lu\n", "total",
+	    (unsigned long) mem_total, (unsigned long) mem_total_peak);
+    if (mem_cap != 0)
+	fprintf(fp, "  %-20s %12lu\n", "cap", (unsigned long) mem_cap);
+}
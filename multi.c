@@ -0,0 +1,422 @@
+/*-------------------------------------------------------------------------*\
+|  Module "multi.c"
+|
+|  Matching many minimized DFAs in one pass over the input.
+|
+|  Scanning the same input with k matchers one after the other (module
+|  "match.c") reads it k times; a product automaton reads it once, but
+|  its size explodes. Here every byte of the input is read once and
+|  advances all the matchers, which are merged into one table:
+|
+|    - Byte classes shared by the matchers: two bytes fall in the same
+|      class iff every matcher goes from every state to the same state
+|      on both. The input byte is mapped to its class once, and each
+|      matcher has a row of 'ncls' entries per state (instead of 256).
+|
+|    - The states of all the matchers are numbered on from each other,
+|      and a table entry for matcher state g holds (g * ncls) << 2 - the
+|      offset of its row, ready for the next lookup - ored with the
+|      flags MULTI_ACCEPT and MULTI_RETIRE. The current states of the
+|      matchers are such entries, in a packed vector.
+|
+|    - Built with AVX2, the vector is advanced 8 matchers at a time by
+|      a gather of the next entries; the flags of the 8 are tested at
+|      once.
+|
+|    - A matcher which enters a non-accepting state that it never leaves
+|      (the dead state of an anchored matcher) can match no more: it is
+|      retired from the vector. When all are, the rest of the input is
+|      skipped.
+|
+|  Matches are reported in the order of their offsets, and at the same
+|  offset in the order the matchers were added.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __AVX2__
+#   include <immintrin.h>
+#endif
+
+#include "auto.h"
+
+#define MULTI_ACCEPT	1	/* entry flags */
+#define MULTI_RETIRE	2
+#define MULTI_FLAGS	3
+
+#define NEXT(M, S, C)	((M)->next[(size_t) (S) * 256 + (C)])
+
+void  feed_file ();
+void  match_free ();
+void  trace_begin ();
+void  trace_end ();
+
+static unsigned  col_hash ();
+static int       same_col ();
+static void      retire ();
+
+/*-------------------------------------------------------------------------
+|  multi_t  *multi_new ()
+|
+|  Return a new, empty, multi-matcher.
+`------------------------------------------------------------------------*/
+
+multi_t  *multi_new ()
+{
+    return (multi_t *) mem_alloc(MEM_MATCHER, sizeof(multi_t));
+}
+
+/*-------------------------------------------------------------------------
+|  void  multi_add (mm, m, name)
+|  multi_t    *mm;
+|  matcher_t  *m;
+|  char       *name;
+|
+|  Add the matcher 'm' (which 'mm' takes over), of the DFA 'name', to
+|  the multi-matcher 'mm' (not built yet).
+`------------------------------------------------------------------------*/
+
+void  multi_add (mm, m, name)
+multi_t    *mm;
+matcher_t  *m;
+char       *name;
+{
+    matcher_t  **nm;
+    char       **nn;
+
+    if (mm->n == mm->size) {
+	mm->size = (mm->size == 0) ? 16 : 2 * mm->size;
+	nm = (matcher_t **) mem_alloc(MEM_MATCHER,
+				      mm->size * sizeof(matcher_t *));
+	nn = (char **) mem_alloc(MEM_MATCHER, mm->size * sizeof(char *));
+	if (mm->n > 0) {
+	    memcpy(nm, mm->m, mm->n * sizeof(matcher_t *));
+	    memcpy(nn, mm->names, mm->n * sizeof(char *));
+	}
+	mem_free(mm->m);
+	mem_free(mm->names);
+	mm->m = nm;
+	mm->names = nn;
+    }
+    mm->m[mm->n] = m;
+    mm->names[mm->n++] = name;
+}
+
+/*-------------------------------------------------------------------------
+|  void  multi_build (mm)
+|  multi_t  *mm;
+|
+|  Build the shared byte classes and the merged table of the matchers
+|  of 'mm'. The matchers themselves are released.
+`------------------------------------------------------------------------*/
+
+void  multi_build (mm)
+multi_t  *mm;
+{
+    unsigned   *hash;		/* hash[i * 256 + c]: column of 'c' in m[i] */
+    int        rep[256];	/* rep[k]: a byte of class k                */
+    matcher_t  *m;
+    size_t     rows, g;
+    int        i, c, k;
+    state_t    s, t;
+    unsigned   f;
+
+    trace_begin("multi_build", NULL, NULL);
+    hash = (unsigned *) mem_alloc(MEM_MATCHER,
+				  (mm->n + 1) * 256 * sizeof(unsigned));
+    for (i = 0; i < mm->n; i++)
+	for (c = 0; c < 256; c++)
+	    hash[i * 256 + c] = col_hash(mm->m[i], c);
+
+    /* the shared byte classes */
+    mm->ncls = 0;
+    for (c = 0; c < 256; c++) {
+	for (k = 0; k < mm->ncls; k++) {
+	    for (i = 0; i < mm->n; i++)
+		if (hash[i * 256 + c] != hash[i * 256 + rep[k]]
+		    || ! same_col(mm->m[i], c, rep[k]))
+		    break;
+	    if (i == mm->n)
+		break;
+	}
+	if (k == mm->ncls)
+	    rep[mm->ncls++] = c;
+	mm->cls[c] = (unsigned char) k;
+    }
+    mem_free(hash);
+
+    /* the merged table: matcher i has states base[i] + 0 .. nstates */
+    mm->base = (size_t *) mem_alloc(MEM_MATCHER,
+				    (mm->n + 1) * sizeof(size_t));
+    for (i = 0, rows = 0; i < mm->n; i++) {
+	mm->base[i] = rows;
+	rows += mm->m[i]->nstates + 1;
+    }
+    mm->base[mm->n] = rows;
+    if ((double) rows * mm->ncls * 4 >= (double) (1U << 31))
+	Abort(("Too many states (%lu) in the DFAs matched together\n",
+	       (unsigned long) rows));
+    mm->table = (unsigned *) mem_alloc(MEM_MATCHER,
+				       rows * mm->ncls * sizeof(unsigned));
+    mm->start = (unsigned *) mem_alloc(MEM_MATCHER,
+				       (mm->n + 1) * sizeof(unsigned));
+    for (i = 0; i < mm->n; i++) {
+	m = mm->m[i];
+	for (s = 1; s <= m->nstates; s++)
+	    for (k = 0; k < mm->ncls; k++) {
+		t = NEXT(m, s, rep[k]);
+		g = mm->base[i] + t;
+		f = (m->kind[t] & MATCH_ACCEPT) ? MULTI_ACCEPT
+		    : (m->kind[t] & MATCH_LOOP) ? MULTI_RETIRE : 0;
+		mm->table[(mm->base[i] + s) * mm->ncls + k] =
+		    (unsigned) ((g * mm->ncls) << 2) | f;
+	    }
+	mm->start[i] = (unsigned) (((mm->base[i] + m->init) * mm->ncls) << 2);
+	match_free(m);
+	mm->m[i] = NULL;
+    }
+    trace_end("multi_build");
+}
+
+/*-------------------------------------------------------------------------
+|  static unsigned  col_hash (m, c)
+|  matcher_t  *m;
+|  int        c;
+|
+|  Hash the column of byte 'c' in the table of the matcher 'm'.
+`------------------------------------------------------------------------*/
+
+static unsigned  col_hash (m, c)
+matcher_t  *m;
+int        c;
+{
+    unsigned  h = 2166136261u;
+    state_t   s;
+
+    for (s = 1; s <= m->nstates; s++)
+	h = (h ^ (unsigned) NEXT(m, s, c)) * 16777619u;
+    return h;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  same_col (m, c, d)
+|  matcher_t  *m;
+|  int        c, d;
+|
+|  Return TRUE iff the bytes 'c' and 'd' have the same column in the
+|  table of the matcher 'm'.
+`------------------------------------------------------------------------*/
+
+static int  same_col (m, c, d)
+matcher_t  *m;
+int        c, d;
+{
+    state_t  s;
+
+    for (s = 1; s <= m->nstates; s++)
+	if (NEXT(m, s, c) != NEXT(m, s, d))
+	    return FALSE;
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+|  void  multi_free (mm)
+|  multi_t  *mm;
+|
+|  Release the multi-matcher 'mm'.
+`------------------------------------------------------------------------*/
+
+void  multi_free (mm)
+multi_t  *mm;
+{
+    int  i;
+
+    for (i = 0; i < mm->n; i++)
+	if (mm->m[i] != NULL)
+	    match_free(mm->m[i]);
+    mem_free(mm->m);
+    mem_free(mm->names);
+    mem_free(mm->base);
+    mem_free(mm->table);
+    mem_free(mm->start);
+    mem_free(mm);
+}
+
+/*-------------------------------------------------------------------------
+|  void  multi_start (ctx, mm, report, arg)
+|  multi_ctx_t  *ctx;
+|  multi_t      *mm;
+|  void         (*report) ();
+|  void         *arg;
+|
+|  Start 'ctx' on a new stream scanned with all the matchers of the
+|  (built) multi-matcher 'mm', calling (*report)(arg, i, offset) at every
+|  match of matcher 'i' ('offset' being that of the byte after it).
+`------------------------------------------------------------------------*/
+
+void  multi_start (ctx, mm, report, arg)
+multi_ctx_t  *ctx;
+multi_t      *mm;
+void         (*report) ();
+void         *arg;
+{
+    int  i;
+
+    ctx->mm = mm;
+    ctx->st = (unsigned *) mem_alloc(MEM_MATCHER,
+				     (mm->n + 8) * sizeof(unsigned));
+    ctx->id = (int *) mem_alloc(MEM_MATCHER, (mm->n + 8) * sizeof(int));
+    for (i = 0; i < mm->n; i++) {
+	ctx->st[i] = mm->start[i];
+	ctx->id[i] = i;
+    }
+    ctx->nact = mm->n;
+    ctx->retired = 0;
+    ctx->skipped = 0;
+    ctx->offset = 0;
+    ctx->count = 0;
+    ctx->report = report;
+    ctx->arg = arg;
+}
+
+/*-------------------------------------------------------------------------
+|  void  multi_end (ctx)
+|  multi_ctx_t  *ctx;
+|
+|  Release the scanning context 'ctx'.
+`------------------------------------------------------------------------*/
+
+void  multi_end (ctx)
+multi_ctx_t  *ctx;
+{
+    mem_free(ctx->st);
+    mem_free(ctx->id);
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  multi_feed (ctx, buf, len)
+|  multi_ctx_t    *ctx;
+|  unsigned char  *buf;
+|  size_t         len;
+|
+|  Scan the next 'len' bytes of the stream of 'ctx', at 'buf', with all
+|  the matchers not retired. Return the number of matches ending in them.
+`------------------------------------------------------------------------*/
+
+size_t  multi_feed (ctx, buf, len)
+multi_ctx_t    *ctx;
+unsigned char  *buf;
+size_t         len;
+{
+    multi_t        *mm = ctx->mm;
+    unsigned       *table = mm->table;
+    unsigned       *st = ctx->st;
+    unsigned char  *p, *end = buf + len;
+    unsigned       e, c;
+    int            i, i8, dead;
+    size_t         count = 0, off;
+#ifdef __AVX2__
+    __m256i        v, idx, flags;
+    __m256i        zero = _mm256_setzero_si256();
+    __m256i        fmask = _mm256_set1_epi32(MULTI_FLAGS);
+    int            hit;
+#endif
+
+    for (p = buf; p < end && ctx->nact > 0; p++) {
+	c = mm->cls[*p];
+	i8 = 0;
+	dead = FALSE;
+#ifdef __AVX2__
+	for (; i8 + 8 <= ctx->nact; i8 += 8) {
+	    v = _mm256_loadu_si256((__m256i *) &st[i8]);
+	    idx = _mm256_add_epi32(_mm256_srli_epi32(v, 2),
+				   _mm256_set1_epi32((int) c));
+	    v = _mm256_i32gather_epi32((int *) table, idx, 4);
+	    _mm256_storeu_si256((__m256i *) &st[i8], v);
+	    flags = _mm256_cmpeq_epi32(_mm256_and_si256(v, fmask), zero);
+	    hit = ~_mm256_movemask_ps(_mm256_castsi256_ps(flags)) & 0xff;
+	    while (hit != 0) {	/* lanes with flags, in order */
+		i = i8 + __builtin_ctz(hit);
+		hit &= hit - 1;
+		if (st[i] & MULTI_ACCEPT) {
+		    count++;
+		    if (ctx->report != NULL)
+			(*ctx->report)(ctx->arg, ctx->id[i],
+				       ctx->offset + (size_t) (p + 1 - buf));
+		} else
+		    dead = TRUE;
+	    }
+	}
+#endif
+	for (i = i8; i < ctx->nact; i++) {
+	    e = table[(st[i] >> 2) + c];
+	    st[i] = e;
+	    if ((e & MULTI_FLAGS) == 0)
+		continue;
+	    if ((e & MULTI_ACCEPT) != 0) {
+		count++;
+		if (ctx->report != NULL)
+		    (*ctx->report)(ctx->arg, ctx->id[i],
+				   ctx->offset + (size_t) (p + 1 - buf));
+	    } else
+		dead = TRUE;
+	}
+	if (dead)		/* retire the matchers that went dead */
+	    for (i = 0; i < ctx->nact; i++)
+		if (st[i] & MULTI_RETIRE)
+		    retire(ctx, i--);
+    }
+    off = (size_t) (p - buf);
+    ctx->skipped += len - off;
+    ctx->offset += len;
+    ctx->count += count;
+    return count;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  retire (ctx, i)
+|  multi_ctx_t  *ctx;
+|  int          i;
+|
+|  Remove the i-th matcher of the vector of 'ctx', keeping the order of
+|  the others.
+`------------------------------------------------------------------------*/
+
+static void  retire (ctx, i)
+multi_ctx_t  *ctx;
+int          i;
+{
+    ctx->nact--;
+    memmove(&ctx->st[i], &ctx->st[i + 1], (ctx->nact - i) * sizeof(unsigned));
+    memmove(&ctx->id[i], &ctx->id[i + 1], (ctx->nact - i) * sizeof(int));
+    ctx->retired++;
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  multi_file (mm, name, report, arg)
+|  multi_t  *mm;
+|  char     *name;
+|  void     (*report) ();
+|  void     *arg;
+|
+|  Scan the file 'name' with all the matchers of 'mm' in one pass (see
+|  multi_start() and feed_file()). Return the number of matches.
+`------------------------------------------------------------------------*/
+
+size_t  multi_file (mm, name, report, arg)
+multi_t  *mm;
+char     *name;
+void     (*report) ();
+void     *arg;
+{
+    multi_ctx_t  ctx;
+
+    multi_start(&ctx, mm, report, arg);
+    feed_file(name, multi_feed, (void *) &ctx);
+    mm->scanned = ctx.offset;
+    mm->retired = ctx.retired;
+    mm->skipped = ctx.skipped;
+    multi_end(&ctx);
+    return ctx.count;
+}
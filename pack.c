@@ -0,0 +1,406 @@
+/*-------------------------------------------------------------------------*\
+|  Module "pack.c"
+|
+|  Packs of minimized DFAs: many DFAs in one file (written with the -h
+|  option), each found by its name at once, and used in place from the
+|  file mapped into memory - no file to open, nor DFA to read, per DFA.
+|
+|  A pack is, in the byte order of the machine that wrote it:
+|               +---------------------------------+
+|               |  the header: "MINAPACK", byte   |
+|               |  order & version, the number of |
+|               |  DFAs, of slots, and the size   |
+|               |  the slots of the index         |
+|               |  the names                      |
+|               |  the DFAs, a section each       |
+|               +---------------------------------+
+|  The index is a hash table of the names (FNV-1a, linear probing, at
+|  most half full): every slot has the hash of a name, and the offsets
+|  in the file of the name and of the section of its DFA (0 if the slot
+|  is empty). A section, at an offset multiple of PACK_ALIGN, is:
+|               +---------------------------------+
+|               |  NSTATES  NAB  INIT  0          |
+|               |  cls[256]                       |
+|               |  next[(NSTATES + 1) * (NAB + 1)]|
+|               |  accept[NSTATES + 1]            |
+|               +---------------------------------+
+|  the DFA canonically numbered (see module "canon.c"), its states 1 ..
+|  NSTATES (32 bit words): cls[] maps every byte to its symbol (0 if it
+|  is none), next[] has the row of every state (state 0 and symbol 0
+|  lead nowhere, i.e. to 0), and accept[S] is 1 if S accepts. A section
+|  is thus a matcher ready to run: S = next[S * (NAB + 1) + cls[byte]].
+|  The DFA of the empty language is one state, without transitions.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "auto.h"
+
+#ifndef PACK_ALIGN
+#   define PACK_ALIGN	64		/* sections: a cache line each */
+#endif
+
+#define PACK_MAGIC	"MINAPACK"
+#define PACK_ORDER	0x01020304u
+#define PACK_VERSION	1u
+
+typedef struct {
+	char			magic[8];
+	unsigned		order;		/* PACK_ORDER, as written     */
+	unsigned		version;
+	unsigned		ndfas;
+	unsigned		nslots;		/* a power of 2               */
+	unsigned long long	size;		/* of the file                */
+} pack_head_t;
+
+#define SECT_HEAD	(4 * sizeof(unsigned) + 256)	/* up to next[] */
+#define SECT_SIZE(N, NAB)	(SECT_HEAD + (size_t) ((N) + 1) * ((NAB) + 1) \
+				 * sizeof(unsigned) + (N) + 1)
+#define ALIGN(X)	(((X) + PACK_ALIGN - 1) / PACK_ALIGN * PACK_ALIGN)
+
+extern char  ab_map[];
+
+void  trace_begin ();
+void  trace_end ();
+
+static unsigned long long  name_hash ();
+
+/*-------------------------------------------------------------------------
+|  pack_t  *pack_new ()
+|
+|  Return a new, empty, pack to write.
+`------------------------------------------------------------------------*/
+
+pack_t  *pack_new ()
+{
+    return (pack_t *) mem_alloc(MEM_IO, sizeof(pack_t));
+}
+
+/*-------------------------------------------------------------------------
+|  void  pack_add (pk, name, dfa)
+|  pack_t       *pk;
+|  char         *name;
+|  automaton_t  *dfa;
+|
+|  Add the canonically numbered (see module "canon.c") minimized DFA
+|  'dfa' to the pack 'pk', under the name 'name'.
+`------------------------------------------------------------------------*/
+
+void  pack_add (pk, name, dfa)
+pack_t       *pk;
+char         *name;
+automaton_t  *dfa;
+{
+    int            n, nab = dfa->nab, j;
+    size_t         len, *nat;
+    char           **nnames;
+    unsigned char  *ndata, *sect;
+    unsigned       *head, *next;
+    state_t        s;
+
+    n = (dfa->state_attrib[dfa->init_state] == 'D') ? 0 : dfa->nstates;
+    if (pk->n == pk->size) {
+	pk->size = (pk->size == 0) ? 16 : 2 * pk->size;
+	nnames = (char **) mem_alloc(MEM_IO, pk->size * sizeof(char *));
+	nat = (size_t *) mem_alloc(MEM_IO, pk->size * sizeof(size_t));
+	if (pk->n > 0) {
+	    memcpy(nnames, pk->names, pk->n * sizeof(char *));
+	    memcpy(nat, pk->at, pk->n * sizeof(size_t));
+	    mem_free(pk->names);
+	    mem_free(pk->at);
+	}
+	pk->names = nnames;
+	pk->at = nat;
+    }
+    len = ALIGN(SECT_SIZE(n > 0 ? n : 1, nab));
+    if (pk->len + len > pk->room) {
+	pk->room = 2 * (pk->room + len);
+	ndata = (unsigned char *) mem_alloc(MEM_IO, pk->room);
+	if (pk->len > 0) {
+	    memcpy(ndata, pk->data, pk->len);
+	    mem_free(pk->data);
+	}
+	pk->data = ndata;
+    }
+
+    pk->names[pk->n] = (char *) mem_alloc(MEM_IO, strlen(name) + 1);
+    strcpy(pk->names[pk->n], name);
+    pk->at[pk->n++] = pk->len;
+    sect = pk->data + pk->len;		/* zeroed by mem_alloc() */
+    pk->len += len;
+
+    head = (unsigned *) sect;
+    head[0] = (n > 0) ? n : 1;
+    head[1] = nab;
+    head[2] = (n > 0) ? dfa->init_state : 1;
+    for (j = 1; j <= nab; j++)
+	sect[4 * sizeof(unsigned) + (unsigned char) ab_map[j]] = j;
+    next = (unsigned *) (sect + SECT_HEAD);
+    for (s = 1; s <= n; s++) {
+	for (j = 1; j <= nab; j++)
+	    next[s * (nab + 1) + j] = dfa->mat[s][j];
+	sect[SECT_HEAD + (size_t) (n + 1) * (nab + 1) * sizeof(unsigned) + s]
+	    = (dfa->state_attrib[s] == 'A');
+    }
+}
+
+/*-------------------------------------------------------------------------
+|  long  pack_write (pk, fp)
+|  pack_t  *pk;
+|  FILE    *fp;
+|
+|  Write the pack 'pk' to 'fp'. Return its size in bytes.
+`------------------------------------------------------------------------*/
+
+long  pack_write (pk, fp)
+pack_t  *pk;
+FILE    *fp;
+{
+    pack_head_t         head;
+    pack_slot_t         *slots;
+    unsigned long long  hash;
+    size_t              *names, base, pos;
+    unsigned            nslots, h;
+    int                 i;
+    static char         zeros[PACK_ALIGN];
+
+    trace_begin("pack_write", NULL, NULL);
+    for (nslots = 2; nslots < 2 * (unsigned) pk->n; nslots *= 2)
+	;
+    slots = (pack_slot_t *) mem_alloc(MEM_IO, nslots * sizeof(pack_slot_t));
+    names = (size_t *) mem_alloc(MEM_IO, (pk->n + 1) * sizeof(size_t));
+    pos = sizeof(pack_head_t) + nslots * sizeof(pack_slot_t);
+    for (i = 0; i < pk->n; i++) {
+	names[i] = pos;
+	pos += strlen(pk->names[i]) + 1;
+    }
+    base = ALIGN(pos);
+
+    for (i = 0; i < pk->n; i++) {
+	hash = name_hash(pk->names[i]);
+	for (h = hash & (nslots - 1); slots[h].dfa != 0;
+	     h = (h + 1) & (nslots - 1))
+	    if (strcmp(pk->names[i], pk->names[slots[h].name]) == 0)
+		Abort(("The DFA %s is twice in the pack\n", pk->names[i]));
+	slots[h].hash = hash;
+	slots[h].name = i;		/* for now: the number of the name */
+	slots[h].dfa = base + pk->at[i];
+    }
+    for (h = 0; h < nslots; h++)
+	if (slots[h].dfa != 0)		/* ... now: its offset */
+	    slots[h].name = names[slots[h].name];
+
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, PACK_MAGIC, sizeof(head.magic));
+    head.order = PACK_ORDER;
+    head.version = PACK_VERSION;
+    head.ndfas = pk->n;
+    head.nslots = nslots;
+    head.size = base + pk->len;
+    fwrite((char *) &head, sizeof(head), 1, fp);
+    fwrite((char *) slots, sizeof(pack_slot_t), nslots, fp);
+    for (i = 0; i < pk->n; i++)
+	fwrite(pk->names[i], 1, strlen(pk->names[i]) + 1, fp);
+    fwrite(zeros, 1, base - pos, fp);
+    fwrite((char *) pk->data, 1, pk->len, fp);
+    if (fflush(fp) != 0) {
+	perror("pack");
+	exit(1);
+    }
+
+    mem_free(names);
+    mem_free(slots);
+    trace_end("pack_write");
+    return (long) head.size;
+}
+
+/*-------------------------------------------------------------------------
+|  pack_t  *pack_open (name)
+|  char  *name;
+|
+|  Map the pack file 'name' into memory, and return it; abort if it is
+|  no pack.
+`------------------------------------------------------------------------*/
+
+pack_t  *pack_open (name)
+char  *name;
+{
+    pack_t       *pk;
+    pack_head_t  *head;
+    struct stat  st;
+    int          fd;
+
+    if ((fd = open(name, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+	perror(name);
+	exit(1);
+    }
+    pk = (pack_t *) mem_alloc(MEM_IO, sizeof(pack_t));
+    pk->maplen = (size_t) st.st_size;
+    if (pk->maplen < sizeof(pack_head_t))
+	Abort(("%s is not a pack of DFAs\n", name));
+    pk->map = (unsigned char *) mmap(NULL, pk->maplen, PROT_READ,
+				     MAP_PRIVATE, fd, 0);
+    if (pk->map == (unsigned char *) MAP_FAILED) {
+	perror(name);
+	exit(1);
+    }
+    close(fd);
+
+    head = (pack_head_t *) pk->map;
+    if (memcmp(head->magic, PACK_MAGIC, sizeof(head->magic)) != 0)
+	Abort(("%s is not a pack of DFAs\n", name));
+    if (head->order != PACK_ORDER || head->version != PACK_VERSION)
+	Abort(("The pack %s is of another byte order or version\n", name));
+    pk->nslots = head->nslots;
+    if (head->size != pk->maplen || pk->nslots == 0
+	|| (pk->nslots & (pk->nslots - 1)) != 0
+	|| sizeof(pack_head_t) + (size_t) pk->nslots * sizeof(pack_slot_t)
+	   > pk->maplen)
+	Abort(("The pack %s is damaged\n", name));
+    pk->slots = (pack_slot_t *) (pk->map + sizeof(pack_head_t));
+    return pk;
+}
+
+/*-------------------------------------------------------------------------
+|  int  pack_find (pk, name, dfa)
+|  pack_t      *pk;
+|  char        *name;
+|  pack_dfa_t  *dfa;
+|
+|  Find the DFA 'name' in the (mapped) pack 'pk': make 'dfa' a view of
+|  it, and return TRUE; FALSE if it is not in the pack.
+`------------------------------------------------------------------------*/
+
+int  pack_find (pk, name, dfa)
+pack_t      *pk;
+char        *name;
+pack_dfa_t  *dfa;
+{
+    unsigned long long  hash = name_hash(name), at;
+    pack_slot_t         *slot;
+    unsigned            h, *head;
+    size_t              len = strlen(name) + 1, words;
+
+    for (h = hash & (pk->nslots - 1); (slot = &pk->slots[h])->dfa != 0;
+	 h = (h + 1) & (pk->nslots - 1)) {
+	if (slot->hash != hash || len > pk->maplen
+	    || slot->name > pk->maplen - len
+	    || memcmp(pk->map + slot->name, name, len) != 0)
+	    continue;
+	if ((at = slot->dfa) % PACK_ALIGN != 0 || at > pk->maplen - SECT_HEAD)
+	    Abort(("The pack is damaged at the DFA %s\n", name));
+	head = (unsigned *) (pk->map + at);
+	/* the sizes are checked against the file only: the view does not
+	   depend on those of an automaton_t (see pack_load()) */
+	words = (pk->maplen - at - SECT_HEAD) / sizeof(unsigned);
+	if (head[0] < 1 || head[1] < 1 || head[2] < 1 || head[2] > head[0]
+	    || (size_t) head[1] + 1 > words
+	    || (size_t) head[0] + 1 > words / ((size_t) head[1] + 1)
+	    || SECT_SIZE(head[0], head[1]) > pk->maplen - at)
+	    Abort(("The pack is damaged at the DFA %s\n", name));
+	dfa->nstates = head[0];
+	dfa->nab = head[1];
+	dfa->init = head[2];
+	dfa->cls = pk->map + at + 4 * sizeof(unsigned);
+	dfa->next = (unsigned *) (pk->map + at + SECT_HEAD);
+	dfa->accept = pk->map + at + SECT_HEAD
+		      + (size_t) (dfa->nstates + 1) * (dfa->nab + 1)
+		      * sizeof(unsigned);
+	return TRUE;
+    }
+    return FALSE;
+}
+
+/*-------------------------------------------------------------------------
+|  void  pack_load (view, dfa)
+|  pack_dfa_t   *view;
+|  automaton_t  *dfa;
+|
+|  Copy the DFA of a pack 'view' into 'dfa' (its alphabet into ab_map[]),
+|  for the functions that take the matrix of an automaton_t. Abort if it
+|  does not fit in one (a pack written by a build with a larger
+|  MAX_STATES or AB_SIZE).
+`------------------------------------------------------------------------*/
+
+void  pack_load (view, dfa)
+pack_dfa_t   *view;
+automaton_t  *dfa;
+{
+    int      nab = view->nab, c, j, nacc = 0;
+    state_t  s, t;
+
+    if ((unsigned) view->nstates > (unsigned) MAX_STATES)
+	Abort(("Number of states (%d) too large, recompile with \"-DMAX_STATES=%d\"\n",
+	       view->nstates, view->nstates));
+    if ((unsigned) nab > (unsigned) AB_SIZE)
+	Abort(("Alphabet size (%d) too large, recompile with \"-DAB_SIZE=%d\"\n",
+	       nab, nab));
+    dfa->nstates = view->nstates;
+    dfa->nab = nab;
+    dfa->init_state = view->init;
+    for (c = 255; c >= 0; c--)
+	if (view->cls[c] > 0 && view->cls[c] <= nab)
+	    ab_map[view->cls[c]] = (char) c;
+    for (s = 1; s <= view->nstates; s++) {
+	for (j = 1; j <= nab; j++) {
+	    t = view->next[s * (nab + 1) + j];
+	    if (t < 0 || t > view->nstates)
+		Abort(("The pack is damaged: a transition to %d\n", t));
+	    dfa->mat[s][j] = t;
+	}
+	dfa->state_attrib[s] = view->accept[s] ? 'A' : '\0';
+	if (view->accept[s])
+	    dfa->accept[nacc++] = s;
+    }
+    dfa->accept[nacc] = 0;
+    if (nacc == 0)			/* the empty language */
+	dfa->state_attrib[dfa->init_state] = 'D';
+    dfa->cols = NULL;
+    dfa->packed = NULL;
+    dfa->outs = NULL;
+}
+
+/*-------------------------------------------------------------------------
+|  void  pack_free (pk)
+|  pack_t  *pk;
+|
+|  Release the pack 'pk', written or mapped.
+`------------------------------------------------------------------------*/
+
+void  pack_free (pk)
+pack_t  *pk;
+{
+    int  i;
+
+    for (i = 0; i < pk->n; i++)
+	mem_free(pk->names[i]);
+    mem_free(pk->names);
+    mem_free(pk->at);
+    mem_free(pk->data);
+    if (pk->map != NULL)
+	munmap((char *) pk->map, pk->maplen);
+    mem_free(pk);
+}
+
+/*-------------------------------------------------------------------------
+|  static unsigned long long  name_hash (name)
+|  char  *name;
+|
+|  The 64 bit FNV-1a hash of the string 'name'.
+`------------------------------------------------------------------------*/
+
+static unsigned long long  name_hash (name)
+char  *name;
+{
+    unsigned long long  h = 14695981039346656037ULL;
+
+    while (*name != '\0')
+	h = (h ^ (unsigned char) *name++) * 1099511628211ULL;
+    return h;
+}
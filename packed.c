@@ -0,0 +1,240 @@
+/*-------------------------------------------------------------------------*\
+|  Module "packed.c"
+|
+|  Compressed (packed) copy of the transitions of a DFA.
+|
+|  Large sparse DFAs mostly hold missing transitions, and their targets
+|  tend to lie close to the source state. The packed store keeps, for
+|  every state in turn, only its defined transitions, as varints
+|  (7 bits per byte, high bit set on all but the last byte):
+|
+|      row    :=  count  { symbol_gap  target_delta }*count
+|
+|  where 'symbol_gap' is the distance from the previous defined symbol
+|  (from symbol 0 for the first one) and 'target_delta' is the zig-zag
+|  encoded (small magnitude -> small number) difference target - source.
+|
+|  Rows are decoded sequentially through a cursor (pk_seek(), pk_next(),
+|  pk_next_row()). For random access, the offset of every PACK_BLOCK-th
+|  row is kept in a block index: pk_seek() jumps to the block of the
+|  wanted state and skips at most PACK_BLOCK - 1 rows.
+\*-------------------------------------------------------------------------*/
+
+#include "auto.h"
+
+#ifndef PACK_BLOCK
+#   define PACK_BLOCK	16	/* rows per block index entry */
+#endif
+
+#define ZIGZAG(D)	(((unsigned) (D) << 1) ^ (unsigned) ((D) >> 31))
+#define UNZIGZAG(U)	((int) ((U) >> 1) ^ -(int) ((U) & 1))
+
+static size_t  put_varint ();
+static void    skip_row ();
+
+/*-------------------------------------------------------------------------
+|  static size_t  put_varint (p, v)
+|  unsigned char  *p;
+|  unsigned       v;
+|
+|  Store the varint 'v' at 'p' (unless 'p' is NULL), and return its
+|  length in bytes.
+`------------------------------------------------------------------------*/
+
+static size_t  put_varint (p, v)
+unsigned char  *p;
+unsigned       v;
+{
+    size_t  n = 0;
+
+    do {
+	if (p != NULL)
+	    p[n] = (unsigned char) ((v & 0x7f) | (v > 0x7f ? 0x80 : 0));
+	n++;
+	v >>= 7;
+    } while (v != 0);
+    return n;
+}
+
+/*
+ |  Decode a varint at 'P' into 'V', advancing 'P'
+ */
+#define GET_VARINT(P, V) {						\
+	unsigned  _s = 0;						\
+	(V) = 0;							\
+	do {								\
+	    (V) |= (unsigned) (*(P) & 0x7f) << _s;			\
+	    _s += 7;							\
+	} while (*(P)++ & 0x80);					\
+    }
+
+/*-------------------------------------------------------------------------
+|  void  make_packed (dfa)
+|  automaton_t  *dfa;
+|
+|  Make the packed copy 'dfa->packed' of the transitions of 'dfa'.
+|  Two passes: the first one only sizes the store.
+`------------------------------------------------------------------------*/
+
+void  make_packed (dfa)
+automaton_t  *dfa;
+{
+    packed_t       *pk;
+    unsigned char  *data = NULL;	/* NULL on the sizing pass */
+    size_t         len;
+    int            pass, a, prev, count;
+    state_t        s, t;
+
+    pk = (packed_t *) mem_alloc(MEM_LAYOUT, sizeof(packed_t));
+    pk->nstates = dfa->nstates;
+    pk->index = (size_t *) mem_alloc(MEM_LAYOUT,
+			(dfa->nstates / PACK_BLOCK + 1) * sizeof(size_t));
+
+    for (pass = 0; pass < 2; pass++) {
+	len = 0;
+	for (s = 1; s <= dfa->nstates; s++) {
+	    if ((s - 1) % PACK_BLOCK == 0)
+		pk->index[(s - 1) / PACK_BLOCK] = len;
+	    count = 0;
+	    for (a = 1; a <= dfa->nab; a++)
+		if (dfa->mat[s][a] > 0)
+		    count++;
+	    len += put_varint(data ? data + len : NULL, (unsigned) count);
+	    for (a = 1, prev = 0; a <= dfa->nab; a++)
+		if ((t = dfa->mat[s][a]) > 0) {
+		    len += put_varint(data ? data + len : NULL,
+				      (unsigned) (a - prev));
+		    len += put_varint(data ? data + len : NULL, ZIGZAG(t - s));
+		    prev = a;
+		}
+	}
+	if (pass == 0)
+	    data = (unsigned char *) mem_alloc(MEM_LAYOUT, len + 1);
+    }
+    pk->data = data;
+    pk->len = len;
+    dfa->packed = pk;
+}
+
+/*-------------------------------------------------------------------------
+|  void  free_packed (dfa)
+|  automaton_t  *dfa;
+|
+|  Release the packed copy of 'dfa', if any.
+`------------------------------------------------------------------------*/
+
+void  free_packed (dfa)
+automaton_t  *dfa;
+{
+    if (dfa->packed == NULL)
+	return;
+    mem_free(dfa->packed->data);
+    mem_free(dfa->packed->index);
+    mem_free(dfa->packed);
+    dfa->packed = NULL;
+}
+
+/*-------------------------------------------------------------------------
+|  size_t  packed_size (pk)
+|  packed_t  *pk;
+|
+|  Return the number of bytes taken by the packed store 'pk'.
+`------------------------------------------------------------------------*/
+
+size_t  packed_size (pk)
+packed_t  *pk;
+{
+    return pk->len + (pk->nstates / PACK_BLOCK + 1) * sizeof(size_t)
+	   + sizeof(packed_t);
+}
+
+/*-------------------------------------------------------------------------
+|  void  pk_seek (pk, s, c)
+|  packed_t     *pk;
+|  state_t      s;
+|  pk_cursor_t  *c;
+|
+|  Position the cursor 'c' at the first transition of state 's'.
+`------------------------------------------------------------------------*/
+
+void  pk_seek (pk, s, c)
+packed_t     *pk;
+state_t      s;
+pk_cursor_t  *c;
+{
+    state_t  r;
+    unsigned n;
+
+    c->p = pk->data + pk->index[(s - 1) / PACK_BLOCK];
+    for (r = s - (s - 1) % PACK_BLOCK; r < s; r++)
+	skip_row(c);
+    GET_VARINT(c->p, n);
+    c->left = (int) n;
+    c->sym = 0;
+    c->src = s;
+}
+
+/*-------------------------------------------------------------------------
+|  int  pk_next (c, a, t)
+|  pk_cursor_t  *c;
+|  int          *a;
+|  state_t      *t;
+|
+|  Decode the next defined transition of the current row of 'c' into
+|  symbol '*a' and target '*t'. Return FALSE at the end of the row.
+`------------------------------------------------------------------------*/
+
+int  pk_next (c, a, t)
+pk_cursor_t  *c;
+int          *a;
+state_t      *t;
+{
+    unsigned  v;
+
+    if (c->left == 0)
+	return FALSE;
+    c->left--;
+    GET_VARINT(c->p, v);
+    c->sym += (int) v;
+    GET_VARINT(c->p, v);
+    *a = c->sym;
+    *t = c->src + UNZIGZAG(v);
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+|  void  pk_next_row (c)
+|  pk_cursor_t  *c;
+|
+|  Move the cursor 'c', whose current row was decoded to its end, to
+|  the start of the next row (which must exist).
+`------------------------------------------------------------------------*/
+
+void  pk_next_row (c)
+pk_cursor_t  *c;
+{
+    unsigned  n;
+
+    GET_VARINT(c->p, n);
+    c->left = (int) n;
+    c->sym = 0;
+    c->src++;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  skip_row (c)
+|  pk_cursor_t  *c;
+|
+|  Move the cursor 'c', at the start of a row, past that row.
+`------------------------------------------------------------------------*/
+
+static void  skip_row (c)
+pk_cursor_t  *c;
+{
+    unsigned  n, i;
+
+    GET_VARINT(c->p, n);
+    for (i = 0; i < 2 * n; i++)
+	while (*c->p++ & 0x80)
+	    ;
+}
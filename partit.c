@@ -22,6 +22,9 @@
 extern state_t   find ();
 extern void      Union ();
 
+void             trace_begin ();
+void             trace_end ();
+
 #ifdef DEBUG
   extern void dump_state ();
 #endif
@@ -167,14 +170,18 @@ int  partition (dfa, old_groups)
 automaton_t   *dfa;
 state_t       old_groups[];
 {
-    state_t	member[MAX_STATES + 1];      /* single-group members */
-    state_t	new_groups[MAX_STATES + 1];  /* temporary Union-Find array */
-    char	unified[MAX_STATES + 1];     /* flags to mark unified states */
+    state_t	*member;                     /* single-group members */
+    state_t	*new_groups;                 /* temporary Union-Find array */
+    char	*unified;                    /* flags to mark unified states */
     state_t	rep;                         /* group representative */
     int		updated = FALSE;
     int		group_size, nstates = dfa->nstates;
     int		i, j;
 
+    member = (state_t *) mem_alloc(MEM_CLASSES, (nstates + 1) * sizeof(state_t));
+    new_groups = (state_t *) mem_alloc(MEM_CLASSES, (nstates + 1) * sizeof(state_t));
+    unified = (char *) mem_alloc(MEM_CLASSES, nstates + 1);
+
     for (rep = 1; rep <= nstates; rep++) {
 	if (old_groups[rep] >= 0)     /* skip non-representatives */
 	    continue;                 /* and groups with cardinality 1 */
@@ -236,6 +243,39 @@ state_t       old_groups[];
 	    updated = TRUE;
 	}
     }
+    mem_free(member);
+    mem_free(new_groups);
+    mem_free(unified);
     return (updated);
 }
 
+
+
+/*-------------------------------------------------------------------------
+|  int  aho_refine (dfa, groups)
+|  automaton_t   *dfa;
+|  state_t       groups[];
+|
+|  The "aho" minimization engine: starting from the accept / non-accept
+|  partition, partition the equivalence-classes of states in the Union-
+|  Find array 'groups[]' until no further partition can be done.
+|  Return the number of partition rounds.
+`------------------------------------------------------------------------*/
+
+int  aho_refine (dfa, groups)
+automaton_t   *dfa;
+state_t       groups[];
+{
+    int  more, rounds = 0;
+
+    init_partitions(dfa->nstates, dfa->state_attrib, groups);
+
+    do {
+	trace_begin("partition_round", NULL, NULL);
+	more = partition(dfa, groups);
+	trace_end("partition_round");
+	rounds++;
+    } while (more == TRUE);
+
+    return rounds;
+}
@@ -0,0 +1,401 @@
+/*-------------------------------------------------------------------------*\
+|  Module "prefilter.c"
+|
+|  Literal prefilters of minimized DFAs.
+|
+|  A DFA often accepts only words containing some fixed string ("rror"
+|  for all the words of "[ab]?error"): a literal which a matcher can look
+|  for with a fast string search, starting the DFA only a little before
+|  each occurrence (see module "match.c"). The analysis is done on the
+|  live states of a minimized DFA (dead states marked).
+|
+|  Required literals: add a sink X after every accept state. A state is
+|  required iff it dominates X (every accepting path goes through it);
+|  the required states form a chain init = d0, d1, ..., dk. Every
+|  accepting path has a first arrival at d(j), before which it only
+|  visits states not dominated by d(j): pre(j). If, for i < m <= j, the
+|  only transition from pre(j) into d(m) is d(m-1) -c(m)-> d(m), then
+|  that arrival is preceded by the literal c(i+1) ... c(j), read from
+|  d(i) on. Dominators are found by the iterative algorithm of Cooper,
+|  Harvey & Kennedy ("A Simple, Fast Dominance Algorithm", 2001).
+|
+|  For the matcher, a literal also needs a bound on how far before it
+|  a match may start: the longest path from the initial state to d(i)
+|  within pre(j). If pre(j) has a cycle, there is no such bound and the
+|  literal is of no use.
+|
+|  Of the usable literals the longest one is kept (the closest to the
+|  match start on a tie). Also kept are the first bytes, those on which
+|  the initial state has a transition.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "auto.h"
+
+void  trace_begin ();
+void  trace_end ();
+
+#define LIVE(S)		((S) > 0 && dfa->state_attrib[S] != 'D')
+
+extern char  ab_map[];
+
+static automaton_t  *dfa;	/* the DFA being analyzed               */
+static int          *idom;	/* idom[s]: immediate dominator (0: ?)  */
+static int          *rpo;	/* rpo[s]: reverse postorder number     */
+static int          *tin;	/* dominator tree: 'a' dominates 'b'    */
+static int          *tout;	/* iff b's [tin, tout] is within a's    */
+static int          *pstart;	/* the predecessors of state 't' are    */
+static state_t      *preds;	/* preds[pstart[t] .. pstart[t+1]-1]    */
+
+static void  dominators ();
+static int   intersect ();
+static void  number_tree ();
+static int   into ();
+static int   max_before ();
+
+#define DOMINATES(A, B)	(tin[A] <= tin[B] && tout[B] <= tout[A])
+
+/*-------------------------------------------------------------------------
+|  void  find_prefilter (a, pf)
+|  automaton_t  *a;
+|  prefilter_t  *pf;
+|
+|  Find the prefilter 'pf' of the minimized DFA 'a'.
+`------------------------------------------------------------------------*/
+
+void  find_prefilter (a, pf)
+automaton_t  *a;
+prefilter_t  *pf;
+{
+    int      X = a->nstates + 1;
+    state_t  *chain;		/* the required states, init first */
+    int      lit[PREFILTER_MAX];
+    int      k, i, j, c, len, before;
+    state_t  s;
+
+    dfa = a;
+    pf->nlit = 0;
+    pf->before = 0;
+    pf->nfirst = 0;
+    s = dfa->init_state;
+    if (! LIVE(s))
+	return;			/* empty language */
+    for (j = 1; j <= dfa->nab; j++)
+	if (LIVE(dfa->mat[s][j]))
+	    pf->first[pf->nfirst++] = (unsigned char) ab_map[j];
+
+    trace_begin("prefilter", NULL, NULL);
+    idom = (int *) mem_alloc(MEM_CLASSES, (X + 1) * sizeof(int));
+    rpo = (int *) mem_alloc(MEM_CLASSES, (X + 1) * sizeof(int));
+    tin = (int *) mem_alloc(MEM_CLASSES, (X + 1) * sizeof(int));
+    tout = (int *) mem_alloc(MEM_CLASSES, (X + 1) * sizeof(int));
+    pstart = (int *) mem_alloc(MEM_CLASSES, (X + 2) * sizeof(int));
+    dominators();
+    number_tree();
+
+    /* the chain of required states */
+    for (k = 0, s = X; s != dfa->init_state; s = idom[s])
+	k++;
+    chain = (state_t *) mem_alloc(MEM_CLASSES, (k + 1) * sizeof(state_t));
+    for (i = k, s = X; i >= 0; i--, s = idom[s])
+	chain[i] = s;
+
+    /* the longest literal ending at every d(j) (chain[k] is X) */
+    for (j = 1; j < k; j++) {
+	for (i = j, len = 0; i > 0 && len < PREFILTER_MAX
+	     && (c = into(chain[i - 1], chain[i], chain[j])) != 0; i--)
+	    lit[len++] = c;
+	if (len == 0 || len < pf->nlit)
+	    continue;
+	if ((before = max_before(chain[i], chain[j])) < 0)
+	    continue;
+	if (len > pf->nlit || before < pf->before) {
+	    pf->nlit = len;
+	    pf->before = before;
+	    for (c = 0; c < len; c++)	/* 'lit[]' is backwards */
+		pf->lit[c] = (unsigned char) ab_map[lit[len - 1 - c]];
+	}
+    }
+
+    mem_free(chain);
+    mem_free(preds);
+    mem_free(pstart);
+    mem_free(tout);
+    mem_free(tin);
+    mem_free(rpo);
+    mem_free(idom);
+    trace_end("prefilter");
+}
+
+/*-------------------------------------------------------------------------
+|  static void  dominators ()
+|
+|  Number the live states (and the sink X = nstates + 1) in reverse
+|  postorder, make their predecessor lists 'preds[]', and compute their
+|  immediate dominators 'idom[]'.
+`------------------------------------------------------------------------*/
+
+static void  dominators ()
+{
+    int      n = dfa->nstates, X = n + 1;
+    state_t  *order;		/* the states in reverse postorder */
+    state_t  *stack;
+    int      *next;
+    int      sp, j, nord, i, changed, d;
+    state_t  s, t, p;
+
+    /* the predecessor lists (one entry per transition) */
+    for (s = 1; s <= n; s++)
+	if (LIVE(s)) {
+	    for (j = 1; j <= dfa->nab; j++)
+		if (LIVE(t = dfa->mat[s][j]))
+		    pstart[t + 1]++;
+	    if (dfa->state_attrib[s] == 'A')
+		pstart[X + 1]++;
+	}
+    for (t = 1; t <= X; t++)
+	pstart[t + 1] += pstart[t];
+    preds = (state_t *) mem_alloc(MEM_CLASSES,
+				  (pstart[X + 1] + 1) * sizeof(state_t));
+    for (s = 1; s <= n; s++)
+	if (LIVE(s)) {
+	    for (j = 1; j <= dfa->nab; j++)
+		if (LIVE(t = dfa->mat[s][j]))
+		    preds[pstart[t]++] = s;
+	    if (dfa->state_attrib[s] == 'A')
+		preds[pstart[X]++] = s;
+	}
+    for (t = X; t > 0; t--)
+	pstart[t] = pstart[t - 1];
+    pstart[0] = 0;
+
+    /* depth-first search from the initial state: postorder */
+    order = (state_t *) mem_alloc(MEM_CLASSES, (X + 1) * sizeof(state_t));
+    stack = (state_t *) mem_alloc(MEM_CLASSES, (X + 1) * sizeof(state_t));
+    next = (int *) mem_alloc(MEM_CLASSES, (X + 1) * sizeof(int));
+    nord = 0;
+    sp = 0;
+    stack[sp++] = dfa->init_state;
+    next[dfa->init_state] = 1;
+    rpo[dfa->init_state] = -1;		/* visited */
+    while (sp > 0) {
+	s = stack[sp - 1];
+	if (s == X || next[s] > dfa->nab + 1) {
+	    order[nord++] = s;
+	    sp--;
+	    continue;
+	}
+	j = next[s]++;
+	t = (j <= dfa->nab) ? dfa->mat[s][j]
+			    : (dfa->state_attrib[s] == 'A') ? X : 0;
+	if ((t == X || LIVE(t)) && rpo[t] == 0) {
+	    rpo[t] = -1;
+	    next[t] = 1;
+	    stack[sp++] = t;
+	}
+    }
+    for (i = 0; i < nord / 2; i++) {	/* reverse: init first */
+	s = order[i];
+	order[i] = order[nord - 1 - i];
+	order[nord - 1 - i] = s;
+    }
+    for (i = 0; i < nord; i++)
+	rpo[order[i]] = i;
+
+    /* Cooper, Harvey & Kennedy */
+    idom[dfa->init_state] = dfa->init_state;
+    do {
+	changed = FALSE;
+	for (i = 1; i < nord; i++) {
+	    t = order[i];
+	    d = 0;
+	    for (j = pstart[t]; j < pstart[t + 1]; j++) {
+		p = preds[j];
+		if (idom[p] == 0)
+		    continue;
+		d = (d == 0) ? p : intersect(p, d);
+	    }
+	    if (idom[t] != d) {
+		idom[t] = d;
+		changed = TRUE;
+	    }
+	}
+    } while (changed);
+
+    mem_free(order);
+    mem_free(stack);
+    mem_free(next);
+}
+
+/*-------------------------------------------------------------------------
+|  static int  intersect (a, b)
+|  int  a, b;
+|
+|  Return the nearest common dominator of 'a' and 'b' (both processed).
+`------------------------------------------------------------------------*/
+
+static int  intersect (a, b)
+int  a, b;
+{
+    while (a != b) {
+	while (rpo[a] > rpo[b])
+	    a = idom[a];
+	while (rpo[b] > rpo[a])
+	    b = idom[b];
+    }
+    return a;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  number_tree ()
+|
+|  Number the nodes of the dominator tree in depth-first order: 'tin[]'
+|  on entering a node, 'tout[]' after its subtree.
+`------------------------------------------------------------------------*/
+
+static void  number_tree ()
+{
+    int      X = dfa->nstates + 1;
+    int      *first, *sibling;	/* the children of every node */
+    state_t  *stack;
+    int      sp, clock = 0;
+    state_t  s, t;
+
+    first = (int *) mem_alloc(MEM_CLASSES, (X + 1) * sizeof(int));
+    sibling = (int *) mem_alloc(MEM_CLASSES, (X + 1) * sizeof(int));
+    stack = (state_t *) mem_alloc(MEM_CLASSES, (X + 1) * sizeof(state_t));
+    for (t = 1; t <= X; t++)
+	if (idom[t] != 0 && t != dfa->init_state) {
+	    sibling[t] = first[idom[t]];
+	    first[idom[t]] = t;
+	}
+
+    sp = 0;
+    stack[sp++] = dfa->init_state;
+    tin[dfa->init_state] = ++clock;
+    while (sp > 0) {
+	s = stack[sp - 1];
+	if ((t = first[s]) != 0) {	/* next child */
+	    first[s] = sibling[t];
+	    tin[t] = ++clock;
+	    stack[sp++] = t;
+	} else {
+	    tout[s] = clock;
+	    sp--;
+	}
+    }
+
+    mem_free(first);
+    mem_free(sibling);
+    mem_free(stack);
+}
+
+/*-------------------------------------------------------------------------
+|  static int  into (u, v, e)
+|  state_t  u, v, e;
+|
+|  If the only transition into 'v' from a state not dominated by 'e' is
+|  one from 'u', return its symbol, otherwise 0.
+`------------------------------------------------------------------------*/
+
+static int  into (u, v, e)
+state_t  u, v, e;
+{
+    int      j, n = 0;
+    state_t  p;
+
+    for (j = pstart[v]; j < pstart[v + 1]; j++) {
+	p = preds[j];
+	if (! DOMINATES(e, p) && (p != u || ++n > 1))
+	    return 0;
+    }
+    for (j = 1; j <= dfa->nab && n == 1; j++)
+	if (dfa->mat[u][j] == v)
+	    return j;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  max_before (d, e)
+|  state_t  d, e;
+|
+|  Return the length of the longest path from the initial state to 'd'
+|  through states not dominated by 'e', or -1 if these states have a
+|  cycle.
+`------------------------------------------------------------------------*/
+
+static int  max_before (d, e)
+state_t  d, e;
+{
+    int      n = dfa->nstates;
+    int      *indeg, *dist;
+    char     *pre;
+    state_t  *queue;
+    int      head, tail, j, npre, before;
+    state_t  s, t;
+
+    indeg = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    dist = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    pre = (char *) mem_alloc(MEM_CLASSES, n + 1);
+    queue = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+
+    for (s = 1, npre = 0; s <= n; s++)
+	if (LIVE(s) && ! DOMINATES(e, s)) {
+	    pre[s] = TRUE;
+	    npre++;
+	}
+    for (s = 1; s <= n; s++)
+	if (pre[s])
+	    for (j = 1; j <= dfa->nab; j++)
+		if (LIVE(t = dfa->mat[s][j]) && pre[t])
+		    indeg[t]++;
+
+    /* longest paths in topological order (Kahn) */
+    head = tail = 0;
+    for (s = 1; s <= n; s++)
+	if (pre[s] && indeg[s] == 0)
+	    queue[tail++] = s;
+    while (head < tail) {
+	s = queue[head++];
+	for (j = 1; j <= dfa->nab; j++)
+	    if (LIVE(t = dfa->mat[s][j]) && pre[t]) {
+		if (dist[s] + 1 > dist[t])
+		    dist[t] = dist[s] + 1;
+		if (--indeg[t] == 0)
+		    queue[tail++] = t;
+	    }
+    }
+    before = (tail < npre) ? -1 : dist[d];	/* -1: a cycle */
+
+    mem_free(indeg);
+    mem_free(dist);
+    mem_free(pre);
+    mem_free(queue);
+    return before;
+}
+
+/*-------------------------------------------------------------------------
+|  void  print_prefilter (pf)
+|  prefilter_t  *pf;
+|
+|  Print the prefilter 'pf' in human readable form.
+`------------------------------------------------------------------------*/
+
+void  print_prefilter (pf)
+prefilter_t  *pf;
+{
+    int  i;
+
+    printf("\nPrefilter: ");
+    if (pf->nlit > 0)
+	printf("\"%.*s\" (matches start at most %d bytes before it)",
+	       pf->nlit, (char *) pf->lit, pf->before);
+    else
+	printf("no literal");
+    printf("\nFirst bytes: ");
+    for (i = 0; i < pf->nfirst; i++)
+	printf("%s%c", i ? " " : "", pf->first[i]);
+    printf("\n");
+}
@@ -0,0 +1,428 @@
+/*-------------------------------------------------------------------------*\
+|  Module "reduce.c"
+|
+|  Reducing a minimized DFA beyond its minimal size, to a budget of
+|  states, by over-approximation (the -r option): the reduced DFA
+|  accepts every word the DFA does, and maybe more. As a prefilter in
+|  front of an exact matcher, it finds every match, and false positives
+|  the matcher then rejects.
+|
+|  States are merged as in grammar inference: the merged state has the
+|  transitions of both, and accepts if either does, and wherever both
+|  have a transition on the same symbol, their targets are merged too,
+|  so that the result stays deterministic (a congruence closure, on the
+|  Union-Find of module "ufind.c"). The language only ever grows.
+|
+|  Which states to merge is guided by a sample of the text to scan (the
+|  first RED_SAMPLE bytes of the -x file): every step tries merging
+|  every two of the RED_CAND states least visited while scanning the
+|  sample, and makes the merge adding the fewest matches on the sample
+|  (then, of these, merging the fewest states), until the budget is
+|  met.
+\*-------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "auto.h"
+
+#ifndef RED_SAMPLE
+#   define RED_SAMPLE	(1 << 16)	/* bytes of the sample scanned */
+#endif
+
+#ifndef RED_CAND
+#   define RED_CAND	8		/* states tried per step */
+#endif
+
+#define TAB(S, A)	tab[(S) * (nab + 1) + (A)]
+
+extern char     ab_map[];
+extern state_t  find ();
+extern void     Union ();
+
+void  feed_file ();
+void  trace_begin ();
+void  trace_end ();
+
+/*
+ |  The DFA being reduced: transitions of every state 'tab' (those of a
+ |  class at its root), accepting states 'acc', classes in Union-Find
+ |  form 'rep'; and a copy of all three to try a merge on
+ */
+static int      n, nab;
+static state_t  *tab, *rep, *ttab, *trep;
+static char     *acc, *tacc;
+
+static unsigned char  *sample;	/* the sample */
+static size_t         sample_len;
+static int            sym[256];	/* its bytes' symbols (0: none) */
+
+static size_t  add_sample ();
+static int     live ();
+static void    merge ();
+static size_t  scan_sample ();
+
+/*-------------------------------------------------------------------------
+|  int  reduce_dfa (dfa, red, budget, name, anchored)
+|  automaton_t  *dfa, *red;
+|  int          budget;
+|  char         *name;
+|  int          anchored;
+|
+|  Make 'red' a DFA of at most 'budget' states (if 'budget' > 0)
+|  accepting a superset of the language of the minimized (dead states
+|  marked) DFA 'dfa', with the fewest matches added on the sample text
+|  file 'name' (matched 'anchored' or not). Return the number of merges.
+`------------------------------------------------------------------------*/
+
+int  reduce_dfa (dfa, red, budget, name, anchored)
+automaton_t  *dfa, *red;
+int          budget;
+char         *name;
+int          anchored;
+{
+    size_t   *visit, base, best_m, m;
+    int      *cand;
+    int      nclass, best_n, k, nc, a, i, j, c, merges = 0;
+    state_t  q, s, t, best_p, best_q, *order, *num;
+
+    trace_begin("reduce", NULL, NULL);
+    n = dfa->nstates;
+    nab = dfa->nab;
+    tab = (state_t *) mem_alloc(MEM_CLASSES,
+				(size_t) (n + 1) * (nab + 1) * sizeof(state_t));
+    ttab = (state_t *) mem_alloc(MEM_CLASSES,
+				 (size_t) (n + 1) * (nab + 1) * sizeof(state_t));
+    rep = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    trep = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    acc = (char *) mem_alloc(MEM_CLASSES, n + 1);
+    tacc = (char *) mem_alloc(MEM_CLASSES, n + 1);
+    visit = (size_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(size_t));
+    cand = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    order = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    num = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+
+    /* the live states reached from the initial state, each a class (at
+       least the initial state, for a DFA of the empty language) */
+    k = 0;
+    order[k++] = dfa->init_state;
+    num[dfa->init_state] = k;
+    for (i = 0; i < k; i++) {
+	s = order[i];
+	acc[s] = (dfa->state_attrib[s] == 'A');
+	for (j = 1; j <= nab; j++) {
+	    t = dfa->mat[s][j];
+	    if (! live(dfa, t))
+		continue;
+	    TAB(s, j) = t;
+	    if (num[t] == 0) {
+		order[k++] = t;
+		num[t] = k;
+	    }
+	}
+    }
+    nclass = k;
+
+    /* the sample */
+    for (c = 0; c < 256; c++)
+	sym[c] = 0;
+    for (j = 1; j <= nab; j++)
+	sym[(unsigned char) ab_map[j]] = j;
+    sample = (unsigned char *) mem_alloc(MEM_IO, RED_SAMPLE);
+    sample_len = 0;
+    feed_file(name, add_sample, (void *) NULL);
+
+    base = scan_sample(tab, rep, acc, dfa->init_state, anchored,
+		       (size_t) -1, visit);
+    while (nclass > budget && budget > 0) {
+	/* the candidates: the RED_CAND least visited classes... */
+	nc = 0;
+	for (i = 0; i < k; i++) {
+	    if (rep[q = order[i]] > 0)
+		continue;
+	    for (c = nc < RED_CAND ? nc++ : RED_CAND; c > 0
+		 && visit[cand[c - 1]] > visit[q]; c--)
+		if (c < RED_CAND)
+		    cand[c] = cand[c - 1];
+	    if (c < RED_CAND)
+		cand[c] = q;
+	}
+
+	/* ... of which the two whose merge adds the fewest matches on
+	   the sample (stopping at one adding none, and merging no other
+	   states: none beats it) */
+	best_p = best_q = 0;
+	best_m = 0;
+	best_n = 0;
+	for (a = 0; a < nc && ! (best_m == base && best_n == nclass - 1); a++)
+	    for (c = a + 1; c < nc; c++) {
+		memcpy(ttab, tab,
+		       (size_t) (n + 1) * (nab + 1) * sizeof(state_t));
+		memcpy(trep, rep, (n + 1) * sizeof(state_t));
+		memcpy(tacc, acc, n + 1);
+		merge(ttab, trep, tacc, cand[a], cand[c]);
+		m = scan_sample(ttab, trep, tacc, dfa->init_state, anchored,
+				best_p == 0 ? (size_t) -1 : best_m,
+				(size_t *) NULL);
+		for (i = 0, j = 0; i < k; i++)
+		    if (trep[order[i]] <= 0)
+			j++;
+		if (best_p == 0 || m < best_m
+		    || (m == best_m && j > best_n)) {
+		    best_p = cand[a];
+		    best_q = cand[c];
+		    best_m = m;
+		    best_n = j;
+		}
+		if (best_m == base && best_n == nclass - 1)
+		    break;
+	    }
+	merge(tab, rep, acc, best_p, best_q);
+	base = scan_sample(tab, rep, acc, dfa->init_state, anchored,
+			   (size_t) -1, visit);
+	nclass = best_n;
+	merges++;
+    }
+
+    /* the reduced DFA: the classes, numbered breadth-first */
+    for (i = 0; i < k; i++)
+	num[order[i]] = 0;
+    red->nab = nab;
+    red->init_state = 1;
+    s = find(dfa->init_state, rep);
+    cand[0] = s;
+    num[s] = j = 1;
+    for (i = 0, c = 0; i < j; i++) {
+	s = cand[i];
+	for (q = 1; q <= nab; q++) {
+	    t = (TAB(s, q) > 0) ? find(TAB(s, q), rep) : 0;
+	    if (t > 0 && num[t] == 0) {
+		cand[j++] = t;
+		num[t] = j;
+	    }
+	    red->mat[i + 1][q] = (t > 0) ? num[t] : 0;
+	}
+	red->state_attrib[i + 1] = acc[s] ? 'A' : '\0';
+	if (acc[s])
+	    red->accept[c++] = i + 1;
+    }
+    red->accept[c] = 0;
+    red->nstates = j;
+    if (! live(dfa, dfa->init_state))
+	red->state_attrib[1] = 'D';	/* the empty language */
+
+    mem_free(sample);
+    mem_free(num);
+    mem_free(order);
+    mem_free(cand);
+    mem_free(visit);
+    mem_free(tacc);
+    mem_free(acc);
+    mem_free(trep);
+    mem_free(rep);
+    mem_free(ttab);
+    mem_free(tab);
+    trace_end("reduce");
+    return merges;
+}
+
+/*-------------------------------------------------------------------------
+|  int  reduce_check (dfa, red)
+|  automaton_t  *dfa, *red;
+|
+|  Return TRUE iff 'red' accepts every word the minimized DFA 'dfa'
+|  does: of no pair of states reached by the same word (one of each,
+|  breadth-first), is the first live and the second missing, or the
+|  first accepting and not the second.
+`------------------------------------------------------------------------*/
+
+int  reduce_check (dfa, red)
+automaton_t  *dfa, *red;
+{
+    int      n = dfa->nstates, m = red->nstates, ok = TRUE;
+    int      *seen, *queue, head = 0, tail = 0, j, x;
+    state_t  p, q, t;
+
+    seen = (int *) mem_alloc(MEM_CLASSES,
+			     (size_t) (n + 1) * (m + 1) * sizeof(int));
+    queue = (int *) mem_alloc(MEM_CLASSES,
+			      (size_t) (n + 1) * (m + 1) * sizeof(int));
+    if (live(dfa, dfa->init_state)) {
+	x = dfa->init_state * (m + 1) + (m > 0 ? red->init_state : 0);
+	seen[x] = TRUE;
+	queue[tail++] = x;
+    }
+    while (head < tail && ok) {
+	x = queue[head++];
+	p = x / (m + 1);
+	q = x % (m + 1);
+	if (q == 0 || (dfa->state_attrib[p] == 'A'
+		       && red->state_attrib[q] != 'A')) {
+	    ok = FALSE;
+	    break;
+	}
+	for (j = 1; j <= dfa->nab; j++) {
+	    if (! live(dfa, t = dfa->mat[p][j]))
+		continue;
+	    x = t * (m + 1) + red->mat[q][j];
+	    if (! seen[x]) {
+		seen[x] = TRUE;
+		queue[tail++] = x;
+	    }
+	}
+    }
+    mem_free(queue);
+    mem_free(seen);
+    return ok;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  live (dfa, s)
+|  automaton_t  *dfa;
+|  state_t      s;
+|
+|  Return TRUE iff 's' is a state of 'dfa', and not a dead one.
+`------------------------------------------------------------------------*/
+
+static int  live (dfa, s)
+automaton_t  *dfa;
+state_t      s;
+{
+    return s > 0 && dfa->state_attrib[s] != 'D';
+}
+
+/*-------------------------------------------------------------------------
+|  static size_t  add_sample (ctx, buf, len)
+|  void           *ctx;
+|  unsigned char  *buf;
+|  size_t         len;
+|
+|  feed_file() scanner: append the 'len' bytes at 'buf' to the sample,
+|  as long as there is room.
+`------------------------------------------------------------------------*/
+
+static size_t  add_sample (ctx, buf, len)
+void           *ctx;
+unsigned char  *buf;
+size_t         len;
+{
+    (void) ctx;				/* the sample is static */
+    if (len > RED_SAMPLE - sample_len)
+	len = RED_SAMPLE - sample_len;
+    memcpy(sample + sample_len, buf, len);
+    sample_len += len;
+    return 0;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  merge (tab, rep, acc, p, q)
+|  state_t  *tab, rep[];
+|  char     acc[];
+|  state_t  p, q;
+|
+|  Merge the classes of 'p' and 'q', and so on, for determinism, with
+|  the targets of their transitions on the same symbols.
+`------------------------------------------------------------------------*/
+
+static void  merge (tab, rep, acc, p, q)
+state_t  *tab, rep[];
+char     acc[];
+state_t  p, q;
+{
+    state_t  *stack, x, y, r, tx, ty;
+    int      top = 0, j;
+
+    stack = (state_t *) mem_alloc(MEM_CLASSES,
+				  2 * ((size_t) n * nab + 1) * sizeof(state_t));
+    stack[top++] = p;
+    stack[top++] = q;
+    while (top > 0) {
+	y = find(stack[--top], rep);
+	x = find(stack[--top], rep);
+	if (x == y)
+	    continue;
+	Union(x, y, rep);
+	r = find(x, rep);
+	acc[r] = acc[x] || acc[y];
+	for (j = 1; j <= nab; j++) {
+	    tx = TAB(x, j);
+	    ty = TAB(y, j);
+	    if (tx > 0 && ty > 0) {
+		stack[top++] = tx;
+		stack[top++] = ty;
+	    }
+	    TAB(r, j) = (tx > 0) ? tx : ty;
+	}
+    }
+    mem_free(stack);
+}
+
+/*-------------------------------------------------------------------------
+|  static size_t  scan_sample (tab, rep, acc, init, anchored, limit, visit)
+|  state_t  *tab, rep[];
+|  char     acc[];
+|  state_t  init;
+|  int      anchored;
+|  size_t   limit;
+|  size_t   visit[];
+|
+|  Scan the sample with the classes of 'rep' as a matcher does (see
+|  module "match.c"), following the set of the partial matches under
+|  way. Return the number of matches, or as soon as there are more
+|  than 'limit'; count in visit[r] (if 'visit' is not NULL) the times
+|  class 'r' was in the set.
+`------------------------------------------------------------------------*/
+
+static size_t  scan_sample (tab, rep, acc, init, anchored, limit, visit)
+state_t  *tab, rep[];
+char     acc[];
+state_t  init;
+int      anchored;
+size_t   limit;
+size_t   visit[];
+{
+    state_t  *set, *nset, *tmp, s, t;
+    int      *mark, len = 0, nlen, i, a, stamp = 0;
+    size_t   count = 0, pos;
+
+    set = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    nset = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    mark = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    if (visit != NULL)
+	memset(visit, 0, (n + 1) * sizeof(size_t));
+    init = find(init, rep);
+    if (anchored)
+	set[len++] = init;
+    for (pos = 0; pos < sample_len && count <= limit; pos++) {
+	stamp++;
+	nlen = 0;
+	a = sym[sample[pos]];
+	for (i = anchored ? 0 : -1; i < len; i++) {
+	    /* -1: a match may start here */
+	    s = (i < 0) ? init : set[i];
+	    if (a == 0 || (t = TAB(s, a)) <= 0)
+		continue;
+	    if (mark[t = find(t, rep)] != stamp) {
+		mark[t] = stamp;
+		nset[nlen++] = t;
+	    }
+	}
+	for (i = 0; visit != NULL && i < nlen; i++)
+	    visit[nset[i]]++;
+	for (i = 0; i < nlen; i++)
+	    if (acc[nset[i]]) {
+		count++;
+		break;
+	    }
+	tmp = set;
+	set = nset;
+	nset = tmp;
+	len = nlen;
+	if (anchored && len == 0)
+	    break;
+    }
+    mem_free(mark);
+    mem_free(nset);
+    mem_free(set);
+    return count;
+}
@@ -0,0 +1,220 @@
+/*-------------------------------------------------------------------------*\
+|  Module "reverse.c"
+|
+|  The minimal DFA of the reversed language of a DFA (the -i option):
+|  the DFA accepting the words of the DFA spelled backwards. Run from
+|  the end of a match towards the start of the text, it tells where
+|  the match begins (see match_back() in module "match.c").
+|
+|  The transitions of the (minimized) DFA are reversed, its accept
+|  states made the initial ones, and the result determinized by the
+|  subset construction, from the set of the accept states. By
+|  Brzozowski's theorem, the DFA so made is already minimal, as the
+|  states of the DFA reversed are all reachable (J. A. Brzozowski,
+|  "Canonical regular expressions and minimal state graphs for definite
+|  events", 1962): two sets of states reached by distinct words are
+|  distinct, and so are the words they accept. Applied twice, this
+|  minimizes the DFA itself - with which the -v option checks it.
+\*-------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "auto.h"
+
+#ifndef REV_HASH
+#   define REV_HASH	(4 * MAX_STATES + 1)	/* hash table of the sets */
+#endif
+
+void  trace_begin ();
+void  trace_end ();
+
+/*
+ |  The sets made states of the reversed DFA, one after the other in
+ |  'pool': the states of set 'S' are pool[set_at[S] .. set_at[S] +
+ |  set_len[S] - 1], sorted
+ */
+static state_t  *pool;
+static size_t   pool_len, pool_size;
+static size_t   *set_at;
+static int      *set_len;
+static int      *htab;
+static int      nsets;
+
+static int  add_set ();
+static int  cmp_states ();
+
+#define LIVE(S)	((S) > 0 && dfa->state_attrib[S] != 'D')
+
+/*-------------------------------------------------------------------------
+|  void  reverse_dfa (dfa, rev)
+|  automaton_t  *dfa, *rev;
+|
+|  Make 'rev' the minimal DFA of the reversed language of the (dead
+|  states marked) DFA 'dfa'. Abort if it needs more than MAX_STATES
+|  states.
+`------------------------------------------------------------------------*/
+
+void  reverse_dfa (dfa, rev)
+automaton_t  *dfa, *rev;
+{
+    int      n = dfa->nstates, nab = dfa->nab, nelems = n + 1;
+    int      *inv_start, *inv_src, *mark, *order;
+    int      S, a, i, k, len, nacc, stamp = 0;
+    state_t  p, t, *set;
+
+    trace_begin("reverse", NULL, NULL);
+    mark = (int *) mem_alloc(MEM_CLASSES, nelems * sizeof(int));
+    order = (int *) mem_alloc(MEM_CLASSES, nelems * sizeof(int));
+    set = (state_t *) mem_alloc(MEM_CLASSES, nelems * sizeof(state_t));
+
+    /* the live states reached from the initial state (mark[] = -1) */
+    k = 0;
+    if (LIVE(dfa->init_state)) {
+	order[k++] = dfa->init_state;
+	mark[dfa->init_state] = -1;
+    }
+    for (i = 0; i < k; i++)
+	for (a = 1; a <= nab; a++)
+	    if (LIVE(t = dfa->mat[order[i]][a]) && mark[t] == 0) {
+		order[k++] = t;
+		mark[t] = -1;
+	    }
+
+    /* their predecessors: those of 't' on 'a' are inv_src[inv_start[(a-1)
+       * nelems + t] .. inv_start[(a-1) * nelems + t + 1] - 1] */
+    inv_start = (int *) mem_alloc(MEM_INVERSE,
+				  ((size_t) nab * nelems + 1) * sizeof(int));
+    inv_src = (int *) mem_alloc(MEM_INVERSE,
+				((size_t) nab * k + 1) * sizeof(int));
+    for (i = 0; i < k; i++)
+	for (a = 1; a <= nab; a++)
+	    if (LIVE(t = dfa->mat[order[i]][a]))
+		inv_start[(a - 1) * nelems + t + 1]++;
+    for (i = 1; i <= nab * nelems; i++)
+	inv_start[i] += inv_start[i - 1];
+    for (i = 0; i < k; i++)
+	for (a = 1; a <= nab; a++)
+	    if (LIVE(t = dfa->mat[p = order[i]][a]))
+		inv_src[inv_start[(a - 1) * nelems + t]++] = p;
+    for (i = nab * nelems; i > 0; i--)
+	inv_start[i] = inv_start[i - 1];
+    inv_start[0] = 0;
+
+    pool_size = 1024;
+    pool = (state_t *) mem_alloc(MEM_CLASSES, pool_size * sizeof(state_t));
+    pool_len = 0;
+    set_at = (size_t *) mem_alloc(MEM_CLASSES,
+				  (MAX_STATES + 1) * sizeof(size_t));
+    set_len = (int *) mem_alloc(MEM_CLASSES, (MAX_STATES + 1) * sizeof(int));
+    htab = (int *) mem_alloc(MEM_CLASSES, REV_HASH * sizeof(int));
+    nsets = 0;
+
+    /* the subset construction, from the accept states (none: the empty
+       language, of a single state, dead) */
+    for (p = 1, len = 0; p <= n; p++)
+	if (mark[p] != 0 && dfa->state_attrib[p] == 'A')
+	    set[len++] = p;
+    add_set(set, len);
+    rev->nab = nab;
+    rev->init_state = 1;
+    for (S = 1, nacc = 0; S <= nsets; S++) {
+	for (a = 1; a <= nab; a++) {
+	    stamp++;
+	    len = 0;
+	    for (i = 0; i < set_len[S]; i++) {
+		t = pool[set_at[S] + i];
+		for (k = inv_start[(a - 1) * nelems + t];
+		     k < inv_start[(a - 1) * nelems + t + 1]; k++)
+		    if (mark[p = inv_src[k]] != stamp) {
+			mark[p] = stamp;
+			set[len++] = p;
+		    }
+	    }
+	    if (len == 0) {
+		rev->mat[S][a] = 0;
+		continue;
+	    }
+	    qsort((char *) set, len, sizeof(state_t), cmp_states);
+	    rev->mat[S][a] = add_set(set, len);
+	}
+	rev->state_attrib[S] = '\0';
+	for (i = 0; i < set_len[S]; i++)
+	    if (pool[set_at[S] + i] == dfa->init_state)
+		rev->state_attrib[S] = 'A';
+	if (rev->state_attrib[S] == 'A')
+	    rev->accept[nacc++] = S;
+    }
+    rev->accept[nacc] = 0;
+    rev->nstates = nsets;
+    if (set_len[1] == 0)
+	rev->state_attrib[1] = 'D';
+
+    mem_free(htab);
+    mem_free(set_len);
+    mem_free(set_at);
+    mem_free(pool);
+    mem_free(inv_src);
+    mem_free(inv_start);
+    mem_free(set);
+    mem_free(order);
+    mem_free(mark);
+    trace_end("reverse");
+}
+
+/*-------------------------------------------------------------------------
+|  static int  add_set (set, len)
+|  state_t  set[];
+|  int      len;
+|
+|  Return the state of the reversed DFA of the sorted set of states
+|  'set[0 .. len-1]', making it a new one if the set wasn't seen before.
+`------------------------------------------------------------------------*/
+
+static int  add_set (set, len)
+state_t  set[];
+int      len;
+{
+    unsigned  h = 2166136261u;
+    state_t   *npool;
+    int       i, S;
+
+    for (i = 0; i < len; i++)
+	h = (h ^ (unsigned) set[i]) * 16777619u;
+    for (h %= REV_HASH; (S = htab[h]) != 0; h = (h + 1) % REV_HASH)
+	if (set_len[S] == len
+	    && memcmp(&pool[set_at[S]], set, len * sizeof(state_t)) == 0)
+	    return S;
+
+    if (nsets == MAX_STATES)
+	Abort(("The reversed DFA needs more than %d states, recompile with \"-DMAX_STATES=...\"\n",
+	       MAX_STATES));
+    if (pool_len + len > pool_size) {
+	npool = (state_t *) mem_alloc(MEM_CLASSES,
+				      2 * (pool_size + len) * sizeof(state_t));
+	memcpy(npool, pool, pool_len * sizeof(state_t));
+	mem_free(pool);
+	pool = npool;
+	pool_size = 2 * (pool_size + len);
+    }
+    S = ++nsets;
+    htab[h] = S;
+    set_at[S] = pool_len;
+    set_len[S] = len;
+    memcpy(&pool[pool_len], set, len * sizeof(state_t));
+    pool_len += len;
+    return S;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  cmp_states (a, b)
+|  state_t  *a, *b;
+|
+|  qsort() comparison of two states.
+`------------------------------------------------------------------------*/
+
+static int  cmp_states (a, b)
+state_t  *a, *b;
+{
+    return *a - *b;
+}
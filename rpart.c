@@ -0,0 +1,152 @@
+/*-------------------------------------------------------------------------*\
+|  Module "rpart.c"
+|
+|  Refinable partition of the elements 0 .. N-1
+|  (after A. Valmari & P. Lehtinen, "Efficient minimization of DFAs
+|   with partial transition functions", STACS 2008).
+|
+|  The elements are kept in 'elems[]' grouped by set: set 's' occupies
+|  the slice elems[first[s]] .. elems[end[s]-1].  loc[e] is the position
+|  of element 'e' within 'elems[]' and sidx[e] the set it belongs to.
+|
+|  Splitting is done in two stages:
+|
+|      1. rp_mark() moves an element to the front of its set, into the
+|         "marked" part elems[first[s]] .. elems[mid[s]-1].
+|
+|      2. rp_split() makes the marked part of every touched set a new set
+|         (unless the whole set was marked, in which case nothing
+|         changes) and clears all marks.
+|
+|  Both stages take time proportional to the number of marked elements,
+|  never to the size of the sets involved, which is what makes the
+|  Hopcroft style O(m log n) engines possible.
+\*-------------------------------------------------------------------------*/
+
+#include "auto.h"
+
+/*-------------------------------------------------------------------------
+|  void  rp_init (P, n)
+|  rpart_t  *P;
+|  int      n;
+|
+|  Initialize 'P' as a partition of 0 .. n-1 consisting of a single set.
+|  (The empty partition has no sets).
+`------------------------------------------------------------------------*/
+
+void  rp_init (P, n)
+rpart_t  *P;
+int      n;
+{
+    int  e;
+
+    P->n = n;
+    P->elems = (int *) mem_alloc(MEM_CLASSES, n * sizeof(int));
+    P->loc = (int *) mem_alloc(MEM_CLASSES, n * sizeof(int));
+    P->sidx = (int *) mem_alloc(MEM_CLASSES, n * sizeof(int));
+    P->first = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    P->end = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    P->mid = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    P->touched = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    P->split_from = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    P->ntouched = 0;
+
+    for (e = 0; e < n; e++) {
+	P->elems[e] = P->loc[e] = e;
+	P->sidx[e] = 0;
+    }
+    P->nsets = (n > 0) ? 1 : 0;
+    P->first[0] = P->mid[0] = 0;
+    P->end[0] = n;
+    P->split_from[0] = 0;
+}
+
+/*-------------------------------------------------------------------------
+|  void  rp_free (P)
+|  rpart_t  *P;
+|
+|  Release the arrays of the partition 'P'.
+`------------------------------------------------------------------------*/
+
+void  rp_free (P)
+rpart_t  *P;
+{
+    mem_free(P->elems);
+    mem_free(P->loc);
+    mem_free(P->sidx);
+    mem_free(P->first);
+    mem_free(P->end);
+    mem_free(P->mid);
+    mem_free(P->touched);
+    mem_free(P->split_from);
+}
+
+/*-------------------------------------------------------------------------
+|  void  rp_mark (P, e)
+|  rpart_t  *P;
+|  int      e;
+|
+|  Mark the element 'e' (marking an already marked element is harmless).
+`------------------------------------------------------------------------*/
+
+void  rp_mark (P, e)
+rpart_t  *P;
+int      e;
+{
+    int  s = P->sidx[e];
+    int  i = P->loc[e];
+    int  j = P->mid[s];
+
+    if (i < j)                  /* already marked */
+	return;
+
+    /* swap 'e' with the first unmarked element of its set */
+    P->elems[i] = P->elems[j];
+    P->loc[P->elems[i]] = i;
+    P->elems[j] = e;
+    P->loc[e] = j;
+
+    if (P->mid[s]++ == P->first[s])	/* first mark in this set */
+	P->touched[P->ntouched++] = s;
+}
+
+/*-------------------------------------------------------------------------
+|  int  rp_split (P, new_sets)
+|  rpart_t  *P;
+|  int      new_sets[];
+|
+|  Split every touched set into its marked and unmarked parts.
+|  The marked part becomes a new set; the indices of the sets created
+|  are stored in 'new_sets[]' (if not NULL) and their number is returned.
+|  The set a new set 'ns' was split from is recorded in split_from[ns].
+`------------------------------------------------------------------------*/
+
+int  rp_split (P, new_sets)
+rpart_t  *P;
+int      new_sets[];
+{
+    int  s, ns, i, count = 0;
+
+    while (P->ntouched > 0) {
+	s = P->touched[--P->ntouched];
+
+	if (P->mid[s] == P->end[s]) {	/* whole set marked: no split */
+	    P->mid[s] = P->first[s];
+	    continue;
+	}
+
+	ns = P->nsets++;
+	P->first[ns] = P->mid[ns] = P->first[s];
+	P->end[ns] = P->mid[s];
+	P->first[s] = P->mid[s];
+
+	for (i = P->first[ns]; i < P->end[ns]; i++)
+	    P->sidx[P->elems[i]] = ns;
+
+	P->split_from[ns] = s;
+	if (new_sets != NULL)
+	    new_sets[count] = ns;
+	count++;
+    }
+    return count;
+}
@@ -0,0 +1,589 @@
+/*-------------------------------------------------------------------------*\
+|  Module "scan.c"
+|
+|  Input scanning: loading an input file into memory and breaking it
+|  into white-space separated tokens (see module "inout.c" for the DFA
+|  input format).
+|
+|  The input is either mmap()ed (regular files) or read into a tracked
+|  buffer (pipes, terminals...). Tokens are then scanned straight out
+|  of memory, without the stdio/scanf() per-token overhead.
+|
+|  The bulk of a DFA description is its transition matrix: one long
+|  sequence of NSTATES * NAB integers. scan_matrix() parses it with
+|  several threads:
+|
+|      1. The rest of the input is cut into equal chunks, each boundary
+|         moved forward to the next white space so no token is split.
+|
+|      2. Every thread counts the tokens of its chunk.
+|
+|      3. A prefix sum over the counts gives the index of the first
+|         token of every chunk, i.e. the matrix entry it belongs to.
+|
+|      4. Every thread parses its chunk, range-checks the states and
+|         stores them directly into their place in the matrix.
+|
+|  Errors found by the threads are reported for the earliest offending
+|  token, exactly as a sequential scan would have.
+|
+|  Compressed inputs (gzip, zstd) are recognized by their magic number
+|  and decompressed by a thread of module "decomp.c" into a ring of
+|  buffers, which are scanned one after the other while the next ones
+|  are being filled; scan_matrix() then parses one buffer at a time.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include "auto.h"
+
+#ifndef PAR_MIN_BYTES
+#   define PAR_MIN_BYTES  (1L << 20)	/* smaller matrices: one thread */
+#endif
+
+#define MAX_THREADS	64
+
+#define IS_WHITE(C)	((C) == ' ' || (C) == '\t' || (C) == '\n' || \
+			 (C) == '\r' || (C) == '\f' || (C) == '\v')
+
+void  trace_begin ();
+void  trace_end ();
+
+static int  scan_threads = 1;	/* threads used by scan_matrix() */
+
+/*
+ |  A chunk of the matrix section, and what its thread found in it
+ */
+typedef struct {
+	char		*begin, *end;	/* the chunk                       */
+	long		ntokens;	/* pass 1: tokens in chunk         */
+	long		first;		/* index of its first token        */
+	int		last;		/* TRUE for the last chunk         */
+	automaton_t	*dfa;
+	long		nvals;		/* tokens that belong to matrix    */
+	long		next;		/* index after its last token      */
+	char		*stop;		/* where the matrix ended, if here */
+	long		err_index;	/* first bad token (-1: none)      */
+	int		err_value;	/* its value, if out of range      */
+	int		err_kind;	/* ERR_xxx                         */
+} chunk_t;
+
+#define ERR_NONE	0
+#define ERR_SYNTAX	1	/* not an integer       */
+#define ERR_RANGE	2	/* state out of range   */
+
+static void  *count_chunk ();
+static void  *parse_chunk ();
+static int   get_int ();
+static int   parse_part ();
+static void  start_decomp ();
+static int   refill ();
+
+extern int       decomp_format ();
+extern decomp_t  *decomp_start ();
+extern char      *decomp_next ();
+extern void      decomp_end ();
+
+/*-------------------------------------------------------------------------
+|  void  scan_set_threads (n)
+|  int  n;
+|
+|  Use up to 'n' threads for parsing transition matrices.
+`------------------------------------------------------------------------*/
+
+void  scan_set_threads (n)
+int  n;
+{
+    scan_threads = (n < 1) ? 1 : (n > MAX_THREADS) ? MAX_THREADS : n;
+}
+
+/*-------------------------------------------------------------------------
+|  void  scan_open (sc, fd)
+|  scan_t  *sc;
+|  int     fd;
+|
+|  Make the rest of the file open on 'fd' available for scanning.
+`------------------------------------------------------------------------*/
+
+void  scan_open (sc, fd)
+scan_t  *sc;
+int     fd;
+{
+    struct stat  st;
+    off_t        pos;
+    size_t       size, len;
+    ssize_t      n;
+    char         *nbuf;
+
+    sc->mapped = FALSE;
+    sc->dc = NULL;
+    pos = lseek(fd, (off_t) 0, SEEK_CUR);
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && pos >= 0
+	&& st.st_size > pos) {
+	sc->maplen = (size_t) st.st_size;
+	sc->buf = (char *) mmap(NULL, sc->maplen, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (sc->buf != (char *) MAP_FAILED) {
+	    sc->mapped = TRUE;
+	    sc->p = sc->buf + pos;
+	    sc->end = sc->buf + sc->maplen;
+	    start_decomp(sc, sc->p, (size_t) (sc->end - sc->p), -1);
+	    return;
+	}
+    }
+
+    /* not mappable: read it all into a (growing) buffer */
+    size = 1 << 16;
+    len = 0;
+    sc->buf = (char *) mem_alloc(MEM_IO, size);
+    while (len < 4 && (n = read(fd, sc->buf + len, size - len)) > 0)
+	len += n;
+    if (decomp_format(sc->buf, len) != DECOMP_NONE) {
+	/* compressed: stream the rest of 'fd' through the decompressor */
+	start_decomp(sc, sc->buf, len, fd);
+	return;
+    }
+    while ((n = read(fd, sc->buf + len, size - len)) > 0) {
+	len += n;
+	if (len == size) {
+	    nbuf = (char *) mem_alloc(MEM_IO, 2 * size);
+	    memcpy(nbuf, sc->buf, len);
+	    mem_free(sc->buf);
+	    sc->buf = nbuf;
+	    size *= 2;
+	}
+    }
+    sc->p = sc->buf;
+    sc->end = sc->buf + len;
+}
+
+/*-------------------------------------------------------------------------
+|  void  scan_buffer (sc, buf, len)
+|  scan_t  *sc;
+|  char    *buf;
+|  size_t  len;
+|
+|  Scan the 'len' bytes at 'buf', a block obtained from mem_alloc()
+|  which 'sc' takes over (it is released by scan_close()).
+`------------------------------------------------------------------------*/
+
+void  scan_buffer (sc, buf, len)
+scan_t  *sc;
+char    *buf;
+size_t  len;
+{
+    sc->mapped = FALSE;
+    sc->dc = NULL;
+    sc->buf = sc->p = buf;
+    sc->end = buf + len;
+    start_decomp(sc, buf, len, -1);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  start_decomp (sc, src, len, fd)
+|  scan_t  *sc;
+|  char    *src;
+|  size_t  len;
+|  int     fd;
+|
+|  If the input - the 'len' bytes at 'src', followed by the rest of 'fd'
+|  if fd >= 0 - is compressed, have 'sc' scan its decompression: the
+|  buffers come in with refill().
+`------------------------------------------------------------------------*/
+
+static void  start_decomp (sc, src, len, fd)
+scan_t  *sc;
+char    *src;
+size_t  len;
+int     fd;
+{
+    int  format;
+
+    if ((format = decomp_format(src, len)) == DECOMP_NONE)
+	return;
+    sc->dc = decomp_start(format, src, len, fd);
+    sc->eof = FALSE;
+    sc->p = sc->end = sc->lim = sc->carry;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  refill (sc)
+|  scan_t  *sc;
+|
+|  Move on to the next buffer of a compressed input, carrying the
+|  unscanned rest of the current one (a token cut by the buffer end)
+|  along in front of it. Return FALSE if there is none.
+`------------------------------------------------------------------------*/
+
+static int  refill (sc)
+scan_t  *sc;
+{
+    size_t  clen, n;
+    char    *nb;
+
+    if (sc->dc == NULL || sc->eof)
+	return FALSE;
+
+    if ((clen = sc->lim - sc->p) > SCAN_SLACK) {
+	sc->carry[0] = '~';		/* no valid token is that long */
+	clen = 1;
+    } else
+	memmove(sc->carry, sc->p, clen);
+
+    if ((nb = decomp_next(sc->dc, &n)) == NULL) {
+	sc->eof = TRUE;
+	sc->p = sc->carry;
+	sc->end = sc->lim = sc->carry + clen;
+	return TRUE;
+    }
+    sc->p = nb - clen;
+    memcpy(sc->p, sc->carry, clen);
+    sc->lim = nb + n;
+    for (sc->end = sc->lim; sc->end > sc->p && ! IS_WHITE(sc->end[-1]); )
+	sc->end--;
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+|  void  scan_close (sc)
+|  scan_t  *sc;
+|
+|  Release the input of 'sc'.
+`------------------------------------------------------------------------*/
+
+void  scan_close (sc)
+scan_t  *sc;
+{
+    if (sc->dc != NULL)
+	decomp_end(sc->dc);
+    sc->dc = NULL;
+    if (sc->mapped)
+	munmap(sc->buf, sc->maplen);
+    else
+	mem_free(sc->buf);
+    sc->buf = sc->p = sc->end = NULL;
+}
+
+/*-------------------------------------------------------------------------
+|  int  scan_int (sc, val)
+|  scan_t  *sc;
+|  int     *val;
+|
+|  Scan the next token as a (decimal, optionally signed) integer into
+|  '*val'. Return TRUE on success, FALSE if the token is not an
+|  integer, and EOF at the end of the input.
+`------------------------------------------------------------------------*/
+
+int  scan_int (sc, val)
+scan_t  *sc;
+int     *val;
+{
+    int  r;
+
+    while ((r = get_int(&sc->p, sc->end, val)) == EOF && refill(sc))
+	;
+    return r;
+}
+
+/*-------------------------------------------------------------------------
+|  int  scan_sym (sc, c)
+|  scan_t  *sc;
+|  char    *c;
+|
+|  Scan the next non-white character into '*c' (like scanf("%1s")).
+|  Return TRUE, or EOF at the end of the input.
+`------------------------------------------------------------------------*/
+
+int  scan_sym (sc, c)
+scan_t  *sc;
+char    *c;
+{
+    do {
+	while (sc->p < sc->end && IS_WHITE(*sc->p))
+	    sc->p++;
+    } while (sc->p == sc->end && refill(sc));
+    if (sc->p == sc->end)
+	return EOF;
+    *c = *sc->p++;
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+|  int  scan_word (sc, w, len)
+|  scan_t  *sc;
+|  char    **w;
+|  int     *len;
+|
+|  Scan the next token as a word: point '*w' to it (in the input, so it
+|  is only valid until the next scan) and set '*len' to its length.
+|  Return TRUE, or EOF at the end of the input.
+`------------------------------------------------------------------------*/
+
+int  scan_word (sc, w, len)
+scan_t  *sc;
+char    **w;
+int     *len;
+{
+    char  *q;
+
+    do {
+	while (sc->p < sc->end && IS_WHITE(*sc->p))
+	    sc->p++;
+    } while (sc->p == sc->end && refill(sc));
+    if (sc->p == sc->end)
+	return EOF;
+    for (q = sc->p; q < sc->end && ! IS_WHITE(*q); q++)
+	;
+    *w = sc->p;
+    *len = (int) (q - sc->p);
+    sc->p = q;
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  get_int (pp, end, val)
+|  char  **pp, *end;
+|  int   *val;
+|
+|  Scan an integer token from '*pp' (not beyond 'end') into '*val',
+|  advancing '*pp' past the token. Returns as scan_int().
+`------------------------------------------------------------------------*/
+
+static int  get_int (pp, end, val)
+char  **pp, *end;
+int   *val;
+{
+    char  *p = *pp;
+    int   neg = FALSE, v = 0, digits = 0;
+
+    while (p < end && IS_WHITE(*p))
+	p++;
+    if (p == end) {
+	*pp = p;
+	return EOF;
+    }
+    if (*p == '-' || *p == '+')
+	neg = (*p++ == '-');
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+	v = v * 10 + (*p - '0');
+
+    if (digits == 0 || (p < end && ! IS_WHITE(*p))) {
+	while (p < end && ! IS_WHITE(*p))	/* skip the bad token */
+	    p++;
+	*pp = p;
+	return FALSE;
+    }
+    *pp = p;
+    *val = neg ? -v : v;
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+|  void  scan_matrix (sc, dfa)
+|  scan_t       *sc;
+|  automaton_t  *dfa;
+|
+|  Scan the dfa->nstates * dfa->nab transitions of 'dfa' (rows 1 .. n,
+|  columns 1 .. nab; -1 i.e. no transition is stored as 0) and leave
+|  'sc' positioned right after them. Aborts on bad input.
+`------------------------------------------------------------------------*/
+
+void  scan_matrix (sc, dfa)
+scan_t       *sc;
+automaton_t  *dfa;
+{
+    long  g = 0;	/* matrix index of the next token */
+
+    while (! parse_part(sc, dfa, &g))
+	refill(sc);
+}
+
+/*-------------------------------------------------------------------------
+|  static int  parse_part (sc, dfa, g)
+|  scan_t       *sc;
+|  automaton_t  *dfa;
+|  long         *g;
+|
+|  Parse the matrix tokens in the rest of the current buffer of 'sc'
+|  (the whole input, unless compressed), the first of them being entry
+|  '*g' of the matrix. Return TRUE, with 'sc' positioned after the
+|  matrix, if it was completed; otherwise FALSE with '*g' advanced past
+|  the buffer. Aborts on bad input.
+`------------------------------------------------------------------------*/
+
+static int  parse_part (sc, dfa, g)
+scan_t       *sc;
+automaton_t  *dfa;
+long         *g;
+{
+    chunk_t    chunk[MAX_THREADS];
+    pthread_t  tid[MAX_THREADS];
+    int        started[MAX_THREADS];	/* tid[i] runs chunk i */
+    long       nvals = (long) dfa->nstates * dfa->nab;
+    long       total;
+    size_t     size = sc->end - sc->p;
+    int        nchunks, i, err_kind = ERR_NONE, err_value = 0;
+    int        last = (sc->dc == NULL || sc->eof);
+    char       *p;
+
+    nchunks = (size < PAR_MIN_BYTES) ? 1 : scan_threads;
+
+    /* cut the rest of the input into chunks at white space */
+    p = sc->p;
+    for (i = 0; i < nchunks; i++) {
+	chunk[i].begin = p;
+	p = (i == nchunks - 1) ? sc->end : sc->p + size / nchunks * (i + 1);
+	if (p < chunk[i].begin)
+	    p = chunk[i].begin;
+	while (p < sc->end && ! IS_WHITE(*p))
+	    p++;
+	chunk[i].end = p;
+	chunk[i].last = last && (i == nchunks - 1);
+	chunk[i].dfa = dfa;
+	chunk[i].nvals = nvals;
+	chunk[i].ntokens = 0;
+    }
+
+    /* pass 1: count the tokens of every chunk */
+    if (nchunks > 1) {
+	for (i = 0; i < nchunks; i++)	/* a chunk without a thread: here */
+	    if (! (started[i] = (pthread_create(&tid[i], NULL, count_chunk,
+						(void *) &chunk[i]) == 0)))
+		count_chunk((void *) &chunk[i]);
+	for (i = 0; i < nchunks; i++)
+	    if (started[i])
+		pthread_join(tid[i], NULL);
+    }
+
+    /* prefix sum: the index of the first token of every chunk */
+    total = *g;
+    for (i = 0; i < nchunks; i++) {
+	chunk[i].first = total;
+	total += chunk[i].ntokens;
+    }
+
+    /* pass 2: parse & store */
+    if (nchunks > 1) {
+	for (i = 0; i < nchunks; i++)
+	    if (! (started[i] = (pthread_create(&tid[i], NULL, parse_chunk,
+						(void *) &chunk[i]) == 0)))
+		parse_chunk((void *) &chunk[i]);
+	for (i = 0; i < nchunks; i++)
+	    if (started[i])
+		pthread_join(tid[i], NULL);
+    } else
+	parse_chunk((void *) &chunk[0]);
+
+    for (i = 0; i < nchunks; i++)
+	if (chunk[i].err_index >= 0) {
+	    err_kind = chunk[i].err_kind;
+	    err_value = chunk[i].err_value;
+	    break;
+	}
+
+    if (err_kind == ERR_RANGE)
+	Abort(("State (%d) - out of range\n", err_value));
+    if (err_kind == ERR_SYNTAX)
+	Abort(("Bad input while reading states\n"));
+
+    /* position 'sc' right after the matrix, if it ended here */
+    for (i = 0; i < nchunks; i++)
+	if (chunk[i].stop != NULL) {
+	    sc->p = chunk[i].stop;
+	    return TRUE;
+	}
+    *g = chunk[nchunks - 1].next;
+    sc->p = sc->end;
+    return FALSE;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  *count_chunk (arg)
+|  void  *arg;
+|
+|  Thread body of pass 1: count the tokens of the chunk 'arg'.
+`------------------------------------------------------------------------*/
+
+static void  *count_chunk (arg)
+void  *arg;
+{
+    chunk_t  *c = (chunk_t *) arg;
+    char     *p;
+    long     n = 0;
+    int      white = TRUE;
+
+    trace_begin("count_chunk", NULL, NULL);
+    for (p = c->begin; p < c->end; p++) {
+	if (IS_WHITE(*p))
+	    white = TRUE;
+	else if (white) {
+	    white = FALSE;
+	    n++;
+	}
+    }
+    c->ntokens = n;
+    trace_end("count_chunk");
+    return NULL;
+}
+
+/*-------------------------------------------------------------------------
+|  static void  *parse_chunk (arg)
+|  void  *arg;
+|
+|  Thread body of pass 2: parse the tokens of the chunk 'arg' that
+|  belong to the matrix and store them into it. Record the first bad
+|  token in the chunk, if any - running out of tokens in the last
+|  chunk counts as one. The chunk in which the matrix is completed
+|  records where it ended.
+`------------------------------------------------------------------------*/
+
+static void  *parse_chunk (arg)
+void  *arg;
+{
+    chunk_t      *c = (chunk_t *) arg;
+    automaton_t  *dfa = c->dfa;
+    int          nab = dfa->nab, nstates = dfa->nstates;
+    char         *p = c->begin;
+    long         g = c->first;		/* matrix index of the token */
+    int          s, r, row, col;
+
+    trace_begin("parse_chunk", NULL, NULL);
+    c->err_index = -1;
+    c->err_kind = ERR_NONE;
+    c->stop = NULL;
+    row = (int) (g / nab) + 1;
+    col = (int) (g % nab) + 1;
+
+    for (; g < c->nvals; g++) {
+	if ((r = get_int(&p, c->end, &s)) == EOF) {
+	    if (c->last) {              /* input ended inside the matrix */
+		c->err_index = g;
+		c->err_kind = ERR_SYNTAX;
+	    }
+	    break;
+	}
+	if (r == FALSE || s >= nstates) {
+	    c->err_index = g;
+	    c->err_kind = (r == FALSE) ? ERR_SYNTAX : ERR_RANGE;
+	    c->err_value = s;
+	    break;
+	}
+	dfa->mat[row][col] = (s >= 0) ? s + 1 : 0;
+	if (++col > nab) {
+	    col = 1;
+	    row++;
+	}
+    }
+    c->next = g;
+    if (g == c->nvals && c->err_index < 0)
+	c->stop = p;
+    trace_end("parse_chunk");
+    return NULL;
+}
@@ -0,0 +1,572 @@
+/*-------------------------------------------------------------------------*\
+|  Module "scc.c"
+|
+|  The "scc" minimization engine, for nearly acyclic DFAs (mostly
+|  acyclic, with a few small loops).
+|
+|  The strongly connected components (SCCs) of the transition graph are
+|  found by Tarjan's algorithm, which completes them in reverse
+|  topological order: every SCC after all the SCCs it leads to. They are
+|  processed in that order, so that when an SCC is reached the classes
+|  of all the states outside it that it leads to are final:
+|
+|    - A trivial SCC (one state, no self loop) is classified as in the
+|      "acyclic" engine: its signature - acceptance and the classes of
+|      its successors - is looked up in a hash table of the classes found
+|      so far, and makes a new class if it is not there.
+|
+|    - A cyclic SCC is first minimized locally by Moore-style refinement
+|      of its states alone, the successors outside it being fixed.
+|      Its states may still be equivalent to states of earlier SCCs,
+|      but then all of them are (every state of the SCC reaches every
+|      other): so one block of the SCC is matched against the earlier
+|      classes that could be its equivalent, the match being extended
+|      along the transitions of the SCC to all its blocks. The blocks
+|      make new classes if no match succeeds.
+|      Candidates are found through a successor outside the SCC (the
+|      earlier classes going to the same class on the same symbol). An
+|      SCC without such successors ("closed") can only match an earlier
+|      closed SCC of the same size, which are kept aside for that.
+|
+|  The work is linear but for the local refinement and matching, which
+|  are quadratic in the size of the SCCs only: near-linear when these
+|  are small.
+\*-------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include "auto.h"
+
+void  trace_begin ();
+void  trace_end ();
+
+/*
+ |  The DFA and the state of the classification
+ */
+static automaton_t  *sdfa;
+static int      nab;
+static int      *comp;		/* comp[s]: SCC of state s               */
+static state_t  *cls;		/* cls[s]: class of state s (0: not yet) */
+static int      *lab;		/* lab[s]: block of s in its SCC         */
+static int      cur_scc;	/* SCC being minimized locally           */
+static state_t  *brep;		/* brep[b]: a state of block b           */
+static int      *queue;		/* blocks to match (try_map())           */
+
+/*
+ |  The classes found so far: 1 .. nclasses.
+ |  csig[(X-1) * nab + a-1]: class of the successors of X on 'a' (0: none)
+ */
+static int      nclasses;
+static char     *cacc;		/* cacc[X]: TRUE iff X accepts           */
+static state_t  *csig;
+static int      *htab;		/* hash table of the classes (0: empty)  */
+static unsigned hmask;
+static int      *phead;		/* phead[Y]: list of classes going to Y  */
+static int      *pnext, *pcls;	/* list entries                          */
+static int      npred;
+
+/*
+ |  The closed SCCs that made new classes: classes cfirst .. cfirst+csize-1,
+ |  hashed into buckets by size
+ */
+#define CBUCKETS	1024
+static int      cbucket[CBUCKETS];
+static int      *cnext, *cfirst, *csize;
+static int      nclosed;
+
+#define SIG(X, A)	csig[((X) - 1) * nab + (A) - 1]
+#define ACCEPTS(S)	(sdfa->state_attrib[S] == 'A')
+
+static int      tarjan ();
+static unsigned hash_sig ();
+static int      find_class ();
+static int      new_class ();
+static int      cmp_local ();
+static int      local_refine ();
+static int      try_map ();
+
+/*-------------------------------------------------------------------------
+|  int  scc_refine (dfa, groups)
+|  automaton_t  *dfa;
+|  state_t      groups[];
+|
+|  Partition the states of 'dfa' into equivalence-classes in the
+|  Union-Find array 'groups[]'. Return the number of SCCs.
+`------------------------------------------------------------------------*/
+
+int  scc_refine (dfa, groups)
+automaton_t  *dfa;
+state_t      groups[];
+{
+    int      n = dfa->nstates;
+    int      *start;	/* states of SCC c: byscc[start[c] .. start[c+1]-1] */
+    state_t  *byscc, *sig, *rep, *fmap;
+    int      nscc, c, i, j, m, nacc, closed, b, a, found, X;
+    state_t  s, t, s0;
+    size_t   hsize;
+
+    sdfa = dfa;
+    nab = dfa->nab;
+    comp = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+
+    trace_begin("tarjan", NULL, NULL);
+    nscc = tarjan(dfa, comp);
+    trace_end("tarjan");
+
+    trace_begin("refine", NULL, NULL);
+    cls = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    lab = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    sig = (state_t *) mem_alloc(MEM_CLASSES, (nab + 1) * sizeof(state_t));
+    fmap = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    brep = (state_t *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(state_t));
+    queue = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    start = (int *) mem_alloc(MEM_CLASSES, (nscc + 1) * sizeof(int));
+    byscc = (state_t *) mem_alloc(MEM_CLASSES, n * sizeof(state_t));
+
+    nclasses = npred = nclosed = 0;
+    cacc = (char *) mem_alloc(MEM_CLASSES, n + 1);
+    csig = (state_t *) mem_alloc(MEM_CLASSES, (size_t) n * nab * sizeof(state_t));
+    for (hsize = 1; hsize < 2 * (size_t) n; hsize <<= 1)
+	;
+    hmask = hsize - 1;
+    htab = (int *) mem_alloc(MEM_CLASSES, hsize * sizeof(int));
+    phead = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    pnext = (int *) mem_alloc(MEM_CLASSES, (size_t) n * nab * sizeof(int));
+    pcls = (int *) mem_alloc(MEM_CLASSES, (size_t) n * nab * sizeof(int));
+    cnext = (int *) mem_alloc(MEM_CLASSES, (nscc + 1) * sizeof(int));
+    cfirst = (int *) mem_alloc(MEM_CLASSES, (nscc + 1) * sizeof(int));
+    csize = (int *) mem_alloc(MEM_CLASSES, (nscc + 1) * sizeof(int));
+    for (i = 0; i <= n; i++)
+	phead[i] = -1;
+    for (i = 0; i < CBUCKETS; i++)
+	cbucket[i] = -1;
+
+    /* group the states by SCC (counting sort) */
+    for (s = 1; s <= n; s++)
+	start[comp[s] + 1]++;
+    for (c = 1; c <= nscc; c++)
+	start[c] += start[c - 1];
+    for (s = 1; s <= n; s++)
+	byscc[start[comp[s]]++] = s;
+    for (c = nscc; c > 0; c--)
+	start[c] = start[c - 1];
+    start[0] = 0;
+
+    for (c = 0; c < nscc; c++) {
+	m = start[c + 1] - start[c];
+	s0 = byscc[start[c]];
+
+	if (m == 1) {               /* trivial, unless a self loop */
+	    for (a = 1; a <= nab; a++) {
+		t = dfa->mat[s0][a];
+		if (t == s0)
+		    break;
+		sig[a] = (t > 0) ? cls[t] : 0;
+	    }
+	    if (a > nab) {
+		if ((cls[s0] = find_class(ACCEPTS(s0), sig)) == 0)
+		    cls[s0] = new_class(ACCEPTS(s0), sig);
+		continue;
+	    }
+	}
+
+	/* a cyclic SCC: minimize it locally into blocks 0 .. m-1 */
+	cur_scc = c;
+	m = local_refine(byscc + start[c], start[c + 1] - start[c]);
+
+	/* look for a successor outside, to find candidate matches by */
+	closed = TRUE;
+	for (i = start[c]; i < start[c + 1] && closed; i++)
+	    for (a = 1; a <= nab; a++) {
+		t = dfa->mat[byscc[i]][a];
+		if (t > 0 && comp[t] != c) {
+		    s0 = byscc[i];
+		    closed = FALSE;
+		    break;
+		}
+	    }
+
+	found = FALSE;
+	if (! closed) {
+	    t = dfa->mat[s0][a];
+	    for (j = phead[cls[t]]; j >= 0 && ! found; j = pnext[j]) {
+		X = pcls[j];
+		if (SIG(X, a) == cls[t] && cacc[X] == ACCEPTS(s0))
+		    found = try_map(lab[s0], X, m, fmap);
+	    }
+	} else {
+	    for (nacc = 0, b = 0; b < m; b++)
+		nacc += ACCEPTS(brep[b]);
+	    for (j = cbucket[(m * 31 + nacc) % CBUCKETS]; j >= 0 && ! found;
+		 j = cnext[j]) {
+		if (csize[j] != m)
+		    continue;
+		for (X = cfirst[j]; X < cfirst[j] + m && ! found; X++)
+		    if (cacc[X] == ACCEPTS(s0))
+			found = try_map(lab[s0], X, m, fmap);
+	    }
+	}
+
+	if (! found) {              /* new classes for the blocks */
+	    for (b = 0; b < m; b++)
+		fmap[b] = nclasses + 1 + b;
+	    if (closed) {
+		j = (m * 31 + nacc) % CBUCKETS;
+		cfirst[nclosed] = nclasses + 1;
+		csize[nclosed] = m;
+		cnext[nclosed] = cbucket[j];
+		cbucket[j] = nclosed++;
+	    }
+	}
+	for (i = start[c]; i < start[c + 1]; i++)
+	    cls[byscc[i]] = fmap[lab[byscc[i]]];
+	if (! found)
+	    for (b = 0; b < m; b++) {
+		for (a = 1; a <= nab; a++) {
+		    t = dfa->mat[brep[b]][a];
+		    sig[a] = (t > 0) ? cls[t] : 0;
+		}
+		new_class(ACCEPTS(brep[b]), sig);
+	    }
+    }
+    trace_end("refine");
+
+    /* Union-Find form: the lowest state of every class represents it */
+    rep = fmap;
+    for (X = 1; X <= nclasses; X++)
+	rep[X] = 0;
+    for (s = 1; s <= n; s++)
+	if (rep[cls[s]] == 0) {
+	    rep[cls[s]] = s;
+	    groups[s] = 0;
+	} else {
+	    groups[s] = rep[cls[s]];
+	    groups[rep[cls[s]]]--;
+	}
+
+    mem_free(comp);
+    mem_free(cls);
+    mem_free(lab);
+    mem_free(sig);
+    mem_free(fmap);
+    mem_free(brep);
+    mem_free(queue);
+    mem_free(start);
+    mem_free(byscc);
+    mem_free(cacc);
+    mem_free(csig);
+    mem_free(htab);
+    mem_free(phead);
+    mem_free(pnext);
+    mem_free(pcls);
+    mem_free(cnext);
+    mem_free(cfirst);
+    mem_free(csize);
+    return nscc;
+}
+
+/*-------------------------------------------------------------------------
+|  int  scc_largest (dfa)
+|  automaton_t  *dfa;
+|
+|  Return the number of states of the largest cyclic SCC of 'dfa' (0 if
+|  'dfa' is acyclic).
+`------------------------------------------------------------------------*/
+
+int  scc_largest (dfa)
+automaton_t  *dfa;
+{
+    int      n = dfa->nstates;
+    int      *cmp, *size;
+    int      nscc, c, a = 0, max = 0;
+    state_t  s;
+
+    cmp = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    nscc = tarjan(dfa, cmp);
+    size = (int *) mem_alloc(MEM_CLASSES, nscc * sizeof(int));
+    for (s = 1; s <= n; s++)
+	size[cmp[s]]++;
+    for (s = 1; s <= n; s++) {
+	c = cmp[s];
+	if (size[c] == 1)           /* cyclic only with a self loop */
+	    for (a = 1; a <= dfa->nab; a++)
+		if (dfa->mat[s][a] == s)
+		    break;
+	if ((size[c] > 1 || a <= dfa->nab) && size[c] > max)
+	    max = size[c];
+    }
+    mem_free(cmp);
+    mem_free(size);
+    return max;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  tarjan (dfa, comp)
+|  automaton_t  *dfa;
+|  int          comp[];
+|
+|  Find the SCCs of 'dfa' (missing transitions ignored) by Tarjan's
+|  algorithm, made iterative. Store the SCC of every state 's' in
+|  'comp[s]', the SCCs being numbered from 0 in the order they are
+|  completed (reverse topological). Return the number of SCCs.
+`------------------------------------------------------------------------*/
+
+static int  tarjan (dfa, comp)
+automaton_t  *dfa;
+int          comp[];
+{
+    int      n = dfa->nstates;
+    int      *index, *low;
+    state_t  *stack;	/* Tarjan's stack of states               */
+    state_t  *call;	/* DFS (call) stack of states ...         */
+    int      *next;	/* ... and of their next symbol to try    */
+    int      sp = 0, cp, j, counter = 0, nscc = 0;
+    state_t  s, t, root;
+
+    index = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    low = (int *) mem_alloc(MEM_CLASSES, (n + 1) * sizeof(int));
+    stack = (state_t *) mem_alloc(MEM_CLASSES, n * sizeof(state_t));
+    call = (state_t *) mem_alloc(MEM_CLASSES, n * sizeof(state_t));
+    next = (int *) mem_alloc(MEM_CLASSES, n * sizeof(int));
+
+    for (s = 1; s <= n; s++)
+	comp[s] = -1;
+
+    for (root = 1; root <= n; root++) {
+	if (index[root] != 0)
+	    continue;
+	cp = 0;
+	call[cp] = root;
+	next[cp++] = 1;
+	index[root] = low[root] = ++counter;
+	stack[sp++] = root;
+	while (cp > 0) {
+	    s = call[cp - 1];
+	    j = next[cp - 1]++;
+	    if (j <= dfa->nab) {
+		if ((t = dfa->mat[s][j]) <= 0)
+		    continue;
+		if (index[t] == 0) {        /* tree edge: descend */
+		    index[t] = low[t] = ++counter;
+		    stack[sp++] = t;
+		    call[cp] = t;
+		    next[cp++] = 1;
+		} else if (comp[t] < 0 && index[t] < low[s])
+		    low[s] = index[t];      /* t still on the stack */
+		continue;
+	    }
+	    /* all successors done */
+	    if (low[s] == index[s]) {       /* s roots an SCC */
+		do {
+		    t = stack[--sp];
+		    comp[t] = nscc;
+		} while (t != s);
+		nscc++;
+	    }
+	    if (--cp > 0 && low[s] < low[call[cp - 1]])
+		low[call[cp - 1]] = low[s];
+	}
+    }
+
+    mem_free(index);
+    mem_free(low);
+    mem_free(stack);
+    mem_free(call);
+    mem_free(next);
+    return nscc;
+}
+
+/*-------------------------------------------------------------------------
+|  static unsigned  hash_sig (acc, sig)
+|  int      acc;
+|  state_t  sig[];
+|
+|  Hash the class signature: acceptance 'acc', successor classes
+|  sig[1 .. nab].
+`------------------------------------------------------------------------*/
+
+static unsigned  hash_sig (acc, sig)
+int      acc;
+state_t  sig[];
+{
+    unsigned  h = (unsigned) acc;
+    int       a;
+
+    for (a = 1; a <= nab; a++)
+	h = h * 0x9e3779b1u + (unsigned) sig[a];
+    return h ^ (h >> 15);
+}
+
+/*-------------------------------------------------------------------------
+|  static int  find_class (acc, sig)
+|  int      acc;
+|  state_t  sig[];
+|
+|  Return the class with the signature 'acc', 'sig[]', or 0 if none.
+`------------------------------------------------------------------------*/
+
+static int  find_class (acc, sig)
+int      acc;
+state_t  sig[];
+{
+    unsigned  h;
+    int       X, a;
+
+    for (h = hash_sig(acc, sig) & hmask; (X = htab[h]) != 0; h = (h + 1) & hmask) {
+	if (cacc[X] != acc)
+	    continue;
+	for (a = 1; a <= nab && SIG(X, a) == sig[a]; a++)
+	    ;
+	if (a > nab)
+	    return X;
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  new_class (acc, sig)
+|  int      acc;
+|  state_t  sig[];
+|
+|  Make a new class, with the signature 'acc', 'sig[]', and return it.
+`------------------------------------------------------------------------*/
+
+static int  new_class (acc, sig)
+int      acc;
+state_t  sig[];
+{
+    unsigned  h;
+    int       X = ++nclasses, a;
+
+    cacc[X] = acc;
+    for (a = 1; a <= nab; a++) {
+	SIG(X, a) = sig[a];
+	if (sig[a] > 0) {           /* X goes to sig[a] */
+	    pcls[npred] = X;
+	    pnext[npred] = phead[sig[a]];
+	    phead[sig[a]] = npred++;
+	}
+    }
+    for (h = hash_sig(acc, sig) & hmask; htab[h] != 0; h = (h + 1) & hmask)
+	;
+    htab[h] = X;
+    return X;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  local_refine (states, m)
+|  state_t  states[];
+|  int      m;
+|
+|  Partition the 'm' states 'states[]' of the SCC 'cur_scc' into blocks
+|  of equivalent states, the classes of the states outside the SCC
+|  being final (Moore: split by signature until stable). Set 'lab[s]'
+|  to the block of every state 's', a member of every block 'b' into
+|  'brep[b]', and return the number of blocks. Reorders 'states[]'.
+`------------------------------------------------------------------------*/
+
+static int  local_refine (states, m)
+state_t  states[];
+int      m;
+{
+    int  i, nb = 1, newnb, *newlab = queue;
+
+    for (i = 0; i < m; i++)
+	lab[states[i]] = 0;
+
+    for (;;) {
+	qsort(states, m, sizeof(state_t), cmp_local);
+	newnb = 0;
+	for (i = 0; i < m; i++) {
+	    if (i == 0 || cmp_local(&states[i - 1], &states[i]) != 0)
+		newnb++;
+	    newlab[i] = newnb - 1;
+	}
+	for (i = 0; i < m; i++)
+	    lab[states[i]] = newlab[i];
+	if (newnb == nb)
+	    break;
+	nb = newnb;
+    }
+
+    for (i = m - 1; i >= 0; i--)
+	brep[lab[states[i]]] = states[i];
+    return nb;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  cmp_local (p1, p2)
+|  state_t  *p1, *p2;
+|
+|  qsort() comparison of two states of the SCC 'cur_scc' by their local
+|  signature: their block, acceptance, then on every symbol: no
+|  transition, the class of a successor outside the SCC, or the block
+|  of a successor inside it.
+`------------------------------------------------------------------------*/
+
+static int  cmp_local (p1, p2)
+state_t  *p1, *p2;
+{
+    state_t  s1 = *p1, s2 = *p2, t1, t2;
+    int      v1, v2, a;
+
+    if (lab[s1] != lab[s2])
+	return lab[s1] - lab[s2];
+    if (ACCEPTS(s1) != ACCEPTS(s2))
+	return ACCEPTS(s1) - ACCEPTS(s2);
+    for (a = 1; a <= nab; a++) {
+	t1 = sdfa->mat[s1][a];
+	t2 = sdfa->mat[s2][a];
+	v1 = (t1 <= 0) ? 0 : (comp[t1] != cur_scc) ? cls[t1] : -1 - lab[t1];
+	v2 = (t2 <= 0) ? 0 : (comp[t2] != cur_scc) ? cls[t2] : -1 - lab[t2];
+	if (v1 != v2)
+	    return v1 - v2;
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------
+|  static int  try_map (b0, X0, m, fmap)
+|  int      b0, X0, m;
+|  state_t  fmap[];
+|
+|  Try to match the blocks 0 .. m-1 of the SCC 'cur_scc' with earlier
+|  classes, block 'b0' with class 'X0': follow the transitions of the
+|  blocks and of their would-be classes together, checking that they
+|  agree. On success the class of every block 'b' is in 'fmap[b]' and
+|  TRUE is returned.
+`------------------------------------------------------------------------*/
+
+static int  try_map (b0, X0, m, fmap)
+int      b0, X0, m;
+state_t  fmap[];
+{
+    int      head, tail, b, a, X, Y;
+    state_t  r, t;
+
+    for (b = 0; b < m; b++)
+	fmap[b] = 0;
+    fmap[b0] = X0;
+    queue[0] = b0;
+    for (head = 0, tail = 1; head < tail; head++) {
+	b = queue[head];
+	X = fmap[b];
+	r = brep[b];
+	if (cacc[X] != ACCEPTS(r))
+	    return FALSE;
+	for (a = 1; a <= nab; a++) {
+	    t = sdfa->mat[r][a];
+	    Y = SIG(X, a);
+	    if (t <= 0 || comp[t] != cur_scc) {
+		if (Y != ((t > 0) ? cls[t] : 0))
+		    return FALSE;
+	    } else if (Y == 0)
+		return FALSE;
+	    else if (fmap[lab[t]] == 0) {
+		fmap[lab[t]] = Y;
+		queue[tail++] = lab[t];
+	    } else if (fmap[lab[t]] != Y)
+		return FALSE;
+	}
+    }
+    return TRUE;
+}
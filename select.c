@@ -0,0 +1,137 @@
+/*-------------------------------------------------------------------------*\
+|  Module "select.c"
+|
+|  Automatic engine selection ("-e auto", the default).
+|
+|  After parsing, a few cheap features of the input DFA are computed
+|  (O(n k), plus O(k^2) for the alphabet classes: their cost is the
+|  "select usec" of -s) and an engine is chosen according to them:
+|
+|    1. An acyclic DFA of many
+|       alphabet classes               -> "acyclic"  (linear, one pass)
+|    2. A small DFA (few states)       -> "aho"      (lowest overhead)
+|    3. A nearly acyclic DFA (no large
+|       strongly connected component)
+|       of many alphabet classes       -> "scc"
+|    4. Anything else                  -> "hopcroft"
+|
+|  The thresholds below come from the refinement times (best of 5) of
+|  the engines on the random DFAs of bench.t's generator, of 10 - 1000
+|  states over 2 - 52 symbols; re-measure them when engines change:
+|    - on acyclic DFAs "acyclic" was ahead of "hopcroft" on 36 of the
+|      40 cases of 12 or 16 symbols, and on all of 26 symbols or more
+|      (by up to 3.5x), while from 4 symbols down "hopcroft" mostly was
+|      (by up to 2.6x);
+|    - "aho" was ahead of "hopcroft" on 19 of the 20 cases of 10 states,
+|      on 15 of the 40 of 20 - 32 states, and from 50 states on mostly
+|      behind (up to 5x), but on wide alphabets with nothing to merge;
+|    - on nearly acyclic DFAs "scc" was ahead of "hopcroft" on every
+|      case of 26 symbols or more from 200 states on (by up to 1.8x),
+|      on 13 of the 20 of 16 symbols, and split with it below that.
+|  The density is only reported (-s): it did not separate the engines.
+\*-------------------------------------------------------------------------*/
+
+#include "auto.h"
+
+#ifndef SMALL_DFA
+#   define SMALL_DFA	16	/* at most that many states: "aho"      */
+#endif
+
+#ifndef SMALL_SCC
+#   define SMALL_SCC	16	/* SCCs at most that large: "scc" ...   */
+#endif
+
+#ifndef SCC_CLASSES
+#   define SCC_CLASSES	16	/* ... with that many alphabet classes  */
+#endif
+
+#ifndef ACYCLIC_CLASSES
+#   define ACYCLIC_CLASSES 12	/* acyclic, that many classes: "acyclic" */
+#endif
+
+extern int  scc_largest ();
+
+/*-------------------------------------------------------------------------
+|  static int  same_column (dfa, j1, j2)
+|  automaton_t  *dfa;
+|  int          j1, j2;
+|
+|  Return TRUE iff the symbols 'j1' and 'j2' have identical columns,
+|  i.e. every state goes to the same state on both.
+`------------------------------------------------------------------------*/
+
+static int  same_column (dfa, j1, j2)
+automaton_t  *dfa;
+int          j1, j2;
+{
+    state_t  s;
+
+    for (s = 1; s <= dfa->nstates; s++)
+	if (dfa->mat[s][j1] != dfa->mat[s][j2])
+	    return FALSE;
+    return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+|  void  dfa_features (dfa, f)
+|  automaton_t  *dfa;
+|  features_t   *f;
+|
+|  Compute the selection features of 'dfa' into '*f'.
+`------------------------------------------------------------------------*/
+
+void  dfa_features (dfa, f)
+automaton_t  *dfa;
+features_t   *f;
+{
+    state_t        s;
+    int            j, k;
+    long           defined = 0;
+    unsigned long  hash[AB_SIZE + 1];
+
+    f->nstates = dfa->nstates;
+    f->nab = dfa->nab;
+
+    /* density & column hashes in one row-major pass */
+    for (j = 1; j <= dfa->nab; j++)
+	hash[j] = 0;
+    for (s = 1; s <= dfa->nstates; s++)
+	for (j = 1; j <= dfa->nab; j++) {
+	    if (dfa->mat[s][j] > 0)
+		defined++;
+	    hash[j] = hash[j] * 31 + (unsigned long) dfa->mat[s][j];
+	}
+    f->density = (double) defined / ((double) dfa->nstates * dfa->nab);
+
+    /* alphabet classes: symbols with distinct columns */
+    f->ab_classes = 0;
+    for (j = 1; j <= dfa->nab; j++) {
+	for (k = 1; k < j; k++)
+	    if (hash[k] == hash[j] && same_column(dfa, k, j))
+		break;
+	if (k == j)
+	    f->ab_classes++;
+    }
+
+    f->max_scc = scc_largest(dfa);
+    f->acyclic = (f->max_scc == 0);
+}
+
+/*-------------------------------------------------------------------------
+|  char  *select_engine (f)
+|  features_t  *f;
+|
+|  Return the name of the engine best suited to a DFA with features 'f'.
+`------------------------------------------------------------------------*/
+
+char  *select_engine (f)
+features_t  *f;
+{
+    if (f->acyclic && f->ab_classes >= ACYCLIC_CLASSES)
+	return "acyclic";
+    if (f->nstates <= SMALL_DFA)
+	return "aho";
+    if (f->max_scc <= SMALL_SCC && f->ab_classes >= SCC_CLASSES)
+	return "scc";
+    return "hopcroft";
+}
@@ -0,0 +1,176 @@
+/*-------------------------------------------------------------------------*\
+|  Module "trace.c"
+|
+|  Optional timeline tracing in the Chrome trace-event JSON format
+|  (loadable by chrome://tracing, Perfetto and compatible viewers).
+|
+|  Every traced region is written as a pair of events:
+|
+|	{"name":"...","ph":"B","ts":T,"pid":P,"tid":X}	(span begins)
+|	{"name":"...","ph":"E","ts":T,"pid":P,"tid":X}	(span ends)
+|
+|  where 'ts' is the time in microseconds since the trace was opened and
+|  'tid' identifies the thread that executed the span, so that work done
+|  by several threads shows up on separate timeline tracks.
+|
+|  When no trace file was opened all the functions below return
+|  immediately, so tracing calls may be left in hot paths.
+\*-------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#  include <sys/syscall.h>
+#endif
+
+#include "auto.h"
+
+static FILE   *trace_fp = NULL;	/* trace output file (NULL: tracing off) */
+static double  trace_t0;	/* trace start time (microseconds)       */
+static int     trace_pid;	/* process id reported in every event    */
+
+void            trace_close ();
+static double   now_usec ();
+static long     thread_id ();
+static void     put_event ();
+
+/*-------------------------------------------------------------------------
+|  void  trace_open (filename)
+|  char  *filename;
+|
+|  Start tracing into the file 'filename' (which is truncated).
+|  The trace is completed at exit, so runs terminated by Abort()
+|  still leave a loadable trace behind.
+`------------------------------------------------------------------------*/
+
+void  trace_open (filename)
+char  *filename;
+{
+    if ((trace_fp = fopen(filename, "w")) == NULL) {
+	perror(filename);
+	exit(1);
+    }
+    trace_t0 = now_usec();
+    trace_pid = (int) getpid();
+    fprintf(trace_fp, "{\"traceEvents\":[\n");
+    fprintf(trace_fp,
+	    "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,"
+	    "\"args\":{\"name\":\"minauto\"}}",
+	    trace_pid, thread_id());
+    atexit(trace_close);
+}
+
+/*-------------------------------------------------------------------------
+|  void  trace_close ()
+|
+|  Terminate the JSON document and close the trace file.
+`------------------------------------------------------------------------*/
+
+void  trace_close ()
+{
+    if (trace_fp == NULL)
+	return;
+    fprintf(trace_fp, "\n]}\n");
+    fclose(trace_fp);
+    trace_fp = NULL;
+}
+
+/*-------------------------------------------------------------------------
+|  void  trace_begin (name, arg_name, arg)
+|  char  *name;
+|  char  *arg_name, *arg;
+|
+|  Open a span called 'name' on the calling thread's track.
+|  If 'arg_name' is not NULL the span is annotated with the string
+|  argument 'arg_name' = 'arg' (e.g. the file being processed).
+`------------------------------------------------------------------------*/
+
+void  trace_begin (name, arg_name, arg)
+char  *name;
+char  *arg_name, *arg;
+{
+    if (trace_fp != NULL)
+	put_event(name, 'B', arg_name, arg);
+}
+
+/*-------------------------------------------------------------------------
+|  void  trace_end (name)
+|  char  *name;
+|
+|  Close the innermost open span 'name' of the calling thread.
+`------------------------------------------------------------------------*/
+
+void  trace_end (name)
+char  *name;
+{
+    if (trace_fp != NULL)
+	put_event(name, 'E', NULL, NULL);
+}
+
+/*-------------------------------------------------------------------------
+|  static void  put_event (name, phase, arg_name, arg)
+|  char  *name;
+|  int   phase;
+|  char  *arg_name, *arg;
+|
+|  Write a single trace event. String arguments are JSON-escaped.
+|  Each event is written by one stdio call so events written by
+|  concurrent threads are never interleaved.
+`------------------------------------------------------------------------*/
+
+static void  put_event (name, phase, arg_name, arg)
+char  *name;
+int   phase;
+char  *arg_name, *arg;
+{
+    char   args[512];
+    char   *p = args, *end = args + sizeof(args) - 8;
+
+    args[0] = '\0';
+    if (arg_name != NULL) {
+	p += sprintf(p, ",\"args\":{\"%s\":\"", arg_name);
+	for (; arg != NULL && *arg != '\0' && p < end; arg++) {
+	    if (*arg == '"' || *arg == '\\')
+		*p++ = '\\';
+	    if ((unsigned char) *arg >= ' ')
+		*p++ = *arg;
+	}
+	strcpy(p, "\"}");
+    }
+    fprintf(trace_fp,
+	    ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%ld%s}",
+	    name, phase, now_usec() - trace_t0, trace_pid, thread_id(), args);
+}
+
+/*-------------------------------------------------------------------------
+|  static double  now_usec ()
+|
+|  Return a monotonic time stamp in microseconds.
+`------------------------------------------------------------------------*/
+
+static double  now_usec ()
+{
+    struct timespec  ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/*-------------------------------------------------------------------------
+|  static long  thread_id ()
+|
+|  Return an id of the calling thread (the kernel thread id on Linux,
+|  otherwise all events are attributed to a single track).
+`------------------------------------------------------------------------*/
+
+static long  thread_id ()
+{
+#ifdef SYS_gettid
+    return (long) syscall(SYS_gettid);
+#else
+    return 1L;
+#endif
+}